@@ -1,16 +1,18 @@
 #include "ac_fast.h"
 
 #include "ac_slow.h"
+#include "unicode/char_kind.h"
+#include "unicode/unicode.h"
 
 #include <algorithm>  // for std::sort
 #include <cassert>
 
 namespace base {
 
-uint32 ACConverter::Calc_State_Sz(const ACSlowState* s) const {
+uint32 ACConverter::Calc_State_Sz(const ACSlowState& s) const {
     ACState dummy;
     uint32 sz = offsetof(ACState, input_vect);
-    sz += s->goto_num() * sizeof(dummy.input_vect[0]);
+    sz += s.goto_num() * sizeof(dummy.input_vect[0]);
 
     if (sz < sizeof(ACState)) sz = sizeof(ACState);
 
@@ -20,12 +22,12 @@ uint32 ACConverter::Calc_State_Sz(const ACSlowState* s) const {
 }
 
 ACBuffer* ACConverter::Alloc_Buffer() {
-    const std::vector<ACSlowState*>& all_states = _acs.all_states();
-    const ACSlowState* root_state = _acs.root();
-    uint32 root_fanout = root_state->goto_num();
+    const std::vector<ACSlowState>& all_states = _acs.all_states();
+    const ACSlowState& root_state = _acs.root();
+    uint32 root_fanout = root_state.goto_num();
 
     // Step 1: Calculate the buffer size
-    ACOffset root_goto_ofst, states_ofst_ofst, first_state_ofst;
+    ACOffset root_goto_ofst, fold_map_ofst = 0, states_ofst_ofst, first_state_ofst;
 
     // part 1 :  buffer header
     uint32 sz = root_goto_ofst = sizeof(ACBuffer);
@@ -37,21 +39,27 @@ ACBuffer* ACConverter::Alloc_Buffer() {
         root_goto_ofst = 0;
     }
 
-    // part 3: mapping of state's relative position.
+    // part 3: input folding table
+    if (_acs.options().case_insensitive) {
+        fold_map_ofst = sz;
+        sz += 256;
+    }
+
+    // part 4: mapping of state's relative position.
     unsigned align = __alignof__(ACOffset);
     sz = (sz + align - 1) & ~(align - 1);
     states_ofst_ofst = sz;
 
     sz += sizeof(ACOffset) * all_states.size();
 
-    // part 4: state's contents
+    // part 5: state's contents
     align = __alignof__(ACState);
     sz = (sz + align - 1) & ~(align - 1);
     first_state_ofst = sz;
 
     uint32 state_sz = 0;
-    for (auto i = all_states.begin(), e = all_states.end(); i != e; i++) {
-        state_sz += Calc_State_Sz(*i);
+    for (const auto& s : all_states) {
+        state_sz += Calc_State_Sz(s);
     }
     state_sz -= Calc_State_Sz(root_state);
 
@@ -62,119 +70,87 @@ ACBuffer* ACConverter::Alloc_Buffer() {
 
     buf->buf_len = sz;
     buf->root_goto_ofst = root_goto_ofst;
+    buf->fold_map_ofst = fold_map_ofst;
     buf->states_ofst_ofst = states_ofst_ofst;
     buf->first_state_ofst = first_state_ofst;
     buf->root_goto_num = root_fanout;
     buf->state_num = _acs.state_num();
+    buf->whole_word = _acs.options().whole_word;
     return buf;
 }
 
-void ACConverter::Populate_Root_Goto_Func(ACBuffer* buf, GotoVect& goto_vect) {
+void ACConverter::Populate_Fold_Map(ACBuffer* buf) {
+    if (buf->fold_map_ofst == 0) return;
+
     unsigned char* buf_base = (unsigned char*)(buf);
-    InputTy* root_gotos = (InputTy*)(buf_base + buf->root_goto_ofst);
-    const ACSlowState* root_state = _acs.root();
+    InputTy* fold_map = (InputTy*)(buf_base + buf->fold_map_ofst);
+    for (uint32 c = 0; c <= 255; ++c) {
+        fold_map[c] = Fold_ASCII(c);
+    }
+}
 
-    root_state->Get_Sorted_Gotos(goto_vect);
+void ACConverter::Populate_Root_Goto_Func(ACBuffer* buf) {
+    unsigned char* buf_base = (unsigned char*)(buf);
+    InputTy* root_gotos = (InputTy*)(buf_base + buf->root_goto_ofst);
+    auto goto_vect = _acs.Get_Sorted_Gotos(_acs.root());
 
-    // Renumber the ID of root-node's immediate kids.
-    uint32 new_id = 1;
     bool full_fantout = (goto_vect.size() == 255);
-    if (!full_fantout) [[likely]] {
-        memset(root_gotos, '\0', 256 * sizeof(InputTy));
+    if (full_fantout) [[unlikely]] {
+        return;
     }
 
-    for (auto i = goto_vect.begin(), e = goto_vect.end(); i != e; i++, new_id++) {
-        InputTy c = i->first;
-        ACSlowState* s = i->second;
-        _id_map[s->id()] = new_id;
-
-        if (!full_fantout) [[likely]] {
-            root_gotos[c] = new_id;
-        }
+    // The slow graph is numbered in BFS order, so the root's kids already have IDs 1 to fan-out.
+    memset(root_gotos, '\0', 256 * sizeof(InputTy));
+    for (const auto& g : goto_vect) {
+        root_gotos[g.input] = g.kid;
     }
 }
 
 ACBuffer* ACConverter::Convert() {
-    // Step 1: Some preparation stuff.
-    GotoVect gotovect;
-
-    _id_map.clear();
-    _ofst_map.clear();
-    _id_map.resize(_acs.next_node_id());
-    _ofst_map.resize(_acs.next_node_id());
-
-    // Step 2: allocate buffer to accommodate the entire AC graph.
+    // Step 1: allocate buffer to accommodate the entire AC graph.
     ACBuffer* buf = Alloc_Buffer();
     unsigned char* buf_base = (unsigned char*)buf;
 
-    // Step 3: Root node need special care.
-    Populate_Root_Goto_Func(buf, gotovect);
-    buf->root_goto_num = gotovect.size();
-    _id_map[_acs.root()->id()] = 0;
-
-    // Step 4: Converting the remaining states by BFSing the graph.
-    // First of all, enter root's immediate kids to the working list.
-    std::vector<const ACSlowState*> wl;
-    StateID id = 1;
-    for (auto i = gotovect.begin(); i != gotovect.end(); i++, id++) {
-        ACSlowState* s = i->second;
-        wl.push_back(s);
-        _id_map[s->id()] = id;
-    }
+    // Step 2: Root node need special care.
+    Populate_Root_Goto_Func(buf);
+    Populate_Fold_Map(buf);
 
+    // Step 3: Convert the remaining states. The slow graph is already numbered in BFS order with
+    // consecutive kids, which is exactly the numbering of the fast graph, so states are copied in
+    // order.
+    const std::vector<ACSlowState>& all_states = _acs.all_states();
     ACOffset* state_ofst_vect = (ACOffset*)(buf_base + buf->states_ofst_ofst);
     ACOffset ofst = buf->first_state_ofst;
-    for (uint32 idx = 0; idx < wl.size(); idx++) {
-        const ACSlowState* old_s = wl[idx];
+    for (StateID state_id = 1; state_id < all_states.size(); ++state_id) {
+        const ACSlowState& old_s = all_states[state_id];
         ACState* new_s = (ACState*)(buf_base + ofst);
-
-        // This property should hold as we:
-        //  - States are appended to worklist in the BFS order.
-        //  - sibling states are appended to worklist in the order of their
-        //    corresponding input.
-        //
-        StateID state_id = idx + 1;
-        assert(_id_map[old_s->id()] == state_id);
-
         state_ofst_vect[state_id] = ofst;
 
-        new_s->first_kid = wl.size() + 1;
-        new_s->depth = old_s->depth();
-        new_s->is_term = old_s->is_terminal() ? old_s->pattern_index() + 1 : 0;
-
-        uint32 gotonum = old_s->goto_num();
-        new_s->goto_num = gotonum;
+        auto gotos = _acs.Get_Sorted_Gotos(old_s);
+        new_s->first_kid = gotos.empty() ? 0 : gotos.front().kid;
+        new_s->fail_link = old_s.fail_link();
+        // States are numbered in BFS order, so the fail-link's state has already been converted.
+        if (StateID fail = old_s.fail_link(); fail != 0) {
+            const ACState* fail_s = (ACState*)(buf_base + state_ofst_vect[fail]);
+            new_s->dict_link = all_states[fail].is_terminal() ? fail : fail_s->dict_link;
+        } else {
+            new_s->dict_link = 0;
+        }
+        new_s->depth = old_s.depth();
+        new_s->is_term = old_s.is_terminal() ? old_s.pattern_index() + 1 : 0;
+        new_s->goto_num = gotos.size();
 
         // Populate the "input" field
-        old_s->Get_Sorted_Gotos(gotovect);
-        uint32 input_idx = 0;
-        uint32 id = wl.size() + 1;
         InputTy* input_vect = new_s->input_vect;
-        for (auto i = gotovect.begin(), e = gotovect.end(); i != e; i++, id++, input_idx++) {
-            input_vect[input_idx] = i->first;
-
-            ACSlowState* kid = i->second;
-            _id_map[kid->id()] = id;
-            wl.push_back(kid);
+        for (size_t i = 0; i < gotos.size(); ++i) {
+            input_vect[i] = gotos[i].input;
         }
 
-        _ofst_map[old_s->id()] = ofst;
         ofst += Calc_State_Sz(old_s);
     }
 
     // This assertion might be useful to catch buffer overflow
     assert(ofst == buf->buf_len);
-
-    // Populate the fail-link field.
-    for (auto i = wl.begin(), e = wl.end(); i != e; i++) {
-        const ACSlowState* slow_s = *i;
-        StateID fast_s_id = _id_map[slow_s->id()];
-        ACState* fast_s = (ACState*)(buf_base + state_ofst_vect[fast_s_id]);
-        if (const ACSlowState* fl = slow_s->fail_link()) {
-            StateID id = _id_map[fl->id()];
-            fast_s->fail_link = id;
-        } else fast_s->fail_link = 0;
-    }
     return buf;
 }
 
@@ -221,45 +197,164 @@ inline bool Binary_Search_Input(InputTy* input_vect, int vect_len, InputTy input
 }
 }  // namespace
 
-AhoCorasick::MatchResult Match(ACBuffer* buf, const PieceTree& tree) {
+// A match only needs a boundary on a side where it begins or ends with a word character, so that
+// e.g. "+" is still found in "a+b". Word characters are classified like cursor movement does.
+bool Is_Whole_Word(const PieceTree& tree, size_t begin, size_t end) {
+    using unicode::CharKind;
+    using unicode::to_kind;
+
+    if (begin > 0) {
+        auto prev_kind = to_kind(ReverseTreeWalker{&tree, begin}.next_codepoint());
+        auto first_kind = to_kind(TreeWalker{&tree, begin}.next_codepoint());
+        if (prev_kind == CharKind::kWord && first_kind == CharKind::kWord) return false;
+    }
+    if (end < tree.length()) {
+        auto last_kind = to_kind(ReverseTreeWalker{&tree, end}.next_codepoint());
+        auto next_kind = to_kind(TreeWalker{&tree, end}.next_codepoint());
+        if (last_kind == CharKind::kWord && next_kind == CharKind::kWord) return false;
+    }
+    return true;
+}
+
+bool Is_Whole_Word(std::string_view text, size_t begin, size_t end) {
+    using unicode::CharKind;
+    using unicode::to_kind;
+
+    // Invalid UTF-8 is classified like the tree walkers do, as codepoint 0.
+    auto kind_at = [text](size_t i) {
+        const char* ptr = text.data() + i;
+        unicode::Unichar codepoint = unicode::NextUTF8(&ptr, text.data() + text.length());
+        return to_kind(std::max(codepoint, 0));
+    };
+    auto kind_before = [&](size_t i) {
+        size_t lead = i - 1;
+        while (lead > 0 && i - lead < unicode::kMaxBytesInUTF8Sequence &&
+               (static_cast<unsigned char>(text[lead]) & 0xC0) == 0x80) {
+            --lead;
+        }
+        return kind_at(lead);
+    };
+
+    if (begin > 0) {
+        if (kind_before(begin) == CharKind::kWord && kind_at(begin) == CharKind::kWord) {
+            return false;
+        }
+    }
+    if (end < text.length()) {
+        if (kind_before(end) == CharKind::kWord && kind_at(end) == CharKind::kWord) return false;
+    }
+    return true;
+}
+
+namespace {
+
+// Walks a contiguous span with the part of the `TreeWalker` interface used by `Match_Impl()`.
+class SpanWalker {
+public:
+    SpanWalker(std::string_view text, size_t offset)
+        : text{text}, pos{std::min(offset, text.length())} {}
+
+    char current() {
+        return text[pos];
+    }
+    char next() {
+        return text[pos++];
+    }
+    bool exhausted() const {
+        return pos == text.length();
+    }
+    size_t offset() const {
+        return pos;
+    }
+
+private:
+    std::string_view text;
+    size_t pos;
+};
+
+TreeWalker Make_Walker(const PieceTree& tree, size_t start) {
+    return TreeWalker{&tree, start};
+}
+
+SpanWalker Make_Walker(std::string_view text, size_t start) {
+    return SpanWalker{text, start};
+}
+
+// Feeds the bytes in [start, end) to the automaton and passes each match to `on_match`, in order
+// of their end offset, until it returns true. Unless `kReportAll` is set, only the longest pattern
+// ending at a given offset is reported.
+template <bool kFoldInput, bool kReportAll, typename Text, typename Callback>
+void Match_Impl(ACBuffer* buf,
+                const Text& text,
+                size_t start,
+                size_t end,
+                Callback&& on_match) {
     unsigned char* buf_base = (unsigned char*)(buf);
     unsigned char* root_goto = buf_base + buf->root_goto_ofst;
+    InputTy* fold_map = (InputTy*)(buf_base + buf->fold_map_ofst);
     ACOffset* states_ofst_vect = (ACOffset*)(buf_base + buf->states_ofst_ofst);
 
+    auto input = [fold_map](char c) -> InputTy {
+        if constexpr (kFoldInput) {
+            return fold_map[static_cast<InputTy>(c)];
+        } else {
+            return c;
+        }
+    };
+
     ACState* state = 0;
-    // TODO: Implement starting/stopping at a specific index.
-    TreeWalker walker{&tree};
+    auto walker = Make_Walker(text, start);
+    auto exhausted = [&] { return walker.exhausted() || walker.offset() >= end; };
+
+    // Reports the matches ending at `s`, which was reached right before the walker's current
+    // offset. Returns true if `on_match` asked to stop. The patterns that end here are `s` itself
+    // and the chain of its dictionary links, longest first. Unless all matches are wanted, only
+    // the longest one that is accepted is reported, even if `s` isn't terminal: e.g., "bc" ends
+    // at "abc" while "abcd" is still being matched.
+    auto is_match = [&](ACState* s) {
+        size_t idx = walker.offset();
+        while (true) {
+            if (s->is_term) [[unlikely]] {
+                if (!buf->whole_word || Is_Whole_Word(text, idx - s->depth, idx)) {
+                    AhoCorasick::MatchResult result = {
+                        .match_begin = static_cast<int>(idx - s->depth),
+                        .match_end = static_cast<int>(idx - 1),
+                        .pattern_idx = static_cast<int>(s->is_term - 1),
+                    };
+                    if (on_match(result)) return true;
+                    if constexpr (!kReportAll) return false;
+                }
+            }
+            if (s->dict_link == 0) [[likely]] return false;
+            s = Get_State_Addr(buf_base, states_ofst_vect, s->dict_link);
+        }
+    };
 
     // Skip leading chars that are not valid input of root-nodes.
     if (buf->root_goto_num != 255) [[likely]] {
-        while (!walker.exhausted()) {
-            unsigned char c = walker.next();
+        while (!exhausted()) {
+            unsigned char c = input(walker.next());
             if (unsigned char kid_id = root_goto[c]) {
                 state = Get_State_Addr(buf_base, states_ofst_vect, kid_id);
                 break;
             }
         }
-    } else {
+    } else if (!exhausted()) {
         // TODO: Is this correct? Reference the original implementation to see if we transcribed it
         // correctly.
-        unsigned char c = walker.next();
+        unsigned char c = input(walker.next());
         state = Get_State_Addr(buf_base, states_ofst_vect, c);
     }
 
     if (state != 0) [[likely]] {
-        if (state->is_term) [[unlikely]] {
-            uint32 idx = walker.offset();
-            /* Dictionary may have string of length 1 */
-            return {
-                .match_begin = static_cast<int>(idx - state->depth),
-                .match_end = static_cast<int>(idx - 1),
-                .pattern_idx = state->is_term - 1,
-            };
-        }
+        /* Dictionary may have string of length 1 */
+        if (is_match(state)) return;
+    } else {
+        return;
     }
 
-    while (!walker.exhausted()) {
-        unsigned char c = walker.current();
+    while (!exhausted()) {
+        unsigned char c = input(walker.current());
         int res;
         bool found;
         found = Binary_Search_Input(state->input_vect, state->goto_num, c, res);
@@ -277,30 +372,83 @@ AhoCorasick::MatchResult Match(ACBuffer* buf, const PieceTree& tree) {
                 // points to "goto(root, c)"), so we don't need speical handling
                 // as we did before this while-loop is entered.
                 //
-                while (!walker.exhausted()) {
-                    InputTy c = walker.next();
+                ACState* kid = 0;
+                while (!exhausted()) {
+                    InputTy c = input(walker.next());
                     if (unsigned char kid_id = root_goto[c]) {
-                        state = Get_State_Addr(buf_base, states_ofst_vect, kid_id);
+                        kid = Get_State_Addr(buf_base, states_ofst_vect, kid_id);
                         break;
                     }
                 }
+                // The input ran out before re-entering the automaton.
+                if (!kid) break;
+                state = kid;
             } else {
                 state = Get_State_Addr(buf_base, states_ofst_vect, fl);
+                // No input was consumed, and the dictionary links of the previous state, which
+                // include every terminal state on this chain, were already checked at this offset.
+                // Checking them again would report the shorter patterns twice.
+                continue;
             }
         }
 
         // Check to see if the state is terminal state?
-        if (state->is_term) {
-            uint32 idx = walker.offset();
-            return {
-                .match_begin = static_cast<int>(idx - state->depth),
-                .match_end = static_cast<int>(idx - 1),
-                .pattern_idx = state->is_term - 1,
-            };
-        }
+        if (is_match(state)) return;
+    }
+}
+
+}  // namespace
+
+AhoCorasick::MatchResult Match(ACBuffer* buf, const PieceTree& tree, size_t start, size_t end) {
+    AhoCorasick::MatchResult result = {-1, -1, -1};
+    auto on_match = [&result](const AhoCorasick::MatchResult& r) {
+        result = r;
+        return true;
+    };
+
+    // Dispatch once so that exact matching doesn't pay for the folding table lookup.
+    if (buf->fold_map_ofst != 0) {
+        Match_Impl<true, false>(buf, tree, start, end, on_match);
+    } else {
+        Match_Impl<false, false>(buf, tree, start, end, on_match);
     }
+    return result;
+}
+
+namespace {
+
+template <typename Text>
+void Match_All_Impl(ACBuffer* buf,
+                    const Text& text,
+                    size_t start,
+                    size_t end,
+                    const std::function<void(const AhoCorasick::MatchResult&)>& callback) {
+    auto on_match = [&callback](const AhoCorasick::MatchResult& r) {
+        callback(r);
+        return false;
+    };
+
+    if (buf->fold_map_ofst != 0) {
+        Match_Impl<true, true>(buf, text, start, end, on_match);
+    } else {
+        Match_Impl<false, true>(buf, text, start, end, on_match);
+    }
+}
+
+}  // namespace
+
+void Match_All(ACBuffer* buf,
+               const PieceTree& tree,
+               size_t start,
+               size_t end,
+               const std::function<void(const AhoCorasick::MatchResult&)>& callback) {
+    Match_All_Impl(buf, tree, start, end, callback);
+}
 
-    return {-1, -1, -1};
+void Match_All(ACBuffer* buf,
+               std::string_view text,
+               const std::function<void(const AhoCorasick::MatchResult&)>& callback) {
+    Match_All_Impl(buf, text, 0, text.length(), callback);
 }
 
 }  // namespace base
@@ -3,7 +3,6 @@
 #include "ac_slow.h"
 #include "aho_corasick.h"
 
-#include <vector>
 
 namespace base {
 
@@ -30,23 +29,29 @@ using StateID = uint32;
 //      stores value i -- i.e the i-th state. So, we don't need such array
 //      at all. On the other hand, 8-bit is insufficient to encode kids' ID.
 //
-//   3. An array indiced by state's id, and the element is the offset
+//   3. For case-insensitive automata, a 256-entry table that folds each
+//      input byte before it is fed to the automaton.
+//
+//   4. An array indiced by state's id, and the element is the offset
 //      of corresponding state wrt the base address of the buffer.
 //
-//   4. the contents of states.
+//   5. the contents of states.
 //
 struct ACBuffer {
     uint32 buf_len;
     ACOffset root_goto_ofst;    // addr of root node's goto() function.
+    ACOffset fold_map_ofst;     // addr of input folding table, 0 if input is matched exactly.
     ACOffset states_ofst_ofst;  // addr of state pointer vector (indiced by id)
     ACOffset first_state_ofst;  // addr of the first state in the buffer.
     uint16 root_goto_num;       // fan-out of root-node.
-    uint16 state_num;           // number of states
+    uint32 state_num;           // number of states
+    bool whole_word;            // reject matches that don't start and end on word boundaries.
 
     // Followed by the gut of the buffer:
     // 1. map: root's-valid-input -> kid's id
-    // 2. map: state's ID -> offset of the state
-    // 3. states' content.
+    // 2. map: input -> folded input (optional)
+    // 3. map: state's ID -> offset of the state
+    // 4. states' content.
 };
 
 // Depict the state of "fast" AC graph.
@@ -60,9 +65,11 @@ struct ACState {
     //
     StateID first_kid;
     ACOffset fail_link;
-    short depth;             // How far away from root.
-    unsigned short is_term;  // Is terminal node. if is_term != 0, it encodes
+    StateID dict_link;       // The nearest terminal state on the fail-link chain, or 0 if
+                             // there is none. It leads to the shorter patterns that end here.
+    uint32 is_term;          // Is terminal node. if is_term != 0, it encodes
                              // the value of "1 + pattern-index".
+    short depth;             // How far away from root.
     unsigned char goto_num;  // The number of valid transition.
     InputTy input_vect[1];   // Vector of valid input. Must be last field!
 };
@@ -86,29 +93,29 @@ public:
 
 private:
     // Return the size in byte needed to to save the specified state.
-    uint32 Calc_State_Sz(const ACSlowState*) const;
-
-    // In fast-AC-graph, the ID is bit tricky. Given a state of slow-graph,
-    // this function is to return the ID of its counterpart in the fast-graph.
-    StateID Get_Renumbered_Id(const ACSlowState* s) const {
-        const std::vector<uint32>& m = _id_map;
-        return m[s->id()];
-    }
+    uint32 Calc_State_Sz(const ACSlowState&) const;
 
     ACBuffer* Alloc_Buffer();
-    void Populate_Root_Goto_Func(ACBuffer*, GotoVect&);
+    void Populate_Root_Goto_Func(ACBuffer*);
+    void Populate_Fold_Map(ACBuffer*);
 
 private:
     ACSlowConstructor& _acs;
     BufAllocator& _buf_alloc;
-
-    // map: ID of state in slow-graph -> ID of counterpart in fast-graph.
-    std::vector<uint32> _id_map;
-
-    // map: ID of state in slow-graph -> offset of counterpart in fast-graph.
-    std::vector<ACOffset> _ofst_map;
 };
 
-AhoCorasick::MatchResult Match(ACBuffer* buf, const PieceTree& tree);
+// Returns true if the match [begin, end) lies on word boundaries.
+bool Is_Whole_Word(const PieceTree& tree, size_t begin, size_t end);
+bool Is_Whole_Word(std::string_view text, size_t begin, size_t end);
+
+AhoCorasick::MatchResult Match(ACBuffer* buf, const PieceTree& tree, size_t start, size_t end);
+void Match_All(ACBuffer* buf,
+               const PieceTree& tree,
+               size_t start,
+               size_t end,
+               const std::function<void(const AhoCorasick::MatchResult&)>& callback);
+void Match_All(ACBuffer* buf,
+               std::string_view text,
+               const std::function<void(const AhoCorasick::MatchResult&)>& callback);
 
 }  // namespace base
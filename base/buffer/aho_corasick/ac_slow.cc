@@ -1,106 +1,244 @@
 #include "ac_slow.h"
 
 #include "aho_corasick.h"
+#include "base/numeric/literals.h"
+#include "third_party/uni_algo/include/uni_algo/case.h"
+#include "unicode/unicode.h"
+#include "unicode/utf8_decoder.h"
 
+#include <array>
 #include <cassert>
+#include <optional>
+#include <unordered_map>
 
 namespace base {
 
-ACSlowConstructor::ACSlowConstructor() : _next_node_id(1) {
-    _root = new_state();
-    _root_char = new InputTy[256];
-    memset((void*)_root_char, '\0', 256);
-}
+namespace {
+
+// Case variants multiply the number of trie paths for a pattern. Past this many paths, codepoints
+// first lose their rare variants (e.g., the Kelvin sign for 'k') and then are matched as typed.
+// ASCII letters are folded regardless, since they never add paths.
+constexpr size_t kMaxCaseVariantPaths = 256;
+
+// No codepoint past this one has a simple case mapping.
+constexpr char32_t kLastCasedCodepoint = 0x1FFFF;
+
+// Returns every codepoint that is equal to `cp` under simple case folding. The first entries are
+// `cp` itself and then its simple lowercase and uppercase mappings.
+std::vector<char32_t> Case_Variants(char32_t cp) {
+    // uni_algo only provides the forward mapping, so build the inverse once.
+    static const std::unordered_map<char32_t, std::vector<char32_t>> kUnfoldMap = [] {
+        std::unordered_map<char32_t, std::vector<char32_t>> map;
+        for (char32_t c = 0; c <= kLastCasedCodepoint; ++c) {
+            char32_t folded = una::codepoint::to_simple_casefold(c);
+            if (folded != c) map[folded].push_back(c);
+        }
+        return map;
+    }();
+
+    std::vector<char32_t> variants = {cp};
+    auto add_variant = [&](char32_t c) {
+        if (std::find(variants.begin(), variants.end(), c) == variants.end()) {
+            variants.push_back(c);
+        }
+    };
+
+    add_variant(una::codepoint::to_simple_lowercase(cp));
+    add_variant(una::codepoint::to_simple_uppercase(cp));
 
-ACSlowConstructor::~ACSlowConstructor() {
-    for (auto i = _all_states.begin(); i != _all_states.end(); ++i) {
-        delete *i;
+    char32_t folded = una::codepoint::to_simple_casefold(cp);
+    add_variant(folded);
+    if (auto it = kUnfoldMap.find(folded); it != kUnfoldMap.end()) {
+        for (char32_t c : it->second) add_variant(c);
     }
-    _all_states.clear();
-    delete[] _root_char;
+    return variants;
 }
 
-ACSlowState* ACSlowConstructor::new_state() {
-    ACSlowState* t = new ACSlowState(_next_node_id++);
-    _all_states.push_back(t);
-    return t;
-}
+}  // namespace
+
+// Case folding is compiled into the goto table so that matching stays a single pass. ASCII letters
+// are lowercased here and in the input (see `Fold_ASCII()`), which costs no extra states. Every
+// other codepoint with case variants branches the trie into one path per variant.
+void ACSlowConstructor::add_case_variants(std::string_view str,
+                                          int pattern_idx,
+                                          std::vector<Key>& keys) {
+    // The alternative byte sequences for each codepoint of the pattern.
+    std::vector<std::vector<std::string>> units;
+    size_t paths = 1;
+    for (size_t i = 0; i < str.length();) {
+        unicode::UTF8Decoder decoder;
+        size_t j = i;
+        do {
+            decoder.put(str[j++]);
+        } while (j < str.length() && !decoder.done() && !decoder.error());
+
+        auto& alts = units.emplace_back();
+
+        // Invalid UTF-8 is matched byte-for-byte.
+        if (!decoder.done()) {
+            alts.emplace_back(1, Fold_ASCII(str[i]));
+            ++i;
+            continue;
+        }
 
-void ACSlowConstructor::add_pattern(std::string_view str, int pattern_idx) {
-    ACSlowState* state = _root;
-    for (char c : str) {
-        ACSlowState* new_s = state->Get_Goto(c);
-        if (!new_s) {
-            new_s = new_state();
-            new_s->_depth = state->_depth + 1;
-            state->Set_Goto(c, new_s);
+        for (char32_t c : Case_Variants(decoder.value())) {
+            char utf8[unicode::kMaxBytesInUTF8Sequence];
+            size_t len = unicode::ToUTF8(c, utf8);
+            if (len == 1) utf8[0] = Fold_ASCII(utf8[0]);
+
+            std::string alt{utf8, len};
+            if (std::find(alts.begin(), alts.end(), alt) == alts.end()) {
+                alts.emplace_back(std::move(alt));
+            }
         }
-        state = new_s;
+        if (paths * alts.size() > kMaxCaseVariantPaths) {
+            alts.resize(std::min(alts.size(), 2_Z));
+        }
+        if (paths * alts.size() > kMaxCaseVariantPaths) {
+            alts.resize(1);
+        }
+        paths *= alts.size();
+        i = j;
     }
-    state->_is_terminal = true;
-    state->set_pattern_index(pattern_idx);
-}
 
-void ACSlowConstructor::propagate_faillink() {
-    ACSlowState* r = _root;
-    std::vector<ACSlowState*> wl;
-
-    const ACSlowGotoMap& m = r->goto_map();
-    for (auto i = m.begin(); i != m.end(); ++i) {
-        ACSlowState* s = i->second;
-        s->_fail_link = r;
-        wl.push_back(s);
+    std::vector<std::string> variants = {""};
+    for (const auto& alts : units) {
+        if (alts.size() == 1) {
+            for (auto& variant : variants) variant += alts[0];
+            continue;
+        }
+
+        std::vector<std::string> next_variants;
+        next_variants.reserve(variants.size() * alts.size());
+        for (const auto& variant : variants) {
+            for (const auto& alt : alts) next_variants.emplace_back(variant + alt);
+        }
+        variants = std::move(next_variants);
     }
 
-    // For any input c, make sure "goto(root, c)" is valid, which make the
-    // fail-link propagation lot easier.
-    ACSlowGotoMap goto_save = r->_goto_map;
-    for (uint32 i = 0; i <= 255; ++i) {
-        ACSlowState* s = r->Get_Goto(i);
-        if (!s) r->Set_Goto(i, r);
+    for (auto& variant : variants) {
+        keys.push_back({_variant_storage.emplace_back(std::move(variant)), pattern_idx});
     }
+}
 
-    for (uint32 i = 0; i < wl.size(); ++i) {
-        ACSlowState* s = wl[i];
-        ACSlowState* fl = s->_fail_link;
+void ACSlowConstructor::build_trie(std::vector<Key>& keys) {
+    // Sorting the keys makes each key share the path of the previous key up to their common
+    // prefix, and makes kids appear in ascending order of their input. The sort is stable so that
+    // the last of several identical patterns wins, like it would if they were inserted one by one.
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const Key& a, const Key& b) { return a.str < b.str; });
+
+    // Step 1: Build the trie in DFS order, linking the kids of each node in a list. Node 0 is the
+    // root, which is never a kid, so 0 also means "none".
+    struct Node {
+        uint32 first_kid = 0;
+        uint32 last_kid = 0;
+        uint32 next_sibling = 0;
+        InputTy input = 0;
+        int pattern_idx = -1;
+    };
+    std::vector<Node> nodes(1);
+    // path[d] is the node at depth d along the previous key.
+    std::vector<uint32> path = {0};
+    std::string_view prev;
+    for (const auto& key : keys) {
+        auto mismatch = std::mismatch(prev.begin(), prev.end(), key.str.begin(), key.str.end());
+        size_t common = mismatch.first - prev.begin();
+        path.resize(common + 1);
+
+        for (size_t d = common; d < key.str.length(); ++d) {
+            uint32 parent = path.back();
+            uint32 node = nodes.size();
+            nodes.push_back({.input = static_cast<InputTy>(key.str[d])});
+            if (nodes[parent].first_kid == 0) {
+                nodes[parent].first_kid = node;
+            } else {
+                nodes[nodes[parent].last_kid].next_sibling = node;
+            }
+            nodes[parent].last_kid = node;
+            path.push_back(node);
+        }
+        nodes[path.back()].pattern_idx = key.pattern_idx;
+        prev = key.str;
+    }
+
+    // Step 2: Renumber the nodes in BFS order, so that the kids of each state are consecutive.
+    _states.clear();
+    _gotos.clear();
+    _states.reserve(nodes.size());
+    _gotos.reserve(nodes.size() - 1);
+
+    std::vector<uint32> bfs_order = {0};
+    bfs_order.reserve(nodes.size());
+    _states.emplace_back(0);
+    for (uint32 id = 0; id < bfs_order.size(); ++id) {
+        const Node& node = nodes[bfs_order[id]];
+        uint32 first_goto = _gotos.size();
+        for (uint32 kid = node.first_kid; kid != 0; kid = nodes[kid].next_sibling) {
+            _gotos.push_back({nodes[kid].input, static_cast<uint32>(bfs_order.size())});
+            bfs_order.push_back(kid);
+            _states.emplace_back(_states[id]._depth + 1);
+        }
 
-        const ACSlowGotoMap& tran_map = s->goto_map();
+        ACSlowState& s = _states[id];
+        s._first_goto = first_goto;
+        s._goto_num = _gotos.size() - first_goto;
+        s._pattern_idx = node.pattern_idx;
+    }
+}
 
-        for (auto j = tran_map.begin(); j != tran_map.end(); ++j) {
-            InputTy c = j->first;
-            ACSlowState* tran = j->second;
+void ACSlowConstructor::propagate_faillink() {
+    // goto(root, c) is valid for any input c, so keep a dense table of it. The root is 0.
+    std::array<uint32, 256> root_goto{};
+    for (const auto& g : Get_Sorted_Gotos(root())) {
+        root_goto[g.input] = g.kid;
+    }
 
-            ACSlowState* tran_fl = 0;
-            for (ACSlowState* fl_walk = fl;;) {
-                if (ACSlowState* t = fl_walk->Get_Goto(c)) {
-                    tran_fl = t;
+    auto get_goto = [this](uint32 state, InputTy c) -> std::optional<uint32> {
+        auto gotos = Get_Sorted_Gotos(_states[state]);
+        auto it = std::lower_bound(gotos.begin(), gotos.end(), c,
+                                   [](const ACSlowGoto& g, InputTy c) { return g.input < c; });
+        if (it != gotos.end() && it->input == c) return it->kid;
+        return std::nullopt;
+    };
+
+    // States are numbered in BFS order, so a state's fail-link is always resolved before its kids.
+    // The root's kids keep their default fail-link to the root.
+    for (uint32 id = 1; id < _states.size(); ++id) {
+        uint32 fl = _states[id]._fail_link;
+        for (const auto& g : Get_Sorted_Gotos(_states[id])) {
+            uint32 fl_walk = fl;
+            while (true) {
+                if (fl_walk == 0) {
+                    _states[g.kid]._fail_link = root_goto[g.input];
+                    break;
+                } else if (auto t = get_goto(fl_walk, g.input)) {
+                    _states[g.kid]._fail_link = *t;
                     break;
                 } else {
-                    fl_walk = fl_walk->fail_link();
+                    fl_walk = _states[fl_walk]._fail_link;
                 }
             }
-
-            tran->_fail_link = tran_fl;
-            wl.push_back(tran);
         }
     }
-
-    // Remove "goto(root, c) == root" transitions
-    r->_goto_map = goto_save;
 }
 
-void ACSlowConstructor::Construct(const std::vector<std::string>& patterns) {
+void ACSlowConstructor::Construct(const std::vector<std::string>& patterns,
+                                  const SearchOptions& options) {
+    _options = options;
+
+    std::vector<Key> keys;
+    keys.reserve(patterns.size());
     for (size_t i = 0; i < patterns.size(); ++i) {
-        add_pattern(patterns[i], i);
+        if (options.case_insensitive) {
+            add_case_variants(patterns[i], i, keys);
+        } else {
+            keys.push_back({patterns[i], static_cast<int>(i)});
+        }
     }
 
+    build_trie(keys);
     propagate_faillink();
-    unsigned char* p = _root_char;
-
-    const ACSlowGotoMap& m = _root->goto_map();
-    for (auto i = m.begin(); i != m.end(); ++i) {
-        p[i->first] = 1;
-    }
 }
 
 }  // namespace base
@@ -1,10 +1,14 @@
 #pragma once
 
+#include "base/buffer/search_options.h"
+
 #include <algorithm>
 #include <cassert>
-#include <map>
+#include <deque>
+#include <span>
 #include <stdio.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <fmt/base.h>
@@ -17,105 +21,90 @@ using InputTy = unsigned char;
 
 namespace base {
 
-class ACSlowState;
+// Case-insensitive automata are built over, and fed with, ASCII-lowercased input.
+constexpr InputTy Fold_ASCII(InputTy c) {
+    return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
 
-using ACSlowGotoMap = std::map<InputTy, ACSlowState*>;
+// The "slow" AC graph is the intermediate form built from the patterns before it is converted
+// into the position-independent buffer (see ac_fast.h). All states live in one vector and are
+// numbered in BFS order, so state 0 is the root and the kids of each state have consecutive IDs.
+// The transitions of all states are stored in one flat vector, sorted by input within each state.
 
-using GotoPair = std::pair<InputTy, ACSlowState*>;
-using GotoVect = std::vector<GotoPair>;
+struct ACSlowGoto {
+    InputTy input;
+    uint32 kid;
+};
 
 class ACSlowState {
     friend class ACSlowConstructor;
 
 public:
-    ACSlowState(uint32 id)
-        : _id(id), _pattern_idx(-1), _depth(0), _is_terminal(false), _fail_link(0) {}
-    ~ACSlowState() {}
-
-    void Set_Goto(InputTy c, ACSlowState* s) {
-        _goto_map[c] = s;
-    }
-    ACSlowState* Get_Goto(InputTy c) const {
-        auto iter = _goto_map.find(c);
-        return iter != _goto_map.end() ? (*iter).second : 0;
-    }
+    ACSlowState(uint32 depth) : _depth(depth) {}
 
-    // Return all transitions sorted in the ascending order of their input.
-    void Get_Sorted_Gotos(GotoVect& gotos) const {
-        const ACSlowGotoMap& m = _goto_map;
-        gotos.clear();
-        for (auto i = m.begin(), e = m.end(); i != e; i++) {
-            gotos.emplace_back(i->first, i->second);
-        }
-        std::sort(gotos.begin(), gotos.end());
-    }
-
-    ACSlowState* fail_link() const {
+    uint32 fail_link() const {
         return _fail_link;
     }
     uint32 goto_num() const {
-        return _goto_map.size();
-    }
-    uint32 id() const {
-        return _id;
+        return _goto_num;
     }
     uint32 depth() const {
         return _depth;
     }
-    const ACSlowGotoMap& goto_map(void) const {
-        return _goto_map;
-    }
     bool is_terminal() const {
-        return _is_terminal;
+        return _pattern_idx >= 0;
     }
     int pattern_index() const {
-        assert(is_terminal() && _pattern_idx >= 0);
+        assert(is_terminal());
         return _pattern_idx;
     }
 
 private:
-    uint32 _id;
-    int _pattern_idx;
-    short _depth;
-    bool _is_terminal;
-    ACSlowGotoMap _goto_map;
-    ACSlowState* _fail_link;
-
-    void set_pattern_index(int idx) {
-        assert(is_terminal());
-        _pattern_idx = idx;
-    }
+    uint32 _first_goto = 0;
+    uint32 _goto_num = 0;
+    uint32 _fail_link = 0;
+    int _pattern_idx = -1;
+    uint32 _depth;
 };
 
 class ACSlowConstructor {
 public:
-    ACSlowConstructor();
-    ~ACSlowConstructor();
+    void Construct(const std::vector<std::string>& patterns, const SearchOptions& options = {});
 
-    void Construct(const std::vector<std::string>& patterns);
-
-    const ACSlowState* root() const {
-        return _root;
+    const ACSlowState& root() const {
+        return _states[0];
     }
-    const std::vector<ACSlowState*>& all_states() const {
-        return _all_states;
+    const SearchOptions& options() const {
+        return _options;
     }
-
-    uint32 next_node_id() const {
-        return _next_node_id;
+    const std::vector<ACSlowState>& all_states() const {
+        return _states;
     }
     uint32 state_num() const {
-        return _next_node_id - 1;
+        return _states.size();
+    }
+
+    // Return all transitions of `s` sorted in the ascending order of their input.
+    std::span<const ACSlowGoto> Get_Sorted_Gotos(const ACSlowState& s) const {
+        return {_gotos.data() + s._first_goto, s._goto_num};
     }
 
 private:
-    ACSlowState* _root;
-    std::vector<ACSlowState*> _all_states;
-    unsigned char* _root_char;
-    uint32 _next_node_id;
+    // A pattern, or one case variant of it, to be inserted into the trie.
+    struct Key {
+        std::string_view str;
+        int pattern_idx;
+    };
+
+    std::vector<ACSlowState> _states;
+    std::vector<ACSlowGoto> _gotos;
+    SearchOptions _options;
+
+    // Owns the case variant strings referenced by `Key`. A deque doesn't move its elements.
+    std::deque<std::string> _variant_storage;
 
-    void add_pattern(std::string_view str, int pattern_idx);
-    ACSlowState* new_state();
+    void add_case_variants(std::string_view str, int pattern_idx, std::vector<Key>& keys);
+    void build_trie(std::vector<Key>& keys);
     void propagate_faillink();
 };
 
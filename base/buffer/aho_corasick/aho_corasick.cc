@@ -2,8 +2,11 @@
 
 #include "ac_fast.h"
 #include "ac_slow.h"
+#include "teddy.h"
+#include "base/containers/lru_cache.h"
+#include "base/hash/hash.h"
 
-#include <fmt/base.h>
+#include <mutex>
 
 namespace base {
 
@@ -22,32 +25,102 @@ public:
     }
 };
 
-AhoCorasick::AhoCorasick(const std::vector<std::string>& patterns) {
-    if (patterns.size() >= 65535) {
-        // TODO: Currently we use 16-bit to encode pattern-index (see the comment to
-        // AC_State::is_term), therefore we are not able to handle pattern set with more than 65535
-        // entries.
-        fmt::println("Error: Pattern limit of 65535 exceeded in AhoCorasick constructor.");
-        std::abort();
+namespace {
+
+// The total size of the compiled automata kept alive between searches. This bounds memory rather
+// than the number of automata, so that a huge pattern set doesn't stay pinned.
+constexpr size_t kCompiledCacheBytes = 16 * 1024 * 1024;
+
+// Automata are cached by a hash of their patterns and options, so that a lookup doesn't copy the
+// patterns. They are compared only when the hashes match.
+struct CachedAutomaton {
+    std::vector<std::string> patterns;
+    SearchOptions options;
+    std::shared_ptr<ACBuffer> buf;
+};
+
+size_t HashPatterns(const std::vector<std::string>& patterns, const SearchOptions& options) {
+    size_t hash = options.case_insensitive | options.whole_word << 1;
+    for (const auto& pattern : patterns) {
+        hash = hash_combine(hash, hash_string(pattern));
     }
+    return hash;
+}
 
+std::shared_ptr<ACBuffer> Compile(const std::vector<std::string>& patterns,
+                                  const SearchOptions& options) {
     ACSlowConstructor acc;
-    acc.Construct(patterns);
+    acc.Construct(patterns, options);
 
     BufAlloc ba;
     ACConverter cvt(acc, ba);
-    ACBuffer* buf = cvt.Convert();
-    this->buf = (void*)buf;
+    return std::shared_ptr<ACBuffer>(cvt.Convert(), BufAlloc::myfree);
+}
+
+}  // namespace
+
+AhoCorasick::AhoCorasick(const std::vector<std::string>& patterns,
+                         const SearchOptions& options,
+                         Backend backend) {
+    // Teddy's tables are built in microseconds, so they aren't cached.
+    bool use_teddy = backend == Backend::kTeddy ? Teddy::Is_Supported(patterns, options)
+                     : backend == Backend::kAuto ? Teddy::Is_Preferred(patterns, options)
+                                                 : false;
+    if (use_teddy) {
+        teddy = std::make_shared<const Teddy>(patterns, options);
+        return;
+    }
+
+    static std::mutex cache_mutex;
+    static LRUCache<size_t, CachedAutomaton> cache(kCompiledCacheBytes);
+
+    size_t hash = HashPatterns(patterns, options);
+    {
+        std::lock_guard lock(cache_mutex);
+        auto* cached = cache.get(hash);
+        if (cached && cached->options == options && cached->patterns == patterns) {
+            buf = cached->buf;
+            return;
+        }
+    }
+
+    // Compile outside of the lock. If another thread compiles the same automaton concurrently,
+    // the last one to finish wins the cache slot. A hash collision replaces the other automaton.
+    buf = Compile(patterns, options);
+
+    std::lock_guard lock(cache_mutex);
+    cache.put(hash, {patterns, options, buf}, buf->buf_len);
+}
+
+AhoCorasick::MatchResult AhoCorasick::match(const PieceTree& tree,
+                                            size_t start,
+                                            size_t end) const {
+    if (teddy) return teddy->Match(tree, start, end);
+    return Match(buf.get(), tree, start, end);
 }
 
-AhoCorasick::~AhoCorasick() {
-    ACBuffer* buf = (ACBuffer*)this->buf;
-    BufAlloc::myfree(buf);
+void AhoCorasick::match_all(const PieceTree& tree,
+                            size_t start,
+                            size_t end,
+                            const std::function<void(const MatchResult&)>& callback) const {
+    if (teddy) {
+        teddy->Match_All(tree, start, end, callback);
+    } else {
+        Match_All(buf.get(), tree, start, end, callback);
+    }
+}
+
+void AhoCorasick::match_all(std::string_view text,
+                            const std::function<void(const MatchResult&)>& callback) const {
+    if (teddy) {
+        teddy->Match_All(text, callback);
+    } else {
+        Match_All(buf.get(), text, callback);
+    }
 }
 
-AhoCorasick::MatchResult AhoCorasick::match(const PieceTree& tree) const {
-    ACBuffer* buf = (ACBuffer*)this->buf;
-    return Match(buf, tree);
+AhoCorasick::Backend AhoCorasick::backend() const {
+    return teddy ? Backend::kTeddy : Backend::kAutomaton;
 }
 
 }  // namespace base
@@ -1,17 +1,36 @@
 #pragma once
 
 #include "base/buffer/piece_tree.h"
+#include "base/buffer/search_options.h"
 
+#include <functional>
+#include <limits>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace base {
 
+struct ACBuffer;
+class Teddy;
+
 class AhoCorasick {
 public:
-    AhoCorasick(const std::vector<std::string>& patterns);
-    ~AhoCorasick();
-    // TODO: Implement rule of five.
+    enum class Backend {
+        // Teddy for small sets of literals where it is supported, and the automaton otherwise.
+        kAuto,
+        kAutomaton,
+        // Packed SIMD matching (see teddy.h). Falls back to the automaton where it is unsupported,
+        // e.g., for case-insensitive searches.
+        kTeddy,
+    };
+
+    // Compiled automata are shared through a process-wide LRU cache keyed by the patterns and
+    // options, so repeating a search (e.g., search-as-you-type) doesn't rebuild the automaton.
+    AhoCorasick(const std::vector<std::string>& patterns,
+                const SearchOptions& options = {},
+                Backend backend = Backend::kAuto);
 
     /* If the subject-string doesn't match any of the given patterns, "match_begin"
      * should be a negative; otherwise the substring of the subject-string,
@@ -26,11 +45,30 @@ public:
         int pattern_idx;
     };
 
-    MatchResult match(const PieceTree& tree) const;
+    // Returns the match that ends first, and the longest of those that end at the same offset.
+    // Both backends agree on it. Only matches that lie entirely within [start, end) are reported.
+    MatchResult match(const PieceTree& tree, size_t start = 0, size_t end = kEnd) const;
+
+    // Reports every match within [start, end), including overlapping ones, in order of their
+    // `match_end`.
+    void match_all(const PieceTree& tree,
+                   size_t start,
+                   size_t end,
+                   const std::function<void(const MatchResult&)>& callback) const;
+    // Like above, but over a contiguous span, e.g., a memory-mapped file.
+    void match_all(std::string_view text,
+                   const std::function<void(const MatchResult&)>& callback) const;
+
+    // Returns the backend in use, which is never `kAuto`.
+    Backend backend() const;
+
+    static constexpr size_t kEnd = std::numeric_limits<size_t>::max();
 
 private:
-    // TODO: Clean this up. Don't use an opaque void pointer.
-    void* buf;
+    // Immutable once compiled; shared with the cache and any copies of this object. Exactly one of
+    // these is set.
+    std::shared_ptr<ACBuffer> buf;
+    std::shared_ptr<const Teddy> teddy;
 };
 
 }  // namespace base
@@ -1,9 +1,13 @@
 #include <gtest/gtest.h>
 
 #include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/numeric/literals.h"
 
 // TODO: Debug use; remove this.
 #include "util/profile_util.h"
+#include "util/random_util.h"
+
+#include <fmt/format.h>
 
 namespace base {
 
@@ -113,4 +117,60 @@ TEST(AhoCorasickPerfTest, VariousIterationTests) {
     pf6.stop_mili();
 }
 
+// Dictionary-style searches (e.g., identifier lists) are dominated by construction time.
+TEST(AhoCorasickPerfTest, Construction) {
+    for (size_t pattern_count : {1000, 10000, 100000}) {
+        std::vector<std::string> patterns;
+        for (size_t i = 0; i < pattern_count; ++i) {
+            patterns.emplace_back(util::RandomString(util::RandomNumber(8, 24)));
+        }
+
+        auto name = fmt::format("Aho-Corasick construction ({} patterns)", pattern_count);
+        auto pf = util::Profiler{name};
+        AhoCorasick{patterns};
+        pf.stop_micro();
+    }
+}
+
+// Repeated searches with the same patterns should hit the compiled automaton cache.
+TEST(AhoCorasickPerfTest, CachedConstruction) {
+    std::vector<std::string> patterns;
+    for (size_t i = 0; i < 1000; ++i) {
+        patterns.emplace_back(util::RandomString(16));
+    }
+
+    auto pf1 = util::Profiler{"Aho-Corasick construction (cold)"};
+    AhoCorasick{patterns};
+    pf1.stop_micro();
+
+    auto pf2 = util::Profiler{"Aho-Corasick construction (cached)"};
+    AhoCorasick{patterns};
+    pf2.stop_micro();
+}
+
+// Small sets of short literals, e.g., log levels, are where Teddy beats the automaton.
+TEST(AhoCorasickPerfTest, SmallPatternSets) {
+    const std::vector<std::string> kLevels = {"TRACE", "DEBUG", "INFO", "NOTICE",
+                                              "WARN",  "ERROR", "FATAL", "PANIC"};
+    std::string str;
+    for (size_t i = 0; i < 500000; ++i) {
+        str += util::RandomString(80);
+        str += i % 100 == 0 ? kLevels[i / 100 % kLevels.size()] : "";
+        str += '\n';
+    }
+    PieceTree tree{str};
+
+    for (auto backend : {AhoCorasick::Backend::kAutomaton, AhoCorasick::Backend::kTeddy}) {
+        AhoCorasick ac(kLevels, {}, backend);
+        size_t count = 0;
+        auto name = fmt::format("{} match_all (8 patterns, 40 MB)",
+                                ac.backend() == AhoCorasick::Backend::kTeddy ? "Teddy"
+                                                                             : "Aho-Corasick");
+        auto pf = util::Profiler{name};
+        ac.match_all(tree, 0, tree.length(), [&](const MatchResult&) { ++count; });
+        pf.stop_mili();
+        EXPECT_GE(count, 5000_Z);
+    }
+}
+
 }  // namespace base
@@ -12,18 +12,6 @@ using MatchResult = AhoCorasick::MatchResult;
 
 namespace {
 
-MatchResult MatchPattern(const PieceTree& tree, std::string_view pattern) {
-    AhoCorasick ac({std::string(pattern)});
-    auto result = ac.match(tree);
-    return result;
-}
-
-MatchResult MatchDict(const PieceTree& tree, const std::vector<std::string>& dict) {
-    AhoCorasick ac(dict);
-    auto result = ac.match(tree);
-    return result;
-}
-
 void CheckResult(const MatchResult& r,
                  std::string_view str,
                  const std::optional<std::string_view>& expected) {
@@ -52,25 +40,84 @@ void CheckResult(const MatchResult& r,
     }
 }
 
-void CheckRandom(std::string_view str) {
-    size_t i = util::RandomNumber(0, str.length() - 1);
-    size_t len = util::RandomNumber(1, str.length());
-    std::string_view pattern = str.substr(i, len);
+struct StrPair {
+    std::string str;
+    std::optional<std::string> match;
+};
 
-    PieceTree tree{str};
-    auto result = MatchPattern(tree, pattern);
-    CheckResult(result, str, pattern);
+using Dict = std::vector<std::string>;
+using StrPairs = std::vector<StrPair>;
+
+struct StrOffset {
+    std::string str;
+    int match_begin;
+};
+
+using StrOffsets = std::vector<StrOffset>;
+
+std::string BackendName(const testing::TestParamInfo<AhoCorasick::Backend>& info) {
+    return info.param == AhoCorasick::Backend::kTeddy ? "Teddy" : "Automaton";
 }
+
 }  // namespace
 
-TEST(AhoCorasickTest, RandomTest) {
+// Every test runs against both backends. Teddy falls back to the automaton where it is
+// unsupported, e.g., for case-insensitive searches.
+class AhoCorasickTest : public testing::TestWithParam<AhoCorasick::Backend> {
+protected:
+    MatchResult MatchPattern(const PieceTree& tree, std::string_view pattern) {
+        AhoCorasick ac({std::string(pattern)}, {}, GetParam());
+        auto result = ac.match(tree);
+        return result;
+    }
+
+    void CheckRandom(std::string_view str) {
+        size_t i = util::RandomNumber(0, str.length() - 1);
+        size_t len = util::RandomNumber(1, str.length());
+        std::string_view pattern = str.substr(i, len);
+
+        PieceTree tree{str};
+        auto result = MatchPattern(tree, pattern);
+        CheckResult(result, str, pattern);
+    }
+
+    void TestCase(const StrPairs& str_pairs, const Dict& dict, const SearchOptions& options = {}) {
+        for (const auto& [str, expected] : str_pairs) {
+            PieceTree tree{str};
+            AhoCorasick ac(dict, options, GetParam());
+            auto result = ac.match(tree);
+            CheckResult(result, str, expected);
+        }
+    }
+
+    // Unlike `TestCase()`, this works when the expected match isn't the first occurrence of its
+    // text.
+    void TestOffsets(const StrOffsets& str_offsets,
+                     const Dict& dict,
+                     const SearchOptions& options) {
+        AhoCorasick ac(dict, options, GetParam());
+        for (const auto& [str, match_begin] : str_offsets) {
+            PieceTree tree{str};
+            auto result = ac.match(tree);
+            EXPECT_EQ(result.match_begin, match_begin) << "str = " << str;
+        }
+    }
+};
+
+INSTANTIATE_TEST_SUITE_P(Backends,
+                         AhoCorasickTest,
+                         testing::Values(AhoCorasick::Backend::kAutomaton,
+                                         AhoCorasick::Backend::kTeddy),
+                         BackendName);
+
+TEST_P(AhoCorasickTest, RandomTest) {
     std::string str = "hello world!";
     for (int i = 0; i < 100; ++i) {
         CheckRandom(str);
     }
 }
 
-TEST(AhoCorasickTest, RandomCharTest) {
+TEST_P(AhoCorasickTest, RandomCharTest) {
     // This string contains chars of *any* value. This is not necessarily valid Unicode.
     auto random_char_str = []() {
         std::string str;
@@ -83,86 +130,68 @@ TEST(AhoCorasickTest, RandomCharTest) {
     }
 }
 
-namespace {
-struct StrPair {
-    std::string str;
-    std::optional<std::string> match;
-};
-
-using Dict = std::vector<std::string>;
-using StrPairs = std::vector<StrPair>;
-
-void TestCase(const StrPairs& str_pairs, const Dict& dict) {
-    for (const auto& [str, expected] : str_pairs) {
-        PieceTree tree{str};
-        auto result = MatchDict(tree, dict);
-        CheckResult(result, str, expected);
-    }
-}
-}  // namespace
-
-TEST(AhoCorasickTest, Test1) {
+TEST_P(AhoCorasickTest, Test1) {
     Dict dict = {"he", "she", "his", "her"};
     StrPairs str_pairs = {{"he", "he"},  {"she", "she"}, {"his", "his"},   {"hers", "he"},
                           {"ahe", "he"}, {"shhe", "he"}, {"shis2", "his"}, {"ahhe", "he"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test2) {
+TEST_P(AhoCorasickTest, Test2) {
     Dict dict = {"poto", "poto"};
     StrPairs str_pairs = {{"The pot had a handle", std::nullopt}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test3) {
+TEST_P(AhoCorasickTest, Test3) {
     Dict dict = {"The"};
     StrPairs str_pairs = {{"The pot had a handle", "The"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test4) {
+TEST_P(AhoCorasickTest, Test4) {
     Dict dict = {"pot"};
     StrPairs str_pairs = {{"The pot had a handle", "pot"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test5) {
+TEST_P(AhoCorasickTest, Test5) {
     Dict dict = {"pot "};
     StrPairs str_pairs = {{"The pot had a handle", "pot "}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test6) {
+TEST_P(AhoCorasickTest, Test6) {
     Dict dict = {"ot h"};
     StrPairs str_pairs = {{"The pot had a handle", "ot h"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test7) {
+TEST_P(AhoCorasickTest, Test7) {
     Dict dict = {"andle"};
     StrPairs str_pairs = {{"The pot had a handle", "andle"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test8) {
+TEST_P(AhoCorasickTest, Test8) {
     Dict dict = {"aaab"};
     StrPairs str_pairs = {{"aaaaaaab", "aaab"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test9) {
+TEST_P(AhoCorasickTest, Test9) {
     Dict dict = {"haha", "z"};
     StrPairs str_pairs = {{"aaaaz", "z"}, {"z", "z"}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test10) {
+TEST_P(AhoCorasickTest, Test10) {
     Dict dict = {"abc"};
     StrPairs str_pairs = {{"cde", std::nullopt}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test11) {
+TEST_P(AhoCorasickTest, Test11) {
     Dict dict = {"‼️", "ØØ"};
     StrPairs str_pairs = {
         {"hello‼️", "‼️"},
@@ -173,7 +202,7 @@ TEST(AhoCorasickTest, Test11) {
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test12) {
+TEST_P(AhoCorasickTest, Test12) {
     Dict dict = {"abc﷽def"};
     StrPairs str_pairs = {
         {"hello﷽worldabc﷽abc﷽def", "abc﷽def"},
@@ -184,16 +213,201 @@ TEST(AhoCorasickTest, Test12) {
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test13) {
+TEST_P(AhoCorasickTest, Test13) {
     Dict dict = {""};
     StrPairs str_pairs = {{"", std::nullopt}, {"abc", std::nullopt}};
     TestCase(str_pairs, dict);
 }
 
-TEST(AhoCorasickTest, Test14) {
+TEST_P(AhoCorasickTest, Test14) {
     Dict dict = {"3"};
     StrPairs str_pairs = {{"abc123", "3"}, {"3", "3"}};
     TestCase(str_pairs, dict);
 }
 
+TEST_P(AhoCorasickTest, CaseSensitiveByDefault) {
+    Dict dict = {"Hello"};
+    StrPairs str_pairs = {{"HELLO hello", std::nullopt}, {"Hello", "Hello"}};
+    TestCase(str_pairs, dict);
+}
+
+TEST_P(AhoCorasickTest, CaseInsensitiveASCII) {
+    Dict dict = {"Hello", "wORLD"};
+    StrPairs str_pairs = {
+        {"say HELLO", "HELLO"}, {"hello", "hello"}, {"HeLlO world", "HeLlO"},
+        {"help", std::nullopt}, {"World", "World"}, {"[{@`", std::nullopt},
+    };
+    TestCase(str_pairs, dict, {.case_insensitive = true});
+}
+
+TEST_P(AhoCorasickTest, CaseInsensitiveUnicode) {
+    StrPairs str_pairs1 = {{"äöü", "äöü"}, {"ÄöÜ", "ÄöÜ"}, {"aou", std::nullopt}};
+    TestCase(str_pairs1, {"ÄÖÜ"}, {.case_insensitive = true});
+
+    // Variants don't always have the same UTF-8 length, or even the same lead byte.
+    StrPairs str_pairs2 = {{"ПРИВЕТ", "ПРИВЕТ"}, {"привет", "привет"}, {"ΟΔΟΣ", std::nullopt}};
+    TestCase(str_pairs2, {"Привет"}, {.case_insensitive = true});
+
+    // Final sigma folds to sigma.
+    StrPairs str_pairs3 = {{"οδος", "οδος"}, {"ΟΔΟΣ", "ΟΔΟΣ"}, {"οδοσ", "οδοσ"}};
+    TestCase(str_pairs3, {"Οδος"}, {.case_insensitive = true});
+
+    // The Kelvin sign folds to ASCII 'k'.
+    StrPairs str_pairs4 = {{"5 \u212A", "\u212A"}, {"K", "K"}, {"k", "k"}};
+    TestCase(str_pairs4, {"k"}, {.case_insensitive = true});
+}
+
+TEST_P(AhoCorasickTest, CaseInsensitiveManyVariants) {
+    // The number of trie paths is capped, so this must still construct quickly and match.
+    std::string pattern = "ÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜÄÖÜ";
+    StrPairs str_pairs = {{"x" + pattern + "x", pattern}};
+    TestCase(str_pairs, {pattern}, {.case_insensitive = true});
+}
+
+TEST_P(AhoCorasickTest, WholeWord) {
+    Dict dict = {"foo"};
+    StrOffsets str_offsets = {
+        {"foo", 0},       {"foobar", -1},    {"a foo b", 2},    {"_foo", -1},
+        {"foo.bar", 0},   {"foobar foo", 7}, {"xfoo\nfoo", 5}, {"ñfoo foo", 6},
+        {"foo1 2foo", -1},
+    };
+    TestOffsets(str_offsets, dict, {.whole_word = true});
+}
+
+TEST_P(AhoCorasickTest, WholeWordPunctuation) {
+    // Boundaries are only required where the pattern itself starts or ends with a word character.
+    TestOffsets({{"a+b", 1}, {"a++b", 1}}, {"+"}, {.whole_word = true});
+    TestOffsets({{"xa+b a+", 5}}, {"a+"}, {.whole_word = true});
+}
+
+TEST_P(AhoCorasickTest, WholeWordShorterPattern) {
+    // "a-foo" is rejected, but "foo" ends at the same offset and is a whole word.
+    TestOffsets({{"ba-foo", 3}}, {"a-foo", "foo"}, {.whole_word = true});
+}
+
+TEST_P(AhoCorasickTest, CaseInsensitiveWholeWord) {
+    TestOffsets({{"FOOD foo", 5}, {"Foo", 0}}, {"fOO"},
+                {.case_insensitive = true, .whole_word = true});
+}
+
+// A shorter pattern inside a longer one ends first, even though the automaton is still matching
+// the longer one when it ends.
+TEST_P(AhoCorasickTest, ShorterPatternEndsFirst) {
+    PieceTree tree{"xabcdx"};
+    AhoCorasick ac({"abcd", "bc"}, {}, GetParam());
+    auto result = ac.match(tree);
+    EXPECT_EQ(result.match_begin, 2);
+    EXPECT_EQ(result.match_end, 3);
+    EXPECT_EQ(result.pattern_idx, 1);
+
+    std::vector<std::pair<int, int>> actual;
+    ac.match_all(tree, 0, tree.length(), [&](const MatchResult& r) {
+        actual.emplace_back(r.match_begin, r.pattern_idx);
+    });
+    EXPECT_EQ(actual, (std::vector<std::pair<int, int>>{{2, 1}, {1, 0}}));
+}
+
+// Matching a contiguous span must agree with matching a tree of the same text.
+TEST_P(AhoCorasickTest, MatchAllSpan) {
+    std::string str = "foo bar_foo foobar\nfoo ñfoo foo";
+    PieceTree tree{str};
+    for (const SearchOptions& options : {SearchOptions{}, SearchOptions{.whole_word = true}}) {
+        AhoCorasick ac({"foo", "bar"}, options, GetParam());
+        std::vector<std::pair<int, int>> expected;
+        ac.match_all(tree, 0, tree.length(), [&](const MatchResult& r) {
+            expected.emplace_back(r.match_begin, r.pattern_idx);
+        });
+        std::vector<std::pair<int, int>> actual;
+        ac.match_all(str, [&](const MatchResult& r) {
+            actual.emplace_back(r.match_begin, r.pattern_idx);
+        });
+        EXPECT_FALSE(expected.empty());
+        EXPECT_EQ(actual, expected);
+    }
+}
+
+// A pattern that is a suffix of others is reported once, not once per longer pattern.
+TEST_P(AhoCorasickTest, MatchAllNestedPatterns) {
+    PieceTree tree{"x off_set"};
+    AhoCorasick ac({"off_set", "set", "t", "off"}, {}, GetParam());
+    std::vector<std::pair<int, int>> actual;
+    ac.match_all(tree, 0, tree.length(), [&](const MatchResult& r) {
+        actual.emplace_back(r.match_begin, r.pattern_idx);
+    });
+    EXPECT_EQ(actual, (std::vector<std::pair<int, int>>{{2, 3}, {2, 0}, {6, 1}, {8, 2}}));
+}
+
+TEST(AhoCorasickBackendTest, Selection) {
+    // The automaton handles everything that Teddy doesn't.
+    EXPECT_EQ(AhoCorasick({"foo", "bar"}, {.case_insensitive = true}).backend(),
+              AhoCorasick::Backend::kAutomaton);
+    EXPECT_EQ(AhoCorasick({"foo", "bar"}, {}, AhoCorasick::Backend::kAutomaton).backend(),
+              AhoCorasick::Backend::kAutomaton);
+    EXPECT_EQ(AhoCorasick({""}, {}, AhoCorasick::Backend::kTeddy).backend(),
+              AhoCorasick::Backend::kAutomaton);
+
+    Dict many;
+    for (int i = 0; i < 1000; ++i) many.emplace_back(util::RandomString(8));
+    EXPECT_EQ(AhoCorasick(many).backend(), AhoCorasick::Backend::kAutomaton);
+}
+
+// Compares Teddy against a brute-force search on trees with many small pieces, so that matches
+// span pieces.
+TEST(AhoCorasickBackendTest, TeddyRandomDicts) {
+    for (int n = 0; n < 50; ++n) {
+        std::string str;
+        PieceTree tree;
+        for (size_t i = 0; i < 100; ++i) {
+            std::string text;
+            for (size_t len = util::RandomNumber(1, 20); len > 0; --len) {
+                text += static_cast<char>(util::RandomNumber('a', 'c'));
+            }
+            size_t offset = util::RandomNumber(0, str.length());
+            str.insert(offset, text);
+            tree.insert(offset, text);
+        }
+
+        Dict dict;
+        for (size_t i = util::RandomNumber(1, 20); i > 0; --i) {
+            size_t begin = util::RandomNumber(0, str.length() - 1);
+            size_t len = util::RandomNumber(1, 12);
+            dict.emplace_back(i % 3 == 0 ? util::RandomString(len) : str.substr(begin, len));
+        }
+        AhoCorasick ac(dict, {}, AhoCorasick::Backend::kTeddy);
+        if (ac.backend() != AhoCorasick::Backend::kTeddy) GTEST_SKIP() << "Teddy is unsupported";
+
+        // Every match, ordered by its end and then longest first. The last of several identical
+        // patterns wins.
+        std::vector<std::tuple<int, int, int>> expected;
+        for (size_t i = 0; i < dict.size(); ++i) {
+            if (std::find(dict.begin() + i + 1, dict.end(), dict[i]) != dict.end()) continue;
+            for (size_t pos = str.find(dict[i]); pos != std::string::npos;
+                 pos = str.find(dict[i], pos + 1)) {
+                int end = pos + dict[i].length() - 1;
+                expected.emplace_back(end, pos, i);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+
+        std::vector<std::tuple<int, int, int>> actual;
+        ac.match_all(tree, 0, tree.length(), [&](const MatchResult& r) {
+            actual.emplace_back(r.match_end, r.match_begin, r.pattern_idx);
+        });
+        ASSERT_EQ(actual, expected);
+
+        // Both backends return the first match.
+        AhoCorasick automaton(dict, {}, AhoCorasick::Backend::kAutomaton);
+        for (const auto& result : {ac.match(tree), automaton.match(tree)}) {
+            if (expected.empty()) {
+                EXPECT_EQ(result.match_begin, -1);
+            } else {
+                auto [end, begin, idx] = expected.front();
+                EXPECT_EQ(result.match_begin, begin);
+                EXPECT_EQ(result.match_end, end);
+                EXPECT_EQ(result.pattern_idx, idx);
+            }
+        }
+    }
+}
+
 }  // namespace base
@@ -0,0 +1,297 @@
+#include "teddy.h"
+
+#include "ac_fast.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TEDDY_SSSE3
+#include <tmmintrin.h>
+#elif defined(__aarch64__)
+#define TEDDY_NEON
+#include <arm_neon.h>
+#endif
+
+namespace base {
+
+namespace {
+
+constexpr size_t kBlockSize = 16;
+// Pieces are scanned in slices of this size, so that the hits of a slice are sorted cheaply.
+constexpr size_t kSliceSize = 64 * 1024;
+// Beyond this many patterns, the buckets get crowded and verification dominates.
+constexpr size_t kMaxPreferredPatterns = 32;
+// With a single-byte fingerprint, any occurrence of a common byte becomes a candidate.
+constexpr size_t kMinPreferredLength = 2;
+
+// Returns the positions in the block at `data` where a pattern could start, and stores the
+// candidate buckets of each position in `buckets`. Position `i` is bit `i * kLaneStride`.
+#if defined(TEDDY_SSSE3)
+constexpr int kLaneStride = 1;
+
+bool Has_Shuffle() {
+    static const bool has_shuffle = __builtin_cpu_supports("ssse3");
+    return has_shuffle;
+}
+
+// SSSE3 isn't part of the x86-64 baseline, so it is only enabled for this function and guarded
+// by `Has_Shuffle()` at runtime.
+__attribute__((target("ssse3"))) uint64_t Block_Candidates(const Teddy::Masks& masks,
+                                                            const char* data,
+                                                            unsigned char* buckets) {
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    __m128i res = _mm_set1_epi8(-1);
+    for (size_t k = 0; k < masks.fingerprint_len; ++k) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + k));
+        __m128i lo = _mm_and_si128(block, nibble_mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(block, 4), nibble_mask);
+        __m128i lo_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.lo[k].data()));
+        __m128i hi_table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.hi[k].data()));
+        res = _mm_and_si128(res, _mm_and_si128(_mm_shuffle_epi8(lo_table, lo),
+                                               _mm_shuffle_epi8(hi_table, hi)));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(buckets), res);
+    int zero = _mm_movemask_epi8(_mm_cmpeq_epi8(res, _mm_setzero_si128()));
+    return ~zero & 0xFFFF;
+}
+#elif defined(TEDDY_NEON)
+constexpr int kLaneStride = 4;
+
+bool Has_Shuffle() {
+    return true;
+}
+
+uint64_t Block_Candidates(const Teddy::Masks& masks, const char* data, unsigned char* buckets) {
+    const uint8x16_t nibble_mask = vdupq_n_u8(0x0F);
+    uint8x16_t res = vdupq_n_u8(0xFF);
+    for (size_t k = 0; k < masks.fingerprint_len; ++k) {
+        uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(data + k));
+        uint8x16_t lo = vandq_u8(block, nibble_mask);
+        uint8x16_t hi = vshrq_n_u8(block, 4);
+        res = vandq_u8(res, vandq_u8(vqtbl1q_u8(vld1q_u8(masks.lo[k].data()), lo),
+                                     vqtbl1q_u8(vld1q_u8(masks.hi[k].data()), hi)));
+    }
+    vst1q_u8(buckets, res);
+    // NEON has no movemask, so narrow each byte to a nibble instead.
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(vtstq_u8(res, res)), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x1111111111111111;
+}
+#else
+bool Has_Shuffle() {
+    return false;
+}
+#endif
+
+// Yields the text in [start, end) in contiguous chunks, like `TreeWalker::next_chunk()`.
+class SpanChunks {
+public:
+    SpanChunks(std::string_view text, size_t start) : rest{text.substr(start)} {}
+
+    std::string_view next_chunk() {
+        return std::exchange(rest, {});
+    }
+
+private:
+    std::string_view rest;
+};
+
+TreeWalker Make_Chunks(const PieceTree& tree, size_t start) {
+    return TreeWalker{&tree, start};
+}
+
+SpanChunks Make_Chunks(std::string_view text, size_t start) {
+    return SpanChunks{text, start};
+}
+
+}  // namespace
+
+bool Teddy::Is_Supported(const std::vector<std::string>& patterns, const SearchOptions& options) {
+    if (options.case_insensitive || !Has_Shuffle()) return false;
+    return std::ranges::any_of(patterns, [](const auto& p) { return !p.empty(); });
+}
+
+bool Teddy::Is_Preferred(const std::vector<std::string>& patterns, const SearchOptions& options) {
+    if (patterns.size() < 2 || patterns.size() > kMaxPreferredPatterns) return false;
+    auto too_short = [](const auto& p) { return p.length() < kMinPreferredLength; };
+    return !std::ranges::any_of(patterns, too_short) && Is_Supported(patterns, options);
+}
+
+Teddy::Teddy(const std::vector<std::string>& patterns, const SearchOptions& options)
+    : _patterns(patterns), _whole_word(options.whole_word) {
+    assert(Is_Supported(patterns, options));
+
+    // Empty patterns never match, and the last of several identical patterns wins, like in the
+    // automaton.
+    std::unordered_map<std::string_view, uint32> last_index;
+    for (uint32 i = 0; i < _patterns.size(); ++i) {
+        if (!_patterns[i].empty()) last_index[_patterns[i]] = i;
+    }
+    std::vector<uint32> ids;
+    for (const auto& [pattern, i] : last_index) ids.push_back(i);
+
+    _min_len = _patterns[ids.front()].length();
+    for (uint32 i : ids) {
+        _min_len = std::min(_min_len, _patterns[i].length());
+        _max_len = std::max(_max_len, _patterns[i].length());
+    }
+    _masks.fingerprint_len = std::min(_min_len, kMaxFingerprint);
+
+    // Patterns that share a prefix share a fingerprint, so putting them in the same bucket keeps
+    // the other buckets selective.
+    std::ranges::sort(ids, [this](uint32 a, uint32 b) { return _patterns[a] < _patterns[b]; });
+    for (size_t n = 0; n < ids.size(); ++n) {
+        size_t bucket = n * kBuckets / ids.size();
+        const std::string& pattern = _patterns[ids[n]];
+        _buckets[bucket].push_back(ids[n]);
+        for (size_t k = 0; k < _masks.fingerprint_len; ++k) {
+            auto c = static_cast<unsigned char>(pattern[k]);
+            _masks.lo[k][c & 0x0F] |= 1 << bucket;
+            _masks.hi[k][c >> 4] |= 1 << bucket;
+        }
+    }
+}
+
+AhoCorasick::MatchResult Teddy::Match(const PieceTree& tree, size_t start, size_t end) const {
+    AhoCorasick::MatchResult result = {-1, -1, -1};
+    Match_Impl(tree, start, end, [&result](const Hit& hit) {
+        result = {
+            .match_begin = static_cast<int>(hit.begin),
+            .match_end = static_cast<int>(hit.end - 1),
+            .pattern_idx = static_cast<int>(hit.pattern_idx),
+        };
+        return true;
+    });
+    return result;
+}
+
+void Teddy::Match_All(const PieceTree& tree,
+                      size_t start,
+                      size_t end,
+                      const std::function<void(const AhoCorasick::MatchResult&)>& callback) const {
+    Match_Impl(tree, start, end, [&callback](const Hit& hit) {
+        callback({
+            .match_begin = static_cast<int>(hit.begin),
+            .match_end = static_cast<int>(hit.end - 1),
+            .pattern_idx = static_cast<int>(hit.pattern_idx),
+        });
+        return false;
+    });
+}
+
+void Teddy::Match_All(std::string_view text,
+                      const std::function<void(const AhoCorasick::MatchResult&)>& callback) const {
+    Match_Impl(text, 0, text.length(), [&callback](const Hit& hit) {
+        callback({
+            .match_begin = static_cast<int>(hit.begin),
+            .match_end = static_cast<int>(hit.end - 1),
+            .pattern_idx = static_cast<int>(hit.pattern_idx),
+        });
+        return false;
+    });
+}
+
+template <typename Text>
+void Teddy::Match_Impl(const Text& text,
+                       size_t start,
+                       size_t end,
+                       const std::function<bool(const Hit&)>& on_match) const {
+    end = std::min(end, text.length());
+    if (start >= end) return;
+
+    // Every match is reported with the slice where it ends. Matches that span slices are found by
+    // joining the last `_max_len - 1` bytes before the slice with the head of the slice.
+    std::string carry;
+    std::string window;
+    std::vector<Hit> hits;
+    size_t offset = start;
+    auto chunks = Make_Chunks(text, start);
+    while (offset < end) {
+        std::string_view chunk = chunks.next_chunk();
+        if (chunk.empty()) break;
+        chunk = chunk.substr(0, end - offset);
+
+        for (size_t i = 0; i < chunk.length(); i += kSliceSize) {
+            std::string_view slice = chunk.substr(i, kSliceSize);
+            hits.clear();
+            if (!carry.empty()) {
+                window = carry;
+                window.append(slice.substr(0, _max_len - 1));
+                Scan(window, carry.length(), offset - carry.length(), hits);
+                // Matches that lie entirely within the carry were found in an earlier slice.
+                std::erase_if(hits, [offset](const Hit& hit) { return hit.end <= offset; });
+            }
+            Scan(slice, slice.length(), offset, hits);
+
+            // The automaton reports the longest match first when several end at the same offset.
+            std::ranges::sort(hits, [](const Hit& a, const Hit& b) {
+                return a.end != b.end ? a.end < b.end : a.begin < b.begin;
+            });
+            for (const Hit& hit : hits) {
+                if (_whole_word && !Is_Whole_Word(text, hit.begin, hit.end)) continue;
+                if (on_match(hit)) return;
+            }
+
+            if (slice.length() >= _max_len - 1) {
+                carry.assign(slice.substr(slice.length() - (_max_len - 1)));
+            } else {
+                carry.append(slice);
+                carry.erase(0, carry.length() - std::min(carry.length(), _max_len - 1));
+            }
+            offset += slice.length();
+        }
+    }
+}
+
+void Teddy::Scan(std::string_view text, size_t limit, size_t base, std::vector<Hit>& hits) const {
+    if (text.length() < _min_len) return;
+    limit = std::min(limit, text.length() - _min_len + 1);
+
+    const char* data = text.data();
+    size_t pos = 0;
+#if defined(TEDDY_SSSE3) || defined(TEDDY_NEON)
+    if (Has_Shuffle()) {
+        // A block reads `fingerprint_len - 1` bytes past its last position.
+        unsigned char buckets[kBlockSize];
+        for (; pos < limit && pos + kBlockSize + _masks.fingerprint_len - 1 <= text.length();
+             pos += kBlockSize) {
+            for (uint64_t lanes = Block_Candidates(_masks, data + pos, buckets); lanes != 0;
+                 lanes &= lanes - 1) {
+                size_t lane = std::countr_zero(lanes) / kLaneStride;
+                if (pos + lane >= limit) break;
+                Verify(text, pos + lane, buckets[lane], base, hits);
+            }
+        }
+    }
+#endif
+
+    for (; pos < limit; ++pos) {
+        unsigned buckets = 0xFF;
+        for (size_t k = 0; k < _masks.fingerprint_len; ++k) {
+            auto c = static_cast<unsigned char>(data[pos + k]);
+            buckets &= _masks.lo[k][c & 0x0F] & _masks.hi[k][c >> 4];
+        }
+        if (buckets != 0) Verify(text, pos, buckets, base, hits);
+    }
+}
+
+void Teddy::Verify(std::string_view text,
+                   size_t pos,
+                   unsigned buckets,
+                   size_t base,
+                   std::vector<Hit>& hits) const {
+    for (; buckets != 0; buckets &= buckets - 1) {
+        for (uint32 idx : _buckets[std::countr_zero(buckets)]) {
+            const std::string& pattern = _patterns[idx];
+            if (text.length() - pos >= pattern.length() &&
+                std::memcmp(text.data() + pos, pattern.data(), pattern.length()) == 0) {
+                hits.push_back({base + pos, base + pos + pattern.length(), idx});
+            }
+        }
+    }
+}
+
+}  // namespace base
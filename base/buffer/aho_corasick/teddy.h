@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ac_slow.h"
+#include "aho_corasick.h"
+
+#include <array>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace base {
+
+// Teddy is a packed SIMD matcher for small sets of literals, as used by Hyperscan and Rust's regex
+// crate. Patterns are spread over 8 buckets, and the first few bytes of every pattern are encoded
+// into nibble lookup tables with one bit per bucket. Each 16-byte block of text is reduced to the
+// positions and buckets where a pattern could start with a few shuffles, and only those
+// candidates are compared against the patterns of their buckets.
+//
+// Matches are reported with the same semantics as the automaton: `Match()` returns the match that
+// ends first, preferring the longest one, and `Match_All()` reports every match in order of their
+// end. Case-insensitive searches aren't supported.
+class Teddy {
+public:
+    // Returns false if the patterns can't be matched by Teddy, or the CPU lacks the shuffles.
+    static bool Is_Supported(const std::vector<std::string>& patterns,
+                             const SearchOptions& options);
+    // Returns true if Teddy is expected to beat the automaton for these patterns.
+    static bool Is_Preferred(const std::vector<std::string>& patterns,
+                             const SearchOptions& options);
+
+    Teddy(const std::vector<std::string>& patterns, const SearchOptions& options);
+
+    AhoCorasick::MatchResult Match(const PieceTree& tree, size_t start, size_t end) const;
+    void Match_All(const PieceTree& tree,
+                   size_t start,
+                   size_t end,
+                   const std::function<void(const AhoCorasick::MatchResult&)>& callback) const;
+    void Match_All(std::string_view text,
+                   const std::function<void(const AhoCorasick::MatchResult&)>& callback) const;
+
+    static constexpr size_t kBuckets = 8;
+    static constexpr size_t kMaxFingerprint = 3;
+
+    // The nibble tables for each fingerprint byte. Bit `b` of `lo[k][n]` is set if a pattern in
+    // bucket `b` has the low nibble `n` at offset `k`, and likewise for `hi`.
+    struct Masks {
+        alignas(16) std::array<std::array<unsigned char, 16>, kMaxFingerprint> lo{};
+        alignas(16) std::array<std::array<unsigned char, 16>, kMaxFingerprint> hi{};
+        size_t fingerprint_len = 0;
+    };
+
+private:
+    struct Hit {
+        size_t begin;
+        size_t end;
+        uint32 pattern_idx;
+    };
+
+    std::vector<std::string> _patterns;
+    std::array<std::vector<uint32>, kBuckets> _buckets;
+    Masks _masks;
+    size_t _min_len = 0;
+    size_t _max_len = 0;
+    bool _whole_word;
+
+    // Appends the matches in `text` that start before `limit`, offset by `base`.
+    void Scan(std::string_view text, size_t limit, size_t base, std::vector<Hit>& hits) const;
+    void Verify(std::string_view text,
+                size_t pos,
+                unsigned buckets,
+                size_t base,
+                std::vector<Hit>& hits) const;
+    // Passes the matches within [start, end) to `on_match` in order of their end, until it
+    // returns true.
+    // `Text` is either a `PieceTree` or a `std::string_view`.
+    template <typename Text>
+    void Match_Impl(const Text& text,
+                    size_t start,
+                    size_t end,
+                    const std::function<bool(const Hit&)>& on_match) const;
+};
+
+}  // namespace base
@@ -1,12 +1,15 @@
 #include "piece_tree.h"
 
 #include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/buffer/string_searcher.h"
 #include "base/numeric/literals.h"
 #include "base/numeric/saturation_arithmetic.h"
 #include "unicode/utf8_decoder.h"
 #include "util/scope_guard.h"
 
+#include <algorithm>
 #include <cassert>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -14,7 +17,14 @@
 namespace base {
 
 const CharBuffer* BufferCollection::buffer_at(BufferType buffer_type) const {
-    return buffer_type == BufferType::Mod ? &mod_buffer : orig_buffer.get();
+    return buffer_type == BufferType::Mod ? mod_buffer.get() : orig_buffer.get();
+}
+
+CharBuffer& BufferCollection::mutable_mod_buffer() {
+    if (mod_buffer.use_count() > 1) {
+        mod_buffer = std::make_shared<CharBuffer>(*mod_buffer);
+    }
+    return *mod_buffer;
 }
 
 size_t BufferCollection::buffer_offset(BufferType buffer_type, const BufferCursor& cursor) const {
@@ -23,6 +33,10 @@ size_t BufferCollection::buffer_offset(BufferType buffer_type, const BufferCurso
 }
 
 namespace {
+
+// Match offsets are reported as `int`, so `replace_all()` only edits buffers up to this length.
+constexpr size_t kMaxReplaceLength = std::numeric_limits<int>::max();
+
 std::vector<size_t> populate_line_starts(std::string_view buf) {
     std::vector<size_t> starts;
     starts.emplace_back(0);
@@ -42,11 +56,10 @@ PieceTree::PieceTree() : PieceTree("") {}
 PieceTree::PieceTree(std::string_view txt) {
     buffers = BufferCollection{
         .orig_buffer = std::make_shared<CharBuffer>(std::string{txt}, populate_line_starts(txt)),
+        // In order to maintain the invariant of other buffers, the mod_buffer needs a single
+        // line-start of 0.
+        .mod_buffer = std::make_shared<CharBuffer>(std::string{}, std::vector<size_t>{0}),
     };
-
-    // In order to maintain the invariant of other buffers, the mod_buffer needs a single
-    // line-start of 0.
-    buffers.mod_buffer.line_starts.emplace_back(0);
     last_insert = {};
 
     const auto& buf = *buffers.orig_buffer;
@@ -374,8 +387,14 @@ std::string PieceTree::substr(size_t offset, size_t count) const {
     return str;
 }
 
-std::optional<size_t> PieceTree::find(std::string_view str) const {
-    AhoCorasick ac({std::string(str)});
+std::optional<size_t> PieceTree::find(std::string_view str, const SearchOptions& options) const {
+    // A plain search for a single pattern doesn't need the automaton.
+    if (!options.case_insensitive && !options.whole_word) {
+        if (str.empty()) return std::nullopt;
+        return StringSearcher{str}.find(*this);
+    }
+
+    AhoCorasick ac({std::string(str)}, options);
     auto result = ac.match(*this);
 
     if (result.match_begin == -1) {
@@ -492,7 +511,8 @@ size_t PieceTree::line_feed_count(BufferType buffer_type,
 }
 
 Piece PieceTree::build_piece(std::string_view txt) {
-    auto start_offset = buffers.mod_buffer.buffer.size();
+    CharBuffer& mod_buffer = buffers.mutable_mod_buffer();
+    auto start_offset = mod_buffer.buffer.size();
     auto scratch_starts = populate_line_starts(txt);
     auto start = last_insert;
     // Offset the new starts relative to the existing buffer.
@@ -502,19 +522,19 @@ Piece PieceTree::build_piece(std::string_view txt) {
     // Append new starts.
     // Note: we can drop the first start because the algorithm always adds an empty start.
     auto new_starts_end = scratch_starts.size();
-    buffers.mod_buffer.line_starts.reserve(buffers.mod_buffer.line_starts.size() + new_starts_end);
+    mod_buffer.line_starts.reserve(mod_buffer.line_starts.size() + new_starts_end);
     for (size_t i = 1; i < new_starts_end; ++i) {
-        buffers.mod_buffer.line_starts.emplace_back(scratch_starts[i]);
+        mod_buffer.line_starts.emplace_back(scratch_starts[i]);
     }
-    auto old_size = buffers.mod_buffer.buffer.size();
-    buffers.mod_buffer.buffer.resize(buffers.mod_buffer.buffer.size() + txt.size());
-    auto insert_at = buffers.mod_buffer.buffer.data() + old_size;
+    auto old_size = mod_buffer.buffer.size();
+    mod_buffer.buffer.resize(mod_buffer.buffer.size() + txt.size());
+    auto insert_at = mod_buffer.buffer.data() + old_size;
     std::copy(txt.data(), txt.data() + txt.size(), insert_at);
 
     // Build the new piece for the inserted buffer.
-    auto end_offset = buffers.mod_buffer.buffer.size();
-    auto end_index = buffers.mod_buffer.line_starts.size() - 1;
-    auto end_col = end_offset - buffers.mod_buffer.line_starts[end_index];
+    auto end_offset = mod_buffer.buffer.size();
+    auto end_index = mod_buffer.line_starts.size() - 1;
+    auto end_col = end_offset - mod_buffer.line_starts[end_index];
     BufferCursor end_pos = {.line = end_index, .column = end_col};
     Piece piece = {
         .buffer_type = BufferType::Mod,
@@ -643,6 +663,11 @@ Piece PieceTree::trim_piece_left(const Piece& piece, const BufferCursor& pos) co
     return new_piece;
 }
 
+Piece PieceTree::sub_piece(const Piece& piece, size_t first, size_t last) const {
+    auto right = trim_piece_right(piece, buffer_position(piece, last));
+    return trim_piece_left(right, buffer_position(piece, first));
+}
+
 PieceTree::ShrinkResult PieceTree::shrink_piece(const Piece& piece,
                                                 const BufferCursor& first,
                                                 const BufferCursor& last) const {
@@ -693,46 +718,148 @@ void PieceTree::remove_node_range(NodePosition first, size_t length) {
 
 void PieceTree::insert(size_t offset, std::string_view txt) {
     if (txt.empty()) return;
-    append_undo();
+    append_undo({offset, 0, txt.length()});
     internal_insert(offset, txt);
 }
 
 void PieceTree::erase(size_t offset, size_t count) {
     // Rule out the obvious noop.
     if (count == 0 || root.empty()) return;
-    append_undo();
+    size_t erased = std::min(count, sub_sat(total_content_length, offset));
+    append_undo({offset, erased, 0});
     internal_erase(offset, count);
 }
 
+size_t PieceTree::replace_all(std::string_view pattern,
+                              std::string_view replacement,
+                              const SearchOptions& options) {
+    if (pattern.empty() || total_content_length > kMaxReplaceLength) return 0;
+
+    // Step 1: Stream the matches, keeping the leftmost ones that don't overlap.
+    struct Range {
+        size_t first;
+        size_t last;
+    };
+    std::vector<Range> matches;
+    AhoCorasick ac({std::string(pattern)}, options);
+    ac.match_all(*this, 0, total_content_length, [&](const AhoCorasick::MatchResult& result) {
+        matches.push_back({static_cast<size_t>(result.match_begin),
+                           static_cast<size_t>(result.match_end) + 1});
+    });
+    if (matches.empty()) return 0;
+
+    // Matches are reported in order of their end, which only differs from the order of their start
+    // when case variants have different lengths.
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const Range& a, const Range& b) { return a.first < b.first; });
+    size_t kept = 0;
+    for (const Range& range : matches) {
+        if (kept == 0 || range.first >= matches[kept - 1].last) {
+            matches[kept++] = range;
+        }
+    }
+    matches.resize(kept);
+
+    size_t covered = matches.back().last - matches.front().first;
+    size_t matched = 0;
+    for (const Range& range : matches) {
+        matched += range.last - range.first;
+    }
+    append_undo({
+        .offset = matches.front().first,
+        .erased = covered,
+        .inserted = covered - matched + matches.size() * replacement.length(),
+    });
+
+    // Step 2: Append the replacement text to the mod buffer once. Every replacement shares its
+    // piece, like pieces can already share the original buffer.
+    std::optional<Piece> replacement_piece;
+    if (!replacement.empty()) {
+        replacement_piece = build_piece(replacement);
+    }
+
+    // Step 3: Split the existing pieces around the matches in a single in-order pass, then build a
+    // new tree from the result. This avoids a tree path copy per match.
+    std::vector<Piece> pieces;
+    auto match = matches.begin();
+    size_t piece_start = 0;
+    std::vector<RedBlackTree> stack;
+    for (RedBlackTree node = root; !node.empty() || !stack.empty();) {
+        if (!node.empty()) {
+            stack.emplace_back(node);
+            node = node.left();
+            continue;
+        }
+        node = stack.back();
+        stack.pop_back();
+
+        const Piece& piece = node.data().piece;
+        size_t piece_end = piece_start + piece.length;
+        size_t pos = piece_start;
+        while (match != matches.end() && match->first < piece_end) {
+            if (match->first > pos) {
+                size_t first = pos - piece_start;
+                size_t last = match->first - piece_start;
+                pieces.emplace_back(sub_piece(piece, first, last));
+            }
+            // A match that spans several pieces is replaced in the piece where it starts.
+            if (match->first >= piece_start && replacement_piece) {
+                pieces.emplace_back(*replacement_piece);
+            }
+            if (match->last > piece_end) {
+                pos = piece_end;
+                break;
+            }
+            pos = match->last;
+            ++match;
+        }
+        if (pos < piece_end) {
+            pieces.emplace_back(sub_piece(piece, pos - piece_start, piece.length));
+        }
+        piece_start = piece_end;
+
+        node = node.right();
+    }
+
+    root = RedBlackTree::build(pieces);
+    compute_buffer_meta();
+#ifdef TEXTBUF_DEBUG
+    satisfies_rb_invariants(root);
+#endif  // TEXTBUF_DEBUG
+    return matches.size();
+}
+
 void PieceTree::compute_buffer_meta() {
     lf_count = root.lf_count();
     total_content_length = root.length();
 }
 
-void PieceTree::append_undo() {
+void PieceTree::append_undo(const EditRange& edit) {
     // Can't redo if we're creating a new undo entry.
     if (!redo_stack.empty()) {
         redo_stack.clear();
     }
-    undo_stack.push_front(root);
+    undo_stack.push_front({root, edit});
 }
 
-bool PieceTree::undo() {
-    if (undo_stack.empty()) return false;
-    redo_stack.push_front(root);
-    root = undo_stack.front();
+std::optional<EditRange> PieceTree::undo() {
+    if (undo_stack.empty()) return std::nullopt;
+    EditRange edit = undo_stack.front().edit;
+    redo_stack.push_front({root, edit});
+    root = undo_stack.front().root;
     undo_stack.pop_front();
     compute_buffer_meta();
-    return true;
+    return EditRange{edit.offset, edit.inserted, edit.erased};
 }
 
-bool PieceTree::redo() {
-    if (redo_stack.empty()) return false;
-    undo_stack.push_front(root);
-    root = redo_stack.front();
+std::optional<EditRange> PieceTree::redo() {
+    if (redo_stack.empty()) return std::nullopt;
+    EditRange edit = redo_stack.front().edit;
+    undo_stack.push_front({root, edit});
+    root = redo_stack.front().root;
     redo_stack.pop_front();
     compute_buffer_meta();
-    return true;
+    return edit;
 }
 
 TreeWalker::TreeWalker(const PieceTree* tree, size_t offset)
@@ -806,6 +933,18 @@ char32_t TreeWalker::next_codepoint() {
     }
 }
 
+std::string_view TreeWalker::next_chunk() {
+    while (first_ptr == last_ptr) {
+        populate_ptrs();
+        // If this is exhausted, we're done.
+        if (exhausted()) return {};
+    }
+    std::string_view chunk{first_ptr, static_cast<size_t>(last_ptr - first_ptr)};
+    total_offset += chunk.length();
+    first_ptr = last_ptr;
+    return chunk;
+}
+
 void TreeWalker::populate_ptrs() {
     if (exhausted()) return;
     if (stack.back().node.empty()) {
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base/buffer/piece_tree_rbtree.h"
+#include "base/buffer/search_options.h"
 
 #include <forward_list>
 #include <memory>
@@ -31,8 +32,13 @@ struct BufferCollection {
     const CharBuffer* buffer_at(BufferType buffer_type) const;
     size_t buffer_offset(BufferType buffer_type, const BufferCursor& cursor) const;
 
+    // Returns the mod buffer for appending. It's copied first if other trees share it.
+    CharBuffer& mutable_mod_buffer();
+
     std::shared_ptr<const CharBuffer> orig_buffer;
-    CharBuffer mod_buffer;
+    // Copies of a tree share this, e.g., the snapshots searched on background threads, until one
+    // of them appends to it. Appends never change the bytes that existing pieces refer to.
+    std::shared_ptr<CharBuffer> mod_buffer;
 };
 
 struct LineRange {
@@ -40,6 +46,14 @@ struct LineRange {
     size_t last;
 };
 
+// The bytes that an edit, undo or redo replaced: `erased` bytes at `offset` became `inserted`
+// bytes. Edits that change several places, like `replace_all()`, are covered by a single range.
+struct EditRange {
+    size_t offset;
+    size_t erased;
+    size_t inserted;
+};
+
 class PieceTree {
 public:
     explicit PieceTree();
@@ -48,8 +62,15 @@ public:
     // Manipulation.
     void insert(size_t offset, std::string_view txt);
     void erase(size_t offset, size_t count);
-    bool undo();
-    bool redo();
+    // Replaces every non-overlapping match of `pattern` with `replacement` as a single undo step.
+    // Returns the number of replacements. Buffers longer than `INT_MAX` bytes are left unchanged,
+    // since match offsets are reported as `int`.
+    size_t replace_all(std::string_view pattern,
+                       std::string_view replacement,
+                       const SearchOptions& options = {});
+    // Return the range that was changed, or nothing if there was nothing to undo or redo.
+    std::optional<EditRange> undo();
+    std::optional<EditRange> redo();
 
     // Queries.
     std::string get_line_content(size_t line) const;
@@ -63,7 +84,7 @@ public:
     LineRange get_line_range_with_newline(size_t line) const;
     std::string str() const;
     std::string substr(size_t offset, size_t count) const;
-    std::optional<size_t> find(std::string_view str) const;
+    std::optional<size_t> find(std::string_view str, const SearchOptions& options = {}) const;
 
     size_t length() const;
     bool empty() const;
@@ -97,6 +118,8 @@ private:
     BufferCursor buffer_position(const Piece& piece, size_t remainder) const;
     Piece trim_piece_right(const Piece& piece, const BufferCursor& pos) const;
     Piece trim_piece_left(const Piece& piece, const BufferCursor& pos) const;
+    // Returns the part of `piece` within [first, last), relative to the start of the piece.
+    Piece sub_piece(const Piece& piece, size_t first, size_t last) const;
 
     struct ShrinkResult {
         Piece left;
@@ -112,7 +135,7 @@ private:
     void combine_pieces(NodePosition existing_piece, Piece new_piece);
     void remove_node_range(NodePosition first, size_t length);
     void compute_buffer_meta();
-    void append_undo();
+    void append_undo(const EditRange& edit);
 
     BufferCollection buffers;
     RedBlackTree root;
@@ -122,8 +145,13 @@ private:
     size_t lf_count = 0;
     size_t total_content_length = 0;
 
-    std::forward_list<RedBlackTree> undo_stack;
-    std::forward_list<RedBlackTree> redo_stack;
+    // A state of the tree, and the edit from it to the next state.
+    struct UndoEntry {
+        RedBlackTree root;
+        EditRange edit;
+    };
+    std::forward_list<UndoEntry> undo_stack;
+    std::forward_list<UndoEntry> redo_stack;
 };
 
 class TreeWalker {
@@ -133,6 +161,8 @@ public:
     char current();
     char next();
     char32_t next_codepoint();
+    // Returns the rest of the current piece and advances past it. This is empty once exhausted.
+    std::string_view next_chunk();
     void seek(size_t offset);
     bool exhausted() const;
     constexpr size_t remaining() const;
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/buffer/piece_tree.h"
+#include "base/buffer/string_searcher.h"
+#include "base/numeric/literals.h"
+
+// TODO: Debug use; remove this.
+#include "util/profile_util.h"
+#include "util/random_util.h"
+
+namespace base {
+
+// Replacing every match should cost a single pass over the tree, not a tree edit per match.
+TEST(PieceTreePerfTest, ReplaceAll) {
+    std::string str;
+    for (size_t i = 0; i < 1000000; ++i) {
+        str += util::RandomString(10);
+        str += " needle\n";
+    }
+    PieceTree tree{str};
+
+    auto pf1 = util::Profiler{"PieceTree::replace_all (1M replacements)"};
+    size_t count = tree.replace_all("needle", "thread");
+    pf1.stop_mili();
+    EXPECT_EQ(count, 1000000_Z);
+    EXPECT_EQ(tree.length(), str.length());
+
+    auto pf2 = util::Profiler{"PieceTree::undo after replace_all"};
+    EXPECT_TRUE(tree.undo().has_value());
+    pf2.stop_micro();
+    EXPECT_EQ(tree.str(), str);
+}
+
+// For comparison, replacing each match with an erase and an insert.
+TEST(PieceTreePerfTest, ReplaceEach) {
+    std::string str;
+    for (size_t i = 0; i < 1000; ++i) {
+        str += util::RandomString(10);
+        str += " needle\n";
+    }
+    PieceTree tree{str};
+
+    // The replacement has the same length, so the offsets don't shift.
+    std::vector<size_t> offsets;
+    for (size_t i = str.find("needle"); i != std::string::npos; i = str.find("needle", i + 6)) {
+        offsets.emplace_back(i);
+    }
+
+    auto pf = util::Profiler{"PieceTree erase and insert (1k replacements)"};
+    for (size_t offset : offsets) {
+        tree.erase(offset, 6);
+        tree.insert(offset, "thread");
+    }
+    pf.stop_mili();
+    EXPECT_EQ(tree.length(), str.length());
+}
+
+// A single plain pattern skips the automaton entirely.
+TEST(PieceTreePerfTest, FindSinglePattern) {
+    std::string str;
+    for (size_t i = 0; i < 1000000; ++i) {
+        str += util::RandomString(50);
+        str += '\n';
+    }
+    str += "needle";
+    PieceTree tree{str};
+
+    auto pf1 = util::Profiler{"AhoCorasick::match (50 MB)"};
+    auto result = AhoCorasick{{"needle"}}.match(tree);
+    pf1.stop_mili();
+    EXPECT_EQ(static_cast<size_t>(result.match_begin), str.length() - 6);
+
+    auto pf2 = util::Profiler{"StringSearcher::find (50 MB)"};
+    auto offset = StringSearcher{"needle"}.find(tree);
+    pf2.stop_mili();
+    EXPECT_EQ(offset, str.length() - 6);
+}
+
+}  // namespace base
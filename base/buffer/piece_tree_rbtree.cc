@@ -1,5 +1,6 @@
 #include "piece_tree_rbtree.h"
 
+#include <bit>
 #include <cassert>
 
 namespace base {
@@ -35,6 +36,25 @@ Color RedBlackTree::root_color() const {
     return root_node->color;
 }
 
+RedBlackTree RedBlackTree::build(std::span<const Piece> pieces) {
+    // Splitting at the middle puts every leaf at one of the two deepest levels. Painting the
+    // deepest level red, if it isn't full, gives every path the same number of black nodes.
+    size_t full_levels = std::bit_width(pieces.size() + 1) - 1;
+    return build_range(pieces, 0, full_levels);
+}
+
+RedBlackTree RedBlackTree::build_range(std::span<const Piece> pieces,
+                                       size_t depth,
+                                       size_t red_depth) {
+    if (pieces.empty()) return RedBlackTree();
+
+    size_t mid = pieces.size() / 2;
+    auto lft = build_range(pieces.first(mid), depth + 1, red_depth);
+    auto rgt = build_range(pieces.subspan(mid + 1), depth + 1, red_depth);
+    Color c = depth >= red_depth ? Color::Red : Color::Black;
+    return RedBlackTree(c, lft, {pieces[mid]}, rgt);
+}
+
 RedBlackTree RedBlackTree::insert(const NodeData& x, size_t at) const {
     RedBlackTree t = internal_insert(x, at, 0);
     return RedBlackTree(Color::Black, t.left(), t.data(), t.right());
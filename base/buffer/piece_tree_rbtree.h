@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <span>
 
 namespace base {
 
@@ -45,6 +46,9 @@ class RedBlackTree {
 public:
     explicit RedBlackTree() = default;
 
+    // Builds a balanced tree from pieces in document order in a single pass.
+    static RedBlackTree build(std::span<const Piece> pieces);
+
     // Queries.
     const Node* root_ptr() const;
     bool empty() const;
@@ -83,6 +87,9 @@ private:
     bool doubled_left() const;
     bool doubled_right() const;
 
+    // Construction.
+    static RedBlackTree build_range(std::span<const Piece> pieces, size_t depth, size_t red_depth);
+
     // General.
     RedBlackTree paint(Color c) const;
 
@@ -929,4 +929,101 @@ TEST(PieceTreeTest, FindTest2) {
     ASSERT_FALSE(tree.find("\x8F\x9F"));
 }
 
+namespace {
+
+// Replaces every non-overlapping occurrence of `pattern`, from left to right.
+std::string ReplaceAll(std::string str, std::string_view pattern, std::string_view replacement) {
+    for (size_t i = str.find(pattern); i != std::string::npos;
+         i = str.find(pattern, i + replacement.length())) {
+        str.replace(i, pattern.length(), replacement);
+    }
+    return str;
+}
+
+}  // namespace
+
+TEST(PieceTreeTest, ReplaceAllTest1) {
+    PieceTree tree{"foo bar foo\nbarfoo"};
+    EXPECT_EQ(tree.replace_all("foo", "quux"), 3_Z);
+    EXPECT_EQ(tree.str(), "quux bar quux\nbarquux");
+    EXPECT_EQ(tree.line_count(), 2_Z);
+
+    EXPECT_EQ(tree.replace_all("missing", "x"), 0_Z);
+    EXPECT_EQ(tree.replace_all("", "x"), 0_Z);
+    EXPECT_EQ(tree.str(), "quux bar quux\nbarquux");
+
+    // Replacing is a single undo step, which covers the first to the last match.
+    auto undone = tree.undo();
+    ASSERT_TRUE(undone.has_value());
+    EXPECT_EQ(tree.str(), "foo bar foo\nbarfoo");
+    EXPECT_EQ(undone->offset, 0_Z);
+    EXPECT_EQ(undone->erased, 21_Z);
+    EXPECT_EQ(undone->inserted, 18_Z);
+    auto redone = tree.redo();
+    ASSERT_TRUE(redone.has_value());
+    EXPECT_EQ(tree.str(), "quux bar quux\nbarquux");
+    EXPECT_EQ(redone->erased, 18_Z);
+    EXPECT_EQ(redone->inserted, 21_Z);
+}
+
+TEST(PieceTreeTest, ReplaceAllTest2) {
+    // Matches don't overlap, and can be erased.
+    PieceTree tree{"aaaaa\n\n"};
+    EXPECT_EQ(tree.replace_all("aa", ""), 2_Z);
+    EXPECT_EQ(tree.str(), "a\n\n");
+    EXPECT_EQ(tree.replace_all("\n", "\n\n"), 2_Z);
+    EXPECT_EQ(tree.str(), "a\n\n\n\n");
+    EXPECT_EQ(tree.line_count(), 5_Z);
+
+    // Case-insensitive.
+    PieceTree tree2{"Foo fOO foo"};
+    EXPECT_EQ(tree2.replace_all("foo", "x", {.case_insensitive = true}), 3_Z);
+    EXPECT_EQ(tree2.str(), "x x x");
+}
+
+TEST(PieceTreeTest, ReplaceAllRandomTest) {
+    // Builds a tree with many pieces, so that matches span piece boundaries.
+    std::string str;
+    PieceTree tree;
+    for (size_t i = 0; i < 200; ++i) {
+        std::string text;
+        for (size_t n = util::RandomNumber(1, 8); n > 0; --n) {
+            bool newline = util::RandomNumber(0, 4) == 0;
+            text += newline ? '\n' : static_cast<char>(util::RandomNumber('a', 'b'));
+        }
+        size_t offset = util::RandomNumber(0, str.length());
+        str.insert(offset, text);
+        tree.insert(offset, text);
+    }
+
+    for (std::string_view replacement : {"b\nab", "", "a"}) {
+        size_t expected_count = 0;
+        for (size_t i = str.find("aba"); i != std::string::npos; i = str.find("aba", i + 3)) {
+            ++expected_count;
+        }
+        EXPECT_EQ(tree.replace_all("aba", replacement), expected_count);
+        str = ReplaceAll(str, "aba", replacement);
+        ASSERT_EQ(tree.str(), str);
+        EXPECT_EQ(tree.line_count(), static_cast<size_t>(std::ranges::count(str, '\n')) + 1);
+        size_t line_start = 0;
+        for (size_t line = 0; line < tree.line_count(); ++line) {
+            size_t line_end = std::min(str.find('\n', line_start), str.length());
+            EXPECT_EQ(tree.get_line_content(line), str.substr(line_start, line_end - line_start));
+            line_start = line_end + 1;
+        }
+    }
+}
+
+// Copies of a tree share the buffers that they were built from. Editing one leaves the others
+// intact.
+TEST(PieceTreeTest, CopiesShareBuffers) {
+    PieceTree tree{"abc"};
+    tree.insert(3, "def");
+    PieceTree snapshot = tree;
+    tree.insert(6, "ghi");
+    snapshot.insert(0, "xyz");
+    EXPECT_EQ(tree.str(), "abcdefghi");
+    EXPECT_EQ(snapshot.str(), "xyzabcdef");
+}
+
 }  // namespace base
@@ -0,0 +1,175 @@
+#include "project_search.h"
+
+#include "base/files/directory_enumerator.h"
+#include "base/files/memory_mapped_file.h"
+#include "util/scope_guard.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+
+namespace base {
+
+namespace {
+
+// Match offsets are reported as `int`.
+constexpr size_t kMaxFileSize = std::numeric_limits<int>::max();
+
+bool IsHidden(const FilePath& path) {
+    FilePath::StringType name = path.BaseName().value();
+    return !name.empty() && name[0] == FILE_PATH_LITERAL('.');
+}
+
+}  // namespace
+
+struct ProjectSearch::State {
+    State(const std::vector<std::string>& patterns, const SearchOptions& options)
+        : ac{patterns, options} {}
+
+    const AhoCorasick ac;
+    std::atomic<bool> cancelled = false;
+    // The number of directories and files that are queued or being searched.
+    std::atomic<size_t> pending = 0;
+
+    std::atomic<size_t> files_searched = 0;
+    std::atomic<size_t> files_skipped = 0;
+    std::atomic<size_t> bytes_searched = 0;
+    std::atomic<size_t> match_count = 0;
+
+    std::mutex mutex;
+    std::vector<FileResult> results;
+};
+
+ProjectSearch::ProjectSearch(size_t thread_count) : pool{thread_count} {}
+
+ProjectSearch::~ProjectSearch() {
+    cancel();
+}
+
+void ProjectSearch::start(const FilePath& root,
+                          const std::vector<std::string>& patterns,
+                          const SearchOptions& options) {
+    cancel();
+
+    state = std::make_shared<State>(patterns, options);
+    ++state->pending;
+    pool.post([state = state, &pool = pool, root] { walk_directory(state, pool, root); });
+}
+
+void ProjectSearch::cancel() {
+    if (!state) return;
+
+    // Queued tasks of the old search return right away, and running ones drop their results.
+    state->cancelled = true;
+    state.reset();
+}
+
+std::vector<ProjectSearch::FileResult> ProjectSearch::poll() {
+    if (!state) return {};
+
+    std::lock_guard lock(state->mutex);
+    return std::exchange(state->results, {});
+}
+
+bool ProjectSearch::complete() const {
+    return !state || state->pending == 0;
+}
+
+void ProjectSearch::wait() {
+    // This also waits for the tasks of cancelled searches, which finish quickly.
+    pool.wait();
+}
+
+ProjectSearch::Stats ProjectSearch::stats() const {
+    if (!state) return {};
+
+    return {
+        .files_searched = state->files_searched,
+        .files_skipped = state->files_skipped,
+        .bytes_searched = state->bytes_searched,
+        .match_count = state->match_count,
+    };
+}
+
+void ProjectSearch::walk_directory(std::shared_ptr<State> state, ThreadPool& pool, FilePath dir) {
+    // Children are counted before their parent is done, so this only reaches zero at the end.
+    ScopeGuard guard{[&state] { --state->pending; }};
+    if (state->cancelled) return;
+
+    // Each subdirectory is walked by its own task, so that large trees are walked in parallel.
+    DirectoryEnumerator enumerator{dir};
+    while (auto entry = enumerator.Next()) {
+        if (IsHidden(entry->path)) continue;
+
+        const FilePath& path = entry->path;
+        if (entry->is_directory && !entry->is_symlink) {
+            ++state->pending;
+            pool.post([state, &pool, path] { walk_directory(state, pool, path); });
+        } else if (entry->is_file) {
+            ++state->pending;
+            pool.post([state, path] { search_file(*state, path); });
+        }
+    }
+}
+
+void ProjectSearch::search_file(State& state, const FilePath& path) {
+    // The results must be queued before the search can be complete.
+    ScopeGuard guard{[&state] { --state.pending; }};
+    if (state.cancelled) return;
+
+    MemoryMappedFile file;
+    std::string_view text;
+    if (file.Initialize(path)) text = file.data();
+    bool is_binary = text.substr(0, kBinaryCheckLength).find('\0') != std::string_view::npos;
+    if (!file.IsValid() || text.length() > kMaxFileSize || is_binary) {
+        ++state.files_skipped;
+        return;
+    }
+
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Range> ranges;
+    state.ac.match_all(text, [&ranges](const AhoCorasick::MatchResult& result) {
+        ranges.push_back({static_cast<size_t>(result.match_begin),
+                          static_cast<size_t>(result.match_end) + 1});
+    });
+    ++state.files_searched;
+    state.bytes_searched += text.length();
+    if (ranges.empty() || state.cancelled) return;
+
+    // Matches are reported in order of their end, so sort them before counting lines in a single
+    // pass.
+    std::ranges::sort(ranges, [](const Range& a, const Range& b) { return a.begin < b.begin; });
+    FileResult result{.path = path};
+    result.matches.reserve(ranges.size());
+    // The line of the current match spans [line_start, line_end). The cursor only moves forward,
+    // so each byte is scanned for newlines once, however many matches share its line.
+    size_t line = 0;
+    size_t line_start = 0;
+    size_t line_end = std::min(text.find('\n'), text.length());
+    for (const Range& range : ranges) {
+        while (line_end < range.begin) {
+            ++line;
+            line_start = line_end + 1;
+            line_end = std::min(text.find('\n', line_start), text.length());
+        }
+        size_t line_length = std::min(line_end - line_start, kMaxLineTextLength);
+        result.matches.push_back({
+            .line = line,
+            .column = range.begin - line_start,
+            .length = range.end - range.begin,
+            .line_text = std::string(text.substr(line_start, line_length)),
+        });
+    }
+
+    state.match_count += result.matches.size();
+    {
+        std::lock_guard lock(state.mutex);
+        state.results.emplace_back(std::move(result));
+    }
+}
+
+}  // namespace base
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/files/file_path.h"
+#include "base/threading/thread_pool.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace base {
+
+// Searches every file under a directory, e.g., a folder in the side bar. Directories are walked
+// and files are searched on a thread pool, and each file's matches are queued for the UI thread
+// to pick up with `poll()` as soon as the file is done.
+class ProjectSearch {
+public:
+    struct LineMatch {
+        size_t line;
+        // The byte offset and length of the match within its line.
+        size_t column;
+        size_t length;
+        // The line, truncated to `kMaxLineTextLength` bytes.
+        std::string line_text;
+    };
+
+    struct FileResult {
+        FilePath path;
+        // In ascending order of their offset.
+        std::vector<LineMatch> matches;
+    };
+
+    struct Stats {
+        size_t files_searched = 0;
+        // Binary files, files that are too large, and files that couldn't be read.
+        size_t files_skipped = 0;
+        size_t bytes_searched = 0;
+        size_t match_count = 0;
+    };
+
+    explicit ProjectSearch(size_t thread_count = ThreadPool::DefaultThreadCount());
+    ~ProjectSearch();
+
+    // Cancels the active search, if any, and searches the files under `root`. Hidden files and
+    // directories (e.g., ".git") are skipped, and symbolic links to directories aren't followed.
+    void start(const FilePath& root,
+               const std::vector<std::string>& patterns,
+               const SearchOptions& options = {});
+    // Stops the active search as soon as the files being searched are done. Their results are
+    // dropped.
+    void cancel();
+    // Returns the files with matches that were found since the last call, in no particular order.
+    std::vector<FileResult> poll();
+    // Returns false while the active search is in progress.
+    bool complete() const;
+    // Blocks until the active search is complete.
+    void wait();
+    Stats stats() const;
+
+    static constexpr size_t kMaxLineTextLength = 256;
+    // A file is considered binary if this prefix of it contains a NUL byte.
+    static constexpr size_t kBinaryCheckLength = 8192;
+
+private:
+    struct State;
+
+    ThreadPool pool;
+    // Shared with the tasks of the search, so that cancelling doesn't have to wait for them.
+    std::shared_ptr<State> state;
+
+    static void walk_directory(std::shared_ptr<State> state, ThreadPool& pool, FilePath dir);
+    static void search_file(State& state, const FilePath& path);
+};
+
+}  // namespace base
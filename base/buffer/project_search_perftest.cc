@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include "base/buffer/project_search.h"
+#include "base/files/file_util.h"
+#include "base/numeric/literals.h"
+
+#include <fmt/format.h>
+
+// TODO: Debug use; remove this.
+#include "util/profile_util.h"
+#include "util/random_util.h"
+
+namespace base {
+
+// Generates a source tree of 2,000 files (about 100 MB) and searches it with a single thread and
+// with the default thread pool.
+TEST(ProjectSearchPerfTest, SyntheticSourceTree) {
+    constexpr size_t kDirCount = 40;
+    constexpr size_t kFilesPerDir = 50;
+    constexpr size_t kLinesPerFile = 1000;
+
+    FilePath root;
+    ASSERT_TRUE(GetTempDir(&root));
+    root = root.Append(FILE_PATH_LITERAL("project_search_perftest"));
+    DeletePathRecursively(root);
+
+    auto pf1 = util::Profiler{"Generate synthetic source tree"};
+    size_t expected_matches = 0;
+    for (size_t d = 0; d < kDirCount; ++d) {
+        auto module_name = fmt::format("module{}", d);
+        auto dir = root.Append(FilePath::StringType(module_name.begin(), module_name.end()))
+                       .Append(FILE_PATH_LITERAL("src"));
+        ASSERT_TRUE(CreateDirectory(dir));
+        for (size_t f = 0; f < kFilesPerDir; ++f) {
+            std::string contents;
+            for (size_t line = 0; line < kLinesPerFile; ++line) {
+                contents += "    auto value = ";
+                contents += util::RandomString(util::RandomNumber(10, 60));
+                if (line % 200 == 0) {
+                    contents += "; // TODO: clean up";
+                    ++expected_matches;
+                }
+                contents += ";\n";
+            }
+            auto file_name = fmt::format("file{}.cc", f);
+            ASSERT_TRUE(WriteFile(
+                dir.Append(FilePath::StringType(file_name.begin(), file_name.end())), contents));
+        }
+    }
+    pf1.stop_mili();
+
+    for (size_t thread_count : {1_Z, ThreadPool::DefaultThreadCount()}) {
+        ProjectSearch search(thread_count);
+        auto name = fmt::format("ProjectSearch ({} threads)", thread_count);
+        auto pf = util::Profiler{name};
+        search.start(root, {"TODO", "FIXME"});
+        search.wait();
+        pf.stop_mili();
+
+        auto stats = search.stats();
+        EXPECT_EQ(stats.files_searched, kDirCount * kFilesPerDir);
+        EXPECT_GE(stats.match_count, expected_matches);
+    }
+
+    DeletePathRecursively(root);
+}
+
+}  // namespace base
@@ -0,0 +1,166 @@
+#include "base/buffer/project_search.h"
+#include "base/files/file_util.h"
+#include "base/numeric/literals.h"
+
+#include <algorithm>
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+// Creates a directory tree from (relative path, contents) pairs, and deletes it when destroyed.
+class TempTree {
+public:
+    TempTree(std::string_view name,
+             const std::vector<std::pair<std::string, std::string>>& files) {
+        FilePath temp_dir;
+        EXPECT_TRUE(GetTempDir(&temp_dir));
+        root_ = Append(temp_dir, name);
+        DeletePathRecursively(root_);
+        for (const auto& [relative_path, contents] : files) {
+            auto file_path = path(relative_path);
+            EXPECT_TRUE(CreateDirectory(file_path.DirName()));
+            EXPECT_TRUE(WriteFile(file_path, contents));
+        }
+    }
+
+    ~TempTree() {
+        DeletePathRecursively(root_);
+    }
+
+    FilePath root() const {
+        return root_;
+    }
+
+    // |relative_path| is ASCII, with components separated by '/'.
+    FilePath path(std::string_view relative_path) const {
+        FilePath result = root_;
+        size_t start = 0;
+        while (start <= relative_path.size()) {
+            size_t end = std::min(relative_path.find('/', start), relative_path.size());
+            result = Append(result, relative_path.substr(start, end - start));
+            start = end + 1;
+        }
+        return result;
+    }
+
+private:
+    FilePath root_;
+
+    static FilePath Append(const FilePath& dir, std::string_view component) {
+        return dir.Append(FilePath::StringType(component.begin(), component.end()));
+    }
+};
+
+}  // namespace
+
+TEST(ProjectSearchTest, Search) {
+    TempTree tree{"project_search_test",
+                  {
+                      {"a.txt", "hello world\nsay hello\n"},
+                      {"src/b.cc", "// TODO: hello\nint x;\nhello();"},
+                      {"src/nested/c.h", "nothing to see here"},
+                      {".git/config", "hello"},
+                      {"binary.bin", std::string("hello\0world", 11)},
+                  }};
+
+    ProjectSearch search(2);
+    search.start(tree.root(), {"hello"});
+    search.wait();
+    EXPECT_TRUE(search.complete());
+
+    auto results = search.poll();
+    std::ranges::sort(results, [](const auto& a, const auto& b) {
+        return a.path.value() < b.path.value();
+    });
+    ASSERT_EQ(results.size(), 2_Z);
+
+    EXPECT_EQ(results[0].path, tree.path("a.txt"));
+    ASSERT_EQ(results[0].matches.size(), 2_Z);
+    EXPECT_EQ(results[0].matches[0].line, 0_Z);
+    EXPECT_EQ(results[0].matches[0].column, 0_Z);
+    EXPECT_EQ(results[0].matches[0].length, 5_Z);
+    EXPECT_EQ(results[0].matches[0].line_text, "hello world");
+    EXPECT_EQ(results[0].matches[1].line, 1_Z);
+    EXPECT_EQ(results[0].matches[1].column, 4_Z);
+    EXPECT_EQ(results[0].matches[1].line_text, "say hello");
+
+    EXPECT_EQ(results[1].path, tree.path("src/b.cc"));
+    ASSERT_EQ(results[1].matches.size(), 2_Z);
+    EXPECT_EQ(results[1].matches[0].line, 0_Z);
+    EXPECT_EQ(results[1].matches[0].column, 9_Z);
+    EXPECT_EQ(results[1].matches[1].line, 2_Z);
+    EXPECT_EQ(results[1].matches[1].line_text, "hello();");
+
+    // Hidden directories aren't walked, and binary files are skipped.
+    auto stats = search.stats();
+    EXPECT_EQ(stats.files_searched, 3_Z);
+    EXPECT_EQ(stats.files_skipped, 1_Z);
+    EXPECT_EQ(stats.match_count, 4_Z);
+
+    // Results are only returned once.
+    EXPECT_TRUE(search.poll().empty());
+}
+
+TEST(ProjectSearchTest, Options) {
+    TempTree tree{"project_search_options_test", {{"a.txt", "Foo food FOO"}}};
+
+    ProjectSearch search(2);
+    search.start(tree.root(), {"foo"}, {.case_insensitive = true, .whole_word = true});
+    search.wait();
+    auto results = search.poll();
+    ASSERT_EQ(results.size(), 1_Z);
+    ASSERT_EQ(results[0].matches.size(), 2_Z);
+    EXPECT_EQ(results[0].matches[0].column, 0_Z);
+    EXPECT_EQ(results[0].matches[1].column, 9_Z);
+}
+
+TEST(ProjectSearchTest, ManyMatchesPerLine) {
+    TempTree tree{"project_search_lines_test", {{"a.txt", "ab ab\n\nxab\nab"}}};
+
+    ProjectSearch search(2);
+    search.start(tree.root(), {"ab"});
+    search.wait();
+    auto results = search.poll();
+    ASSERT_EQ(results.size(), 1_Z);
+    const auto& matches = results[0].matches;
+    ASSERT_EQ(matches.size(), 4_Z);
+    std::vector<std::pair<size_t, size_t>> positions;
+    for (const auto& match : matches) {
+        positions.emplace_back(match.line, match.column);
+    }
+    EXPECT_EQ(positions, (std::vector<std::pair<size_t, size_t>>{{0, 0}, {0, 3}, {2, 1}, {3, 0}}));
+    EXPECT_EQ(matches[1].line_text, "ab ab");
+    EXPECT_EQ(matches[2].line_text, "xab");
+    EXPECT_EQ(matches[3].line_text, "ab");
+}
+
+TEST(ProjectSearchTest, Cancel) {
+    std::vector<std::pair<std::string, std::string>> files;
+    for (int i = 0; i < 100; ++i) {
+        files.emplace_back("dir" + std::to_string(i % 10) + "/" + std::to_string(i), "needle");
+    }
+    TempTree tree{"project_search_cancel_test", files};
+
+    ProjectSearch search(2);
+    search.start(tree.root(), {"needle"});
+    search.cancel();
+    EXPECT_TRUE(search.complete());
+    EXPECT_TRUE(search.poll().empty());
+    search.wait();
+    EXPECT_TRUE(search.poll().empty());
+
+    // Starting a new search cancels the old one.
+    search.start(tree.root(), {"haystack"});
+    search.start(tree.root(), {"needle"});
+    search.wait();
+    size_t file_count = 0;
+    for (const auto& result : search.poll()) {
+        EXPECT_EQ(result.matches.size(), 1_Z);
+        ++file_count;
+    }
+    EXPECT_EQ(file_count, 100_Z);
+}
+
+}  // namespace base
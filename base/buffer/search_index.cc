@@ -0,0 +1,402 @@
+#include "search_index.h"
+
+#include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/numeric/saturation_arithmetic.h"
+#include "unicode/unicode.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+namespace base {
+
+namespace {
+
+// Background scans check for cancellation after each chunk of this many bytes.
+constexpr size_t kBackgroundChunkSize = 1 << 20;
+
+// Match offsets are reported as `int`, so only the matches that end before this are indexed.
+constexpr size_t kMaxIndexedLength = std::numeric_limits<int>::max();
+
+// Returns the matches that start within [start, end), in ascending order.
+std::vector<SearchIndex::Match> Find_Matches(const PieceTree& tree,
+                                             const AhoCorasick& ac,
+                                             size_t max_match_length,
+                                             size_t start,
+                                             size_t end) {
+    std::vector<SearchIndex::Match> matches;
+    end = std::min(end, kMaxIndexedLength);
+    if (start >= end) return matches;
+    ac.match_all(tree, start, std::min(add_sat(end, max_match_length), kMaxIndexedLength),
+                 [&](const AhoCorasick::MatchResult& result) {
+                     size_t match_begin = result.match_begin;
+                     // `match_end` is inclusive.
+                     size_t match_end = result.match_end + 1;
+                     if (match_begin < end) matches.push_back({match_begin, match_end});
+                 });
+
+    // Matches are reported in order of their end, which only differs from the order of their start
+    // when case variants have different lengths. Of the matches that start at the same offset, the
+    // longest one is kept.
+    std::ranges::sort(matches, [](const auto& a, const auto& b) {
+        return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+    });
+    auto duplicates = std::ranges::unique(matches, {}, &SearchIndex::Match::begin);
+    matches.erase(duplicates.begin(), duplicates.end());
+    return matches;
+}
+
+}  // namespace
+
+SearchIndex::~SearchIndex() {
+    cancel_background();
+}
+
+void SearchIndex::search(const PieceTree& tree,
+                         std::string_view query,
+                         const SearchOptions& options) {
+    reset(query, options);
+    if (active()) scan(tree, 0, tree.length());
+}
+
+void SearchIndex::search_async(const PieceTree& tree,
+                               std::string_view query,
+                               const SearchOptions& options,
+                               size_t start,
+                               size_t end) {
+    reset(query, options);
+    if (!active()) return;
+
+    end = std::min(end, tree.length());
+    start = std::min(start, end);
+    scan(tree, start, end);
+
+    // The background thread scans a snapshot, which is cheap to copy since the tree's nodes and
+    // buffers are shared.
+    auto cancelled = std::make_shared<std::atomic<bool>>(false);
+    auto scan_rest = [snapshot = tree, query = active_query, options, start, end, cancelled,
+                      max_match_length = max_match_length]() {
+        AhoCorasick ac({query}, options);
+        std::vector<Match> matches;
+        auto scan_range = [&](size_t range_start, size_t range_end) {
+            for (size_t i = range_start; i < range_end; i += kBackgroundChunkSize) {
+                if (*cancelled) return;
+                size_t chunk_end = std::min(add_sat(i, kBackgroundChunkSize), range_end);
+                auto chunk = Find_Matches(snapshot, ac, max_match_length, i, chunk_end);
+                matches.insert(matches.end(), chunk.begin(), chunk.end());
+            }
+        };
+        scan_range(0, start);
+        scan_range(end, snapshot.length());
+        return matches;
+    };
+    background = BackgroundScan{
+        .matches = std::async(std::launch::async, std::move(scan_rest)),
+        .cancelled = std::move(cancelled),
+    };
+}
+
+bool SearchIndex::poll() {
+    if (!background) return false;
+    if (background->matches.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+        return false;
+    }
+
+    std::vector<Match> matches = background->matches.get();
+    std::vector<Edit> edits = std::move(background->edits);
+    background.reset();
+
+    // Map the matches to the current tree the same way `update()` did for the index. Matches near
+    // an edit are dropped since the index already rescanned those regions.
+    size_t pad = edit_padding();
+    for (const auto& edit : edits) {
+        size_t lo = sub_sat(edit.offset, pad);
+        size_t hi = add_sat(edit.offset + edit.erased, pad);
+        std::erase_if(matches, [&](const Match& m) { return lo <= m.begin && m.begin < hi; });
+        for (Match& match : matches) {
+            if (match.begin >= hi) {
+                match.begin = match.begin + edit.inserted - edit.erased;
+                match.end = match.end + edit.inserted - edit.erased;
+            }
+        }
+    }
+
+    // The index already holds the matches within the scanned range and near the edits, which
+    // interleave with these.
+    root = unite(root, build(matches));
+    return !matches.empty();
+}
+
+bool SearchIndex::complete() const {
+    return !background.has_value();
+}
+
+void SearchIndex::rescan(const PieceTree& tree) {
+    if (!active()) return;
+
+    reset(std::string{active_query}, options);
+    scan(tree, 0, tree.length());
+}
+
+void SearchIndex::clear() {
+    reset({}, {});
+}
+
+void SearchIndex::on_insert(const PieceTree& tree, size_t offset, size_t length) {
+    update(tree, offset, 0, length);
+}
+
+void SearchIndex::on_erase(const PieceTree& tree, size_t offset, size_t length) {
+    update(tree, offset, length, 0);
+}
+
+void SearchIndex::on_edit(const PieceTree& tree, const EditRange& edit) {
+    update(tree, edit.offset, edit.erased, edit.inserted);
+}
+
+void SearchIndex::reset(std::string_view query, const SearchOptions& options) {
+    cancel_background();
+    nodes.clear();
+    free_nodes.clear();
+    root = kNil;
+
+    active_query = query;
+    this->options = options;
+    // A case variant of a codepoint may take more bytes than the codepoint itself (e.g., the
+    // Kelvin sign for 'k').
+    max_match_length = options.case_insensitive
+                           ? query.length() * unicode::kMaxBytesInUTF8Sequence
+                           : query.length();
+}
+
+void SearchIndex::cancel_background() {
+    if (!background) return;
+
+    // The future's destructor waits for the thread, which stops after its current chunk.
+    *background->cancelled = true;
+    background.reset();
+}
+
+size_t SearchIndex::edit_padding() const {
+    // A match is unaffected if it lies more than one codepoint away from the edit, since
+    // whole-word searches look at the codepoints on either side of a match.
+    return max_match_length + unicode::kMaxBytesInUTF8Sequence;
+}
+
+bool SearchIndex::active() const {
+    return !active_query.empty();
+}
+
+std::string_view SearchIndex::query() const {
+    return active_query;
+}
+
+size_t SearchIndex::count() const {
+    return size_of(root);
+}
+
+std::vector<size_t> SearchIndex::matches_in(size_t start, size_t end) const {
+    std::vector<size_t> result;
+    for (const Match& match : match_ranges_in(start, end)) {
+        result.emplace_back(match.begin);
+    }
+    return result;
+}
+
+std::vector<SearchIndex::Match> SearchIndex::match_ranges_in(size_t start, size_t end) const {
+    std::vector<Match> result;
+    collect(root, 0, start, end, result);
+    return result;
+}
+
+std::optional<size_t> SearchIndex::next_match(size_t offset) const {
+    std::optional<size_t> result;
+    ptrdiff_t delta = 0;
+    for (uint32_t t = root; t != kNil;) {
+        delta += nodes[t].delta;
+        size_t node_offset = nodes[t].offset + delta;
+        if (node_offset >= offset) {
+            result = node_offset;
+            t = nodes[t].left;
+        } else {
+            t = nodes[t].right;
+        }
+    }
+    return result;
+}
+
+std::optional<SearchIndex::Match> SearchIndex::find_first(const PieceTree& tree,
+                                                         size_t offset) const {
+    if (!active()) return std::nullopt;
+
+    if (complete()) {
+        auto begin = next_match(offset);
+        if (!begin) begin = next_match(0);
+        if (!begin) return std::nullopt;
+        return match_ranges_in(*begin, *begin + 1).front();
+    }
+
+    // The scan stops at the first match, which is usually close by.
+    AhoCorasick ac({active_query}, options);
+    size_t end = std::min(tree.length(), kMaxIndexedLength);
+    auto result = ac.match(tree, std::min(offset, end), end);
+    if (result.match_begin == -1) result = ac.match(tree, 0, end);
+    if (result.match_begin == -1) return std::nullopt;
+    // `match_end` is inclusive.
+    size_t match_begin = result.match_begin;
+    size_t match_end = result.match_end + 1;
+    return Match{match_begin, match_end};
+}
+
+void SearchIndex::update(const PieceTree& tree, size_t offset, size_t erased, size_t inserted) {
+    if (!active()) return;
+
+    size_t pad = edit_padding();
+    size_t start = sub_sat(offset, pad);
+
+    // Drop the matches that start near the edit and shift the ones after it.
+    auto [lhs, rest] = split(root, start);
+    auto [mid, rhs] = split(rest, add_sat(offset + erased, pad));
+    free_subtree(mid);
+    if (rhs != kNil) {
+        nodes[rhs].delta += static_cast<ptrdiff_t>(inserted) - static_cast<ptrdiff_t>(erased);
+    }
+    root = merge(lhs, rhs);
+
+    scan(tree, start, add_sat(offset + inserted, pad));
+
+    if (background) {
+        background->edits.push_back({offset, erased, inserted});
+    }
+}
+
+void SearchIndex::scan(const PieceTree& tree, size_t start, size_t end) {
+    AhoCorasick ac({active_query}, options);
+    auto found = Find_Matches(tree, ac, max_match_length, start, end);
+
+    // The caller has removed any matches within [start, end), so the new ones fit in between.
+    auto [lhs, rhs] = split(root, start);
+    root = merge(merge(lhs, build(found)), rhs);
+}
+
+uint32_t SearchIndex::new_node(const Match& match) {
+    // xorshift32
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+
+    Node node{
+        .offset = match.begin,
+        .length = match.end - match.begin,
+        .priority = random_state,
+    };
+    if (!free_nodes.empty()) {
+        uint32_t t = free_nodes.back();
+        free_nodes.pop_back();
+        nodes[t] = node;
+        return t;
+    }
+    nodes.emplace_back(node);
+    return nodes.size() - 1;
+}
+
+void SearchIndex::free_subtree(uint32_t t) {
+    std::vector<uint32_t> stack;
+    if (t != kNil) stack.emplace_back(t);
+    while (!stack.empty()) {
+        t = stack.back();
+        stack.pop_back();
+        free_nodes.emplace_back(t);
+        if (nodes[t].left != kNil) stack.emplace_back(nodes[t].left);
+        if (nodes[t].right != kNil) stack.emplace_back(nodes[t].right);
+    }
+}
+
+void SearchIndex::push_down(uint32_t t) {
+    Node& node = nodes[t];
+    if (node.delta == 0) return;
+
+    node.offset += node.delta;
+    if (node.left != kNil) nodes[node.left].delta += node.delta;
+    if (node.right != kNil) nodes[node.right].delta += node.delta;
+    node.delta = 0;
+}
+
+void SearchIndex::pull_up(uint32_t t) {
+    Node& node = nodes[t];
+    node.size = 1 + size_of(node.left) + size_of(node.right);
+}
+
+uint32_t SearchIndex::size_of(uint32_t t) const {
+    return t == kNil ? 0 : nodes[t].size;
+}
+
+std::pair<uint32_t, uint32_t> SearchIndex::split(uint32_t t, size_t offset) {
+    if (t == kNil) return {kNil, kNil};
+
+    push_down(t);
+    if (nodes[t].offset < offset) {
+        auto [lhs, rhs] = split(nodes[t].right, offset);
+        nodes[t].right = lhs;
+        pull_up(t);
+        return {t, rhs};
+    } else {
+        auto [lhs, rhs] = split(nodes[t].left, offset);
+        nodes[t].left = rhs;
+        pull_up(t);
+        return {lhs, t};
+    }
+}
+
+uint32_t SearchIndex::merge(uint32_t lhs, uint32_t rhs) {
+    if (lhs == kNil) return rhs;
+    if (rhs == kNil) return lhs;
+
+    if (nodes[lhs].priority > nodes[rhs].priority) {
+        push_down(lhs);
+        nodes[lhs].right = merge(nodes[lhs].right, rhs);
+        pull_up(lhs);
+        return lhs;
+    } else {
+        push_down(rhs);
+        nodes[rhs].left = merge(lhs, nodes[rhs].left);
+        pull_up(rhs);
+        return rhs;
+    }
+}
+
+uint32_t SearchIndex::unite(uint32_t lhs, uint32_t rhs) {
+    if (lhs == kNil) return rhs;
+    if (rhs == kNil) return lhs;
+
+    if (nodes[lhs].priority < nodes[rhs].priority) std::swap(lhs, rhs);
+    push_down(lhs);
+    auto [left, right] = split(rhs, nodes[lhs].offset);
+    nodes[lhs].left = unite(nodes[lhs].left, left);
+    nodes[lhs].right = unite(nodes[lhs].right, right);
+    pull_up(lhs);
+    return lhs;
+}
+
+uint32_t SearchIndex::build(const std::vector<Match>& matches) {
+    uint32_t t = kNil;
+    for (const Match& match : matches) {
+        t = merge(t, new_node(match));
+    }
+    return t;
+}
+
+void SearchIndex::collect(
+    uint32_t t, ptrdiff_t delta, size_t start, size_t end, std::vector<Match>& out) const {
+    if (t == kNil) return;
+
+    delta += nodes[t].delta;
+    size_t node_offset = nodes[t].offset + delta;
+    if (node_offset >= start) collect(nodes[t].left, delta, start, end, out);
+    if (start <= node_offset && node_offset < end) {
+        out.push_back({node_offset, node_offset + nodes[t].length});
+    }
+    if (node_offset < end) collect(nodes[t].right, delta, start, end, out);
+}
+
+}  // namespace base
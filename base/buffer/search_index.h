@@ -0,0 +1,136 @@
+#pragma once
+
+#include "base/buffer/piece_tree.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace base {
+
+// Keeps the start offsets of every match of the active query, including overlapping ones, in sync
+// with edits to the tree. An edit only rescans the edited region padded by the longest possible
+// match, and later matches are shifted lazily in O(log n).
+class SearchIndex {
+public:
+    SearchIndex() = default;
+    ~SearchIndex();
+
+    struct Match {
+        size_t begin;
+        size_t end;
+    };
+
+    // Replaces the active query and scans the whole tree.
+    void search(const PieceTree& tree, std::string_view query, const SearchOptions& options = {});
+    // Like `search()`, but only the matches that start within [start, end), e.g., the visible
+    // lines, are found before returning. The rest of the tree is scanned on a background thread,
+    // and its results are merged by `poll()`.
+    void search_async(const PieceTree& tree,
+                      std::string_view query,
+                      const SearchOptions& options,
+                      size_t start,
+                      size_t end);
+    // Merges the results of a finished background scan. Returns true if the index changed.
+    bool poll();
+    // Returns false while a background scan is pending, meaning that `count()` is incomplete.
+    bool complete() const;
+    // Scans the whole tree again for the active query.
+    void rescan(const PieceTree& tree);
+    void clear();
+
+    // These must be called after the edit has been applied to `tree`.
+    void on_insert(const PieceTree& tree, size_t offset, size_t length);
+    void on_erase(const PieceTree& tree, size_t offset, size_t length);
+    // For changes that replace text, e.g., an undo or redo.
+    void on_edit(const PieceTree& tree, const EditRange& edit);
+
+    bool active() const;
+    std::string_view query() const;
+    size_t count() const;
+    // Returns the matches that start within [start, end), in ascending order.
+    std::vector<size_t> matches_in(size_t start, size_t end) const;
+    // Like `matches_in()`, but with the end of each match, which may differ from the length of
+    // the query for case-insensitive searches.
+    std::vector<Match> match_ranges_in(size_t start, size_t end) const;
+    // Returns the first match that starts at or after `offset`.
+    std::optional<size_t> next_match(size_t offset) const;
+    // Returns the first match that starts at or after `offset`, or else the first match in the
+    // tree. While a background scan is pending, this searches the tree directly rather than
+    // returning only the matches found so far.
+    std::optional<Match> find_first(const PieceTree& tree, size_t offset) const;
+
+private:
+    static constexpr uint32_t kNil = std::numeric_limits<uint32_t>::max();
+
+    struct Edit {
+        size_t offset;
+        size_t erased;
+        size_t inserted;
+    };
+
+    struct BackgroundScan {
+        std::future<std::vector<Match>> matches;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+        // The edits made since the scanned snapshot of the tree was taken. The matches are mapped
+        // through these before they are merged.
+        std::vector<Edit> edits;
+    };
+
+    // A treap node. `delta` is a pending shift for the entire subtree, including this node, which
+    // is pushed down to the children whenever the node is restructured.
+    struct Node {
+        size_t offset;
+        size_t length;
+        ptrdiff_t delta = 0;
+        uint32_t priority;
+        uint32_t size = 1;
+        uint32_t left = kNil;
+        uint32_t right = kNil;
+    };
+
+    std::string active_query;
+    SearchOptions options;
+    // The length in bytes of the longest text that can match the query.
+    size_t max_match_length = 0;
+
+    std::vector<Node> nodes;
+    std::vector<uint32_t> free_nodes;
+    uint32_t root = kNil;
+    uint32_t random_state = 0x9E3779B9;
+
+    std::optional<BackgroundScan> background;
+
+    void reset(std::string_view query, const SearchOptions& options);
+    void cancel_background();
+    // The distance from an edit within which matches must be rescanned.
+    size_t edit_padding() const;
+    void update(const PieceTree& tree, size_t offset, size_t erased, size_t inserted);
+    // Adds the matches that start within [start, end).
+    void scan(const PieceTree& tree, size_t start, size_t end);
+
+    // Treap helpers.
+    uint32_t new_node(const Match& match);
+    void free_subtree(uint32_t t);
+    void push_down(uint32_t t);
+    void pull_up(uint32_t t);
+    uint32_t size_of(uint32_t t) const;
+    // Splits `t` into the nodes before `offset` and the nodes at or after it.
+    std::pair<uint32_t, uint32_t> split(uint32_t t, size_t offset);
+    uint32_t merge(uint32_t lhs, uint32_t rhs);
+    // Like `merge()`, but the offsets of `lhs` and `rhs` may interleave.
+    uint32_t unite(uint32_t lhs, uint32_t rhs);
+    // Returns a treap of `matches`, which are in ascending order.
+    uint32_t build(const std::vector<Match>& matches);
+    void collect(uint32_t t, ptrdiff_t delta, size_t start, size_t end, std::vector<Match>& out)
+        const;
+};
+
+}  // namespace base
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include "base/buffer/search_index.h"
+#include "base/numeric/literals.h"
+
+// TODO: Debug use; remove this.
+#include "util/profile_util.h"
+#include "util/random_util.h"
+
+namespace base {
+
+// An edit should only cost a rescan of the edited region, regardless of the file size.
+TEST(SearchIndexPerfTest, EditLargeFile) {
+    std::string str;
+    for (size_t i = 0; i < 100000; ++i) {
+        str += util::RandomString(90);
+        str += " needle\n";
+    }
+    PieceTree tree{str};
+    SearchIndex index;
+
+    auto pf1 = util::Profiler{"SearchIndex full search"};
+    index.search(tree, "needle");
+    pf1.stop_mili();
+
+    auto pf2 = util::Profiler{"SearchIndex update after insert"};
+    tree.insert(str.length() / 2, "needle");
+    index.on_insert(tree, str.length() / 2, 6);
+    pf2.stop_micro();
+
+    auto pf3 = util::Profiler{"SearchIndex update after erase"};
+    tree.erase(0, 100);
+    index.on_erase(tree, 0, 100);
+    pf3.stop_micro();
+
+    EXPECT_EQ(index.count(), 100000_Z);
+}
+
+}  // namespace base
@@ -0,0 +1,262 @@
+#include "base/buffer/search_index.h"
+#include "base/numeric/literals.h"
+#include "util/random_util.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+namespace {
+
+// Returns the start offset of every occurrence of `query`, including overlapping ones.
+std::vector<size_t> FindAll(std::string_view str, std::string_view query) {
+    std::vector<size_t> result;
+    for (size_t i = str.find(query); i != std::string_view::npos; i = str.find(query, i + 1)) {
+        result.emplace_back(i);
+    }
+    return result;
+}
+
+}  // namespace
+
+TEST(SearchIndexTest, Search) {
+    PieceTree tree{"abc abcabc ab"};
+    SearchIndex index;
+    EXPECT_FALSE(index.active());
+
+    index.search(tree, "abc");
+    EXPECT_TRUE(index.active());
+    EXPECT_EQ(index.query(), "abc");
+    EXPECT_EQ(index.count(), 3_Z);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 4, 7}));
+    EXPECT_EQ(index.matches_in(1, 7), (std::vector<size_t>{4}));
+    EXPECT_EQ(index.next_match(0), 0_Z);
+    EXPECT_EQ(index.next_match(5), 7_Z);
+    EXPECT_EQ(index.next_match(8), std::nullopt);
+
+    index.clear();
+    EXPECT_FALSE(index.active());
+    EXPECT_EQ(index.count(), 0_Z);
+}
+
+TEST(SearchIndexTest, OverlappingMatches) {
+    PieceTree tree{"aaaa"};
+    SearchIndex index;
+    index.search(tree, "aa");
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 1, 2}));
+}
+
+TEST(SearchIndexTest, Insert) {
+    PieceTree tree{"foo bar foo bar foo"};
+    SearchIndex index;
+    index.search(tree, "foo");
+    EXPECT_EQ(index.count(), 3_Z);
+
+    // Shifts the later matches.
+    tree.insert(4, "xx");
+    index.on_insert(tree, 4, 2);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 10, 18}));
+
+    // Breaks a match.
+    tree.insert(11, "-");
+    index.on_insert(tree, 11, 1);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 19}));
+
+    // Creates a match.
+    tree.insert(tree.length(), " fo");
+    index.on_insert(tree, tree.length() - 3, 3);
+    EXPECT_EQ(index.count(), 2_Z);
+    tree.insert(tree.length(), "o");
+    index.on_insert(tree, tree.length() - 1, 1);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 19, 23}));
+}
+
+TEST(SearchIndexTest, Erase) {
+    PieceTree tree{"foo bar fo-o bar foo"};
+    SearchIndex index;
+    index.search(tree, "foo");
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 17}));
+
+    // Creates a match.
+    tree.erase(10, 1);
+    index.on_erase(tree, 10, 1);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 8, 16}));
+
+    // Removes a match.
+    tree.erase(0, 4);
+    index.on_erase(tree, 0, 4);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{4, 12}));
+}
+
+TEST(SearchIndexTest, WholeWordBoundaries) {
+    PieceTree tree{"foo foo"};
+    SearchIndex index;
+    index.search(tree, "foo", {.whole_word = true});
+    EXPECT_EQ(index.count(), 2_Z);
+
+    // Touching a match from outside can change whether it is a whole word.
+    tree.insert(3, "d");
+    index.on_insert(tree, 3, 1);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{5}));
+
+    tree.erase(3, 1);
+    index.on_erase(tree, 3, 1);
+    EXPECT_EQ(index.matches_in(0, tree.length()), (std::vector<size_t>{0, 4}));
+}
+
+TEST(SearchIndexTest, SearchAsync) {
+    std::string str;
+    for (size_t i = 0; i < 10000; ++i) {
+        str += util::RandomString(10) + "needle\n";
+    }
+    PieceTree tree{str};
+    SearchIndex index;
+
+    // Only the given range is scanned synchronously.
+    size_t start = str.length() / 2;
+    size_t end = start + 100;
+    index.search_async(tree, "needle", {}, start, end);
+    EXPECT_FALSE(index.complete());
+    std::vector<size_t> visible;
+    for (size_t offset : FindAll(str, "needle")) {
+        if (start <= offset && offset < end) visible.emplace_back(offset);
+    }
+    EXPECT_FALSE(visible.empty());
+    EXPECT_EQ(index.matches_in(0, str.length()), visible);
+
+    // Edits made before the background results are merged must be applied to them too.
+    for (size_t n = 0; n < 100; ++n) {
+        size_t offset = util::RandomNumber(0, str.length());
+        if (util::RandomNumber(0, 1) == 0) {
+            std::string text = util::RandomNumber(0, 1) == 0 ? "needle" : "ne";
+            str.insert(offset, text);
+            tree.insert(offset, text);
+            index.on_insert(tree, offset, text.length());
+        } else {
+            size_t count = std::min<size_t>(util::RandomNumber(1, 8), str.length() - offset);
+            str.erase(offset, count);
+            tree.erase(offset, count);
+            index.on_erase(tree, offset, count);
+        }
+    }
+
+    while (!index.complete()) {
+        index.poll();
+    }
+    auto expected = FindAll(str, "needle");
+    EXPECT_EQ(index.count(), expected.size());
+    EXPECT_EQ(index.matches_in(0, str.length()), expected);
+}
+
+// The first match is found even if the synchronous scan of the visible range missed it.
+TEST(SearchIndexTest, FindFirstOutsideScannedRange) {
+    std::string str = "needle" + std::string(1000, ' ') + "needle" + std::string(1000, ' ');
+    PieceTree tree{str};
+    SearchIndex index;
+
+    // Only a match below the scanned range.
+    index.search_async(tree, "needle", {}, 100, 200);
+    EXPECT_TRUE(index.matches_in(0, str.length()).empty());
+    auto match = index.find_first(tree, 100);
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->begin, 1006_Z);
+    EXPECT_EQ(match->end, 1012_Z);
+
+    // Only a match above the scanned range, which is found by wrapping around.
+    index.search_async(tree, "needle", {}, 1500, 1600);
+    match = index.find_first(tree, 1500);
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->begin, 0_Z);
+
+    while (!index.complete()) {
+        index.poll();
+    }
+    match = index.find_first(tree, 1500);
+    ASSERT_TRUE(match);
+    EXPECT_EQ(match->begin, 0_Z);
+    EXPECT_EQ(index.find_first(tree, 1)->begin, 1006_Z);
+}
+
+// Case variants may take more bytes than the query, and are highlighted by their own length.
+TEST(SearchIndexTest, MatchRanges) {
+    // U+212A KELVIN SIGN is 3 bytes and folds to 'k'.
+    PieceTree tree{"k \u212A k"};
+    SearchIndex index;
+    index.search(tree, "k", {.case_insensitive = true});
+    auto ranges = index.match_ranges_in(0, tree.length());
+    ASSERT_EQ(ranges.size(), 3_Z);
+    EXPECT_EQ(ranges[0].end - ranges[0].begin, 1_Z);
+    EXPECT_EQ(ranges[1].end - ranges[1].begin, 3_Z);
+    EXPECT_EQ(ranges[2].end - ranges[2].begin, 1_Z);
+}
+
+// The incremental index must agree with a full rescan after any sequence of edits.
+TEST(SearchIndexTest, RandomEdits) {
+    constexpr std::string_view kQuery = "aba";
+    auto random_text = [](size_t length) {
+        std::string str(length, 0);
+        for (char& ch : str) ch = util::RandomNumber('a', 'b');
+        return str;
+    };
+
+    std::string str = random_text(1000);
+    PieceTree tree{str};
+    SearchIndex index;
+    index.search(tree, kQuery);
+
+    for (size_t n = 0; n < 500; ++n) {
+        size_t offset = util::RandomNumber(0, str.length());
+        if (util::RandomNumber(0, 1) == 0) {
+            std::string text = random_text(util::RandomNumber(1, 8));
+            str.insert(offset, text);
+            tree.insert(offset, text);
+            index.on_insert(tree, offset, text.length());
+        } else {
+            size_t count = std::min<size_t>(util::RandomNumber(1, 8), str.length() - offset);
+            str.erase(offset, count);
+            tree.erase(offset, count);
+            index.on_erase(tree, offset, count);
+        }
+
+        auto expected = FindAll(str, kQuery);
+        ASSERT_EQ(index.count(), expected.size());
+        ASSERT_EQ(index.matches_in(0, str.length()), expected);
+    }
+}
+
+// Undo and redo report the range that they changed, which keeps the index in sync.
+TEST(SearchIndexTest, UndoRedo) {
+    PieceTree tree{"aba abab ba"};
+    SearchIndex index;
+    index.search(tree, "aba");
+    std::vector<std::string> history = {tree.str()};
+
+    tree.insert(3, "ba");
+    history.emplace_back(tree.str());
+    index.on_insert(tree, 3, 2);
+    tree.erase(0, 2);
+    history.emplace_back(tree.str());
+    index.on_erase(tree, 0, 2);
+    tree.replace_all("b", "aba");
+    history.emplace_back(tree.str());
+    index.rescan(tree);
+
+    for (size_t i = history.size() - 1; i-- > 0;) {
+        auto edit = tree.undo();
+        ASSERT_TRUE(edit.has_value());
+        index.on_edit(tree, *edit);
+        ASSERT_EQ(tree.str(), history[i]);
+        EXPECT_EQ(index.matches_in(0, tree.length()), FindAll(history[i], "aba")) << i;
+    }
+    EXPECT_FALSE(tree.undo().has_value());
+
+    for (size_t i = 1; i < history.size(); ++i) {
+        auto edit = tree.redo();
+        ASSERT_TRUE(edit.has_value());
+        index.on_edit(tree, *edit);
+        ASSERT_EQ(tree.str(), history[i]);
+        EXPECT_EQ(index.matches_in(0, tree.length()), FindAll(history[i], "aba")) << i;
+    }
+}
+
+}  // namespace base
@@ -0,0 +1,13 @@
+#pragma once
+
+namespace base {
+
+struct SearchOptions {
+    bool case_insensitive = false;
+    // Only report matches that start and end on word boundaries.
+    bool whole_word = false;
+
+    bool operator==(const SearchOptions&) const = default;
+};
+
+}  // namespace base
@@ -0,0 +1,304 @@
+#include <gtest/gtest.h>
+
+#include "base/buffer/aho_corasick/aho_corasick.h"
+#include "base/buffer/piece_tree.h"
+#include "base/buffer/string_searcher.h"
+#include "base/numeric/literals.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fmt/format.h>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmarks the search engines over generated corpora that resemble what the editor opens. Each
+// case is timed over `kRuns` runs after a warm-up run, and its median and p95 are printed and
+// recorded as test properties, so `--gtest_output=json:<file>` gives machine-readable results
+// (e.g., `source.multi_small.teddy.median_ms`).
+
+namespace base {
+
+namespace {
+
+constexpr size_t kRuns = 20;
+constexpr size_t kCorpusLines = 100000;
+// Planted words, for control over the hit density.
+constexpr size_t kSparseEvery = 10000;
+constexpr size_t kMediumEvery = 100;
+
+// Corpora are generated from a fixed seed so that results are comparable between runs.
+class Generator {
+public:
+    explicit Generator(uint32_t seed) : rng(seed) {}
+
+    size_t number(size_t low, size_t high) {
+        return std::uniform_int_distribution<size_t>{low, high}(rng);
+    }
+
+    template <typename T>
+    const T& pick(const std::vector<T>& items) {
+        return items[number(0, items.size() - 1)];
+    }
+
+    // Returns a snake_case identifier built from a few syllables.
+    std::string identifier() {
+        static const std::vector<std::string> kSyllables = {
+            "buf", "ren", "der", "glyph", "line", "text", "font", "size", "off", "set",
+            "node", "tree", "pos", "col", "row", "map", "key", "val", "ptr", "len",
+        };
+        std::string result = pick(kSyllables);
+        for (size_t i = number(0, 2); i > 0; --i) {
+            result += number(0, 1) == 0 ? "_" : "";
+            result += pick(kSyllables);
+        }
+        return result;
+    }
+
+private:
+    std::mt19937 rng;
+};
+
+struct Corpus {
+    std::string name;
+    std::string text;
+    // Planted once every `kSparseEvery` and `kMediumEvery` lines.
+    std::string sparse;
+    std::string medium;
+    // A word that occurs naturally on most lines.
+    std::string dense;
+    // Other words from the corpus, for dictionary-style queries.
+    std::vector<std::string> vocabulary;
+};
+
+// Appends the planted words to every line that calls for them.
+void Plant(const Corpus& corpus, size_t line, std::string& str) {
+    if (line % kSparseEvery == kSparseEvery / 2) str += " " + corpus.sparse;
+    if (line % kMediumEvery == kMediumEvery / 2) str += " " + corpus.medium;
+}
+
+Corpus SourceCodeCorpus() {
+    Generator gen{1};
+    Corpus corpus{
+        .name = "source",
+        .sparse = "frobnicate_widget",
+        .medium = "invalidate_layout",
+        .dense = "auto",
+    };
+    for (size_t i = 0; i < 2000; ++i) {
+        corpus.vocabulary.emplace_back(gen.identifier());
+    }
+
+    for (size_t line = 0; line < kCorpusLines; ++line) {
+        auto id = [&] { return gen.pick(corpus.vocabulary); };
+        std::string str(gen.number(1, 3) * 4, ' ');
+        switch (gen.number(0, 7)) {
+        case 0:
+            str += fmt::format("if ({} != nullptr) {{", id());
+            break;
+        case 1:
+            str += "}";
+            break;
+        case 2:
+            str += fmt::format("// TODO: Handle {} before {}.", id(), id());
+            break;
+        case 3:
+            str += fmt::format("return {}->{}();", id(), id());
+            break;
+        default:
+            str += fmt::format("auto {} = {}({}, {});", id(), id(), id(), gen.number(0, 4096));
+            break;
+        }
+        Plant(corpus, line, str);
+        corpus.text += str + "\n";
+    }
+    return corpus;
+}
+
+Corpus LogCorpus() {
+    Generator gen{2};
+    Corpus corpus{
+        .name = "logs",
+        .sparse = "SIGSEGV",
+        .medium = "timed out",
+        .dense = "INFO",
+    };
+    const std::vector<std::string> kLevels = {"INFO", "INFO", "INFO", "INFO",
+                                              "DEBUG", "WARN", "ERROR"};
+    const std::vector<std::string> kComponents = {"renderer", "gpu", "net", "fs", "input"};
+    for (size_t i = 0; i < 500; ++i) {
+        corpus.vocabulary.emplace_back(gen.identifier());
+    }
+
+    for (size_t line = 0; line < kCorpusLines; ++line) {
+        std::string str = fmt::format(
+            "2026-10-19 12:{:02}:{:02}.{:03} {} [{}] {} {} request_id={:08x}",
+            line / 60000 % 60, line / 1000 % 60, line % 1000, gen.pick(kLevels),
+            gen.pick(kComponents), gen.pick(corpus.vocabulary), gen.pick(corpus.vocabulary),
+            gen.number(0, UINT32_MAX));
+        Plant(corpus, line, str);
+        corpus.text += str + "\n";
+    }
+    return corpus;
+}
+
+Corpus Utf8Corpus() {
+    Generator gen{3};
+    Corpus corpus{
+        .name = "utf8",
+        .sparse = "水平線",
+        .medium = "Schrödinger",
+        .dense = "и",
+    };
+    corpus.vocabulary = {
+        "日本語", "テキスト", "の",     "文字列",  "編集",    "и",        "текст",
+        "строка", "редактор", "Ελληνικά", "κείμενο", "naïve",    "café",     "façade",
+        "中文",   "字形",     "渲染",   "😀",      "🚀",      "한국어",   "글꼴",
+    };
+
+    for (size_t line = 0; line < kCorpusLines; ++line) {
+        std::string str;
+        for (size_t i = gen.number(4, 10); i > 0; --i) {
+            str += gen.pick(corpus.vocabulary);
+            str += " ";
+        }
+        Plant(corpus, line, str);
+        corpus.text += str + "\n";
+    }
+    return corpus;
+}
+
+struct Timings {
+    double median_ms;
+    double p95_ms;
+};
+
+Timings Summarize(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    // Nearest-rank percentiles.
+    auto percentile = [&](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * samples.size()));
+        return samples[std::max(rank, 1_Z) - 1];
+    };
+    return {.median_ms = percentile(0.5), .p95_ms = percentile(0.95)};
+}
+
+// Times `search`, which returns the number of matches, and records the results under `name`.
+template <typename Search>
+size_t Measure(const std::string& name, size_t bytes, Search&& search) {
+    size_t matches = search();
+    std::vector<double> samples;
+    for (size_t run = 0; run < kRuns; ++run) {
+        auto t1 = std::chrono::steady_clock::now();
+        size_t count = search();
+        auto t2 = std::chrono::steady_clock::now();
+        samples.emplace_back(std::chrono::duration<double, std::milli>(t2 - t1).count());
+        EXPECT_EQ(count, matches);
+    }
+
+    auto timings = Summarize(std::move(samples));
+    double mb_per_s = bytes / 1e6 / (timings.median_ms / 1e3);
+    fmt::print("{:<44} median {:>8.2f} ms  p95 {:>8.2f} ms  {:>8.1f} MB/s  {:>8} matches\n", name,
+               timings.median_ms, timings.p95_ms, mb_per_s, matches);
+
+    ::testing::Test::RecordProperty(name + ".median_ms", fmt::format("{:.3f}", timings.median_ms));
+    ::testing::Test::RecordProperty(name + ".p95_ms", fmt::format("{:.3f}", timings.p95_ms));
+    ::testing::Test::RecordProperty(name + ".mb_per_s", fmt::format("{:.1f}", mb_per_s));
+    ::testing::Test::RecordProperty(name + ".matches", std::to_string(matches));
+    return matches;
+}
+
+// Runs single and multi-pattern queries at several hit densities over `tree` with every engine
+// that supports them. All engines must agree on the number of matches.
+void RunQueries(const std::string& name, const PieceTree& tree, const Corpus& corpus) {
+    struct Query {
+        std::string name;
+        std::vector<std::string> patterns;
+        SearchOptions options;
+    };
+
+    std::vector<std::string> dictionary(corpus.vocabulary.begin(),
+                                        corpus.vocabulary.begin() +
+                                            std::min(corpus.vocabulary.size(), 500_Z));
+    dictionary.emplace_back(corpus.sparse);
+    std::vector<Query> queries = {
+        {"single_sparse", {corpus.sparse}},
+        {"single_medium", {corpus.medium}},
+        {"single_dense", {corpus.dense}},
+        {"single_sparse_icase", {corpus.sparse}, {.case_insensitive = true}},
+        {"single_sparse_word", {corpus.sparse}, {.whole_word = true}},
+        {"multi_small", {corpus.sparse, corpus.medium, corpus.vocabulary[1], corpus.dense}},
+        {"multi_large", dictionary},
+    };
+
+    for (const auto& query : queries) {
+        auto case_name = [&](std::string_view engine) {
+            return fmt::format("{}.{}.{}", name, query.name, engine);
+        };
+        std::vector<size_t> counts;
+
+        bool plain = query.options == SearchOptions{};
+        if (query.patterns.size() == 1 && plain) {
+            StringSearcher searcher{query.patterns[0]};
+            counts.emplace_back(Measure(case_name("string_searcher"), tree.length(), [&] {
+                size_t count = 0;
+                auto offset = searcher.find(tree);
+                for (; offset; offset = searcher.find(tree, *offset + 1)) {
+                    ++count;
+                }
+                return count;
+            }));
+        }
+
+        for (auto backend : {AhoCorasick::Backend::kAutomaton, AhoCorasick::Backend::kTeddy}) {
+            AhoCorasick ac(query.patterns, query.options, backend);
+            if (ac.backend() != backend) continue;
+
+            std::string_view engine = backend == AhoCorasick::Backend::kTeddy ? "teddy"
+                                                                              : "automaton";
+            counts.emplace_back(Measure(case_name(engine), tree.length(), [&] {
+                size_t count = 0;
+                ac.match_all(tree, 0, tree.length(),
+                             [&](const AhoCorasick::MatchResult&) { ++count; });
+                return count;
+            }));
+        }
+
+        ASSERT_FALSE(counts.empty());
+        for (size_t count : counts) {
+            EXPECT_EQ(count, counts[0]) << case_name("*");
+        }
+        EXPECT_GT(counts[0], 0_Z) << case_name("*");
+    }
+}
+
+}  // namespace
+
+TEST(SearchPerfTest, SourceCode) {
+    auto corpus = SourceCodeCorpus();
+    RunQueries(corpus.name, PieceTree{corpus.text}, corpus);
+}
+
+TEST(SearchPerfTest, Logs) {
+    auto corpus = LogCorpus();
+    RunQueries(corpus.name, PieceTree{corpus.text}, corpus);
+}
+
+TEST(SearchPerfTest, Utf8) {
+    auto corpus = Utf8Corpus();
+    RunQueries(corpus.name, PieceTree{corpus.text}, corpus);
+}
+
+// A heavily edited file: every underscore is its own piece, so most identifier matches cross a
+// piece boundary.
+TEST(SearchPerfTest, FragmentedPieceTree) {
+    auto corpus = SourceCodeCorpus();
+    PieceTree tree{corpus.text};
+    size_t replacements = tree.replace_all("_", "_");
+    EXPECT_GT(replacements, kCorpusLines);
+    EXPECT_EQ(tree.length(), corpus.text.length());
+    RunQueries("fragmented", tree, corpus);
+}
+
+}  // namespace base
@@ -0,0 +1,134 @@
+#include "string_searcher.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace base {
+
+namespace {
+
+constexpr size_t kBlockSize = 16;
+
+// Returns a mask of the positions in the block at `data` where a match could start, i.e., where
+// the first byte and the byte `pattern_length - 1` later match those of the pattern. Only bit
+// `i * kMaskStride` is set for position `i`.
+#if defined(__SSE2__)
+constexpr int kMaskStride = 1;
+
+inline uint64_t Candidates(const char* data, size_t pattern_length, char first, char last) {
+    __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i block_last =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pattern_length - 1));
+    __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(block_first, _mm_set1_epi8(first)),
+                               _mm_cmpeq_epi8(block_last, _mm_set1_epi8(last)));
+    return static_cast<uint32_t>(_mm_movemask_epi8(eq));
+}
+#elif defined(__ARM_NEON)
+constexpr int kMaskStride = 4;
+
+inline uint64_t Candidates(const char* data, size_t pattern_length, char first, char last) {
+    uint8x16_t block_first = vld1q_u8(reinterpret_cast<const uint8_t*>(data));
+    uint8x16_t block_last =
+        vld1q_u8(reinterpret_cast<const uint8_t*>(data + pattern_length - 1));
+    uint8x16_t eq = vandq_u8(vceqq_u8(block_first, vdupq_n_u8(first)),
+                             vceqq_u8(block_last, vdupq_n_u8(last)));
+    // NEON has no movemask, so narrow each byte to a nibble instead.
+    uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(nibbles), 0) & 0x1111111111111111;
+}
+#endif
+
+}  // namespace
+
+StringSearcher::StringSearcher(std::string_view pattern) : pattern{pattern} {
+    size_t m = pattern.length();
+    shift.fill(static_cast<uint32_t>(std::max<size_t>(m, 1)));
+    for (size_t i = 0; i + 1 < m; ++i) {
+        shift[static_cast<uint8_t>(pattern[i])] = static_cast<uint32_t>(m - 1 - i);
+    }
+}
+
+size_t StringSearcher::find(std::string_view text, size_t pos) const {
+    size_t m = pattern.length();
+    if (pos > text.length() || text.length() - pos < m) return kNotFound;
+    if (m == 0) return pos;
+    if (m == 1) {
+        const void* found = std::memchr(text.data() + pos, pattern[0], text.length() - pos);
+        return found ? static_cast<const char*>(found) - text.data() : kNotFound;
+    }
+
+#if defined(__SSE2__) || defined(__ARM_NEON)
+    // The last byte loaded by a block is `block + kBlockSize - 1 + m - 1`, so every block must end
+    // at least `m - 1` bytes before the end of the text.
+    const char* data = text.data();
+    for (; pos + kBlockSize + m - 1 <= text.length(); pos += kBlockSize) {
+        uint64_t mask = Candidates(data + pos, m, pattern.front(), pattern.back());
+        while (mask != 0) {
+            size_t i = pos + std::countr_zero(mask) / kMaskStride;
+            if (std::memcmp(data + i + 1, pattern.data() + 1, m - 2) == 0) return i;
+            mask &= mask - 1;
+        }
+    }
+#endif
+
+    return find_horspool(text, pos);
+}
+
+std::optional<size_t> StringSearcher::find(const PieceTree& tree, size_t start, size_t end) const {
+    size_t m = pattern.length();
+    end = std::min(end, tree.length());
+    if (start > end || end - start < m) return std::nullopt;
+    if (m == 0) return start;
+
+    // Matches that span pieces are found by searching the last `m - 1` bytes before each piece
+    // joined with the first `m - 1` bytes of the piece.
+    std::string carry;
+    std::string window;
+    size_t offset = start;
+    TreeWalker walker{&tree, start};
+    while (offset < end) {
+        std::string_view chunk = walker.next_chunk();
+        if (chunk.empty()) break;
+        chunk = chunk.substr(0, end - offset);
+
+        if (!carry.empty()) {
+            window = carry;
+            window.append(chunk.substr(0, m - 1));
+            size_t i = find(window);
+            if (i < carry.length()) return offset - carry.length() + i;
+        }
+
+        size_t i = find(chunk);
+        if (i != kNotFound) return offset + i;
+
+        if (chunk.length() >= m - 1) {
+            carry.assign(chunk.substr(chunk.length() - (m - 1)));
+        } else {
+            carry.append(chunk);
+            carry.erase(0, carry.length() - std::min(carry.length(), m - 1));
+        }
+        offset += chunk.length();
+    }
+    return std::nullopt;
+}
+
+size_t StringSearcher::find_horspool(std::string_view text, size_t pos) const {
+    size_t m = pattern.length();
+    const char* data = text.data();
+    char last = pattern.back();
+    while (pos + m <= text.length()) {
+        char ch = data[pos + m - 1];
+        if (ch == last && std::memcmp(data + pos, pattern.data(), m - 1) == 0) return pos;
+        pos += shift[static_cast<uint8_t>(ch)];
+    }
+    return kNotFound;
+}
+
+}  // namespace base
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "base/buffer/piece_tree.h"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace base {
+
+// Finds a single literal pattern byte for byte. This is much cheaper than running the
+// Aho-Corasick automaton over every byte: candidates are found 16 bytes at a time by comparing
+// the first and last bytes of the pattern with SIMD, and the remainder is searched with
+// Boyer-Moore-Horspool.
+class StringSearcher {
+public:
+    explicit StringSearcher(std::string_view pattern);
+
+    // Returns the start of the first match that lies entirely within [start, end).
+    std::optional<size_t> find(const PieceTree& tree, size_t start = 0, size_t end = kEnd) const;
+    // Returns the start of the first match in `text` at or after `pos`, or `kNotFound`.
+    size_t find(std::string_view text, size_t pos = 0) const;
+
+    static constexpr size_t kEnd = std::numeric_limits<size_t>::max();
+    static constexpr size_t kNotFound = std::numeric_limits<size_t>::max();
+
+private:
+    std::string pattern;
+    // The Horspool shift for each byte at the last position of the window.
+    std::array<uint32_t, 256> shift;
+
+    size_t find_horspool(std::string_view text, size_t pos) const;
+};
+
+}  // namespace base
@@ -0,0 +1,75 @@
+#include "base/buffer/string_searcher.h"
+#include "base/numeric/literals.h"
+#include "util/random_util.h"
+
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(StringSearcherTest, FindInText) {
+    std::string_view text = "the quick brown fox jumps over the lazy dog";
+    for (std::string_view pattern : {"t", "the", "dog", "fox jumps over", "cat", "dogs", ""}) {
+        StringSearcher searcher{pattern};
+        for (size_t pos = 0; pos <= text.length(); ++pos) {
+            size_t expected = text.find(pattern, pos);
+            EXPECT_EQ(searcher.find(text, pos),
+                      expected == std::string_view::npos ? StringSearcher::kNotFound : expected);
+        }
+    }
+}
+
+// Exercises the SIMD blocks, where candidates are filtered by the first and last bytes.
+TEST(StringSearcherTest, FindInLongText) {
+    std::string text(1000, 'a');
+    text[500] = 'b';
+    text[998] = 'b';
+
+    EXPECT_EQ(StringSearcher{"ab"}.find(text), 499_Z);
+    EXPECT_EQ(StringSearcher{"ab"}.find(text, 500), 997_Z);
+    EXPECT_EQ(StringSearcher{"aaab"}.find(text), 497_Z);
+    EXPECT_EQ(StringSearcher{"ba"}.find(text), 500_Z);
+    EXPECT_EQ(StringSearcher{"aba"}.find(text), 499_Z);
+    EXPECT_EQ(StringSearcher{"bb"}.find(text), StringSearcher::kNotFound);
+    EXPECT_EQ(StringSearcher{std::string(999, 'a')}.find(text), StringSearcher::kNotFound);
+    EXPECT_EQ(StringSearcher{std::string(497, 'a')}.find(text, 400), 501_Z);
+}
+
+TEST(StringSearcherTest, FindInTree) {
+    PieceTree tree{"hello world"};
+    EXPECT_EQ(StringSearcher{"world"}.find(tree), 6_Z);
+    EXPECT_EQ(StringSearcher{"world"}.find(tree, 0, tree.length() - 1), std::nullopt);
+    EXPECT_EQ(StringSearcher{"o"}.find(tree, 5), 7_Z);
+    EXPECT_EQ(StringSearcher{"hello"}.find(tree, 1), std::nullopt);
+    EXPECT_EQ(StringSearcher{"z"}.find(tree), std::nullopt);
+}
+
+// Matches that span several pieces are found through the carry buffer.
+TEST(StringSearcherTest, FindAcrossPieces) {
+    std::string str;
+    PieceTree tree;
+    for (size_t i = 0; i < 300; ++i) {
+        std::string text;
+        for (size_t n = util::RandomNumber(1, 6); n > 0; --n) {
+            text += static_cast<char>(util::RandomNumber('a', 'c'));
+        }
+        size_t offset = util::RandomNumber(0, str.length());
+        str.insert(offset, text);
+        tree.insert(offset, text);
+    }
+
+    for (std::string_view pattern : {"a", "abc", "cabbac", "abcabcab", "aaaaaaaaaaaaaaaaaaaa"}) {
+        StringSearcher searcher{pattern};
+        for (size_t start = 0; start < str.length(); start += 37) {
+            size_t end = std::min(start + 200, str.length());
+            size_t expected = std::string_view{str}.substr(0, end).find(pattern, start);
+            std::optional<size_t> result = searcher.find(tree, start, end);
+            if (expected == std::string_view::npos) {
+                EXPECT_EQ(result, std::nullopt);
+            } else {
+                EXPECT_EQ(result, expected);
+            }
+        }
+    }
+}
+
+}  // namespace base
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace base {
+
+// A bounded map that evicts the least recently used entries on insertion when full. Each entry
+// has a cost, e.g., its size in bytes, and the costs of the entries add up to at most the
+// capacity. Entries cost 1 unless given a cost, which makes the capacity an entry count. A
+// capacity of 0 disables the cache. Both lookups and insertions count as a use.
+// https://github.com/lamerman/cpp-lru-cache/blob/master/include/lrucache.hpp
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LRUCache {
+public:
+    explicit LRUCache(size_t capacity) : capacity(capacity) {}
+
+    // Returns nullptr on a miss. The pointer is invalidated by the next insertion.
+    Value* get(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+
+        // Move to the front to mark as most recently used.
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->value;
+    }
+
+    // Entries that cost more than the capacity are not cached.
+    void put(const Key& key, Value value, size_t cost = 1) {
+        erase(key);
+        if (cost > capacity) return;
+
+        while (total_cost + cost > capacity) {
+            total_cost -= entries.back().cost;
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+        entries.push_front({key, std::move(value), cost});
+        index.emplace(key, entries.begin());
+        total_cost += cost;
+    }
+
+    void erase(const Key& key) {
+        auto it = index.find(key);
+        if (it == index.end()) return;
+
+        total_cost -= it->second->cost;
+        entries.erase(it->second);
+        index.erase(it);
+    }
+
+    void clear() {
+        index.clear();
+        entries.clear();
+        total_cost = 0;
+    }
+
+    size_t size() const {
+        return entries.size();
+    }
+
+    bool empty() const {
+        return entries.empty();
+    }
+
+    // The sum of the costs of the entries.
+    size_t cost() const {
+        return total_cost;
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        size_t cost;
+    };
+
+    size_t capacity;
+    size_t total_cost = 0;
+    // Ordered from most to least recently used.
+    std::list<Entry> entries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+};
+
+}  // namespace base
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "base/containers/lru_cache.h"
+#include "base/numeric/literals.h"
+
+#include <string>
+
+namespace base {
+
+TEST(LRUCacheTest, GetAndPut) {
+    LRUCache<int, std::string> cache(2);
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.get(1), nullptr);
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    EXPECT_EQ(cache.size(), 2_Z);
+    ASSERT_NE(cache.get(1), nullptr);
+    EXPECT_EQ(*cache.get(1), "one");
+    ASSERT_NE(cache.get(2), nullptr);
+    EXPECT_EQ(*cache.get(2), "two");
+
+    // Overwriting an existing key doesn't evict anything.
+    cache.put(1, "uno");
+    EXPECT_EQ(cache.size(), 2_Z);
+    EXPECT_EQ(*cache.get(1), "uno");
+}
+
+TEST(LRUCacheTest, EvictsLeastRecentlyUsed) {
+    LRUCache<int, int> cache(2);
+    cache.put(1, 10);
+    cache.put(2, 20);
+
+    // Touch 1 so that 2 becomes the least recently used entry.
+    EXPECT_NE(cache.get(1), nullptr);
+    cache.put(3, 30);
+    EXPECT_EQ(cache.size(), 2_Z);
+    EXPECT_NE(cache.get(1), nullptr);
+    EXPECT_EQ(cache.get(2), nullptr);
+    EXPECT_NE(cache.get(3), nullptr);
+
+    // 1 is now the least recently used entry.
+    cache.put(4, 40);
+    EXPECT_EQ(cache.get(1), nullptr);
+    EXPECT_NE(cache.get(3), nullptr);
+    EXPECT_NE(cache.get(4), nullptr);
+
+    cache.clear();
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.get(3), nullptr);
+}
+
+TEST(LRUCacheTest, EvictsByCost) {
+    LRUCache<int, int> cache(10);
+    cache.put(1, 10, 4);
+    cache.put(2, 20, 4);
+    EXPECT_EQ(cache.cost(), 8_Z);
+
+    // Both entries are evicted to make room.
+    cache.put(3, 30, 9);
+    EXPECT_EQ(cache.size(), 1_Z);
+    EXPECT_EQ(cache.cost(), 9_Z);
+    EXPECT_EQ(cache.get(1), nullptr);
+    EXPECT_EQ(cache.get(2), nullptr);
+
+    // Entries that cost more than the capacity aren't cached, and replace the old value.
+    cache.put(3, 31, 11);
+    EXPECT_EQ(cache.get(3), nullptr);
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.cost(), 0_Z);
+}
+
+TEST(LRUCacheTest, ZeroCapacityIsDisabled) {
+    LRUCache<int, int> cache(0);
+    cache.put(1, 10);
+    EXPECT_TRUE(cache.empty());
+    EXPECT_EQ(cache.get(1), nullptr);
+}
+
+}  // namespace base
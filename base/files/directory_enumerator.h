@@ -0,0 +1,50 @@
+#pragma once
+
+#include "base/files/file_path.h"
+#include "build/build_config.h"
+
+#include <optional>
+
+#if BUILDFLAG(IS_POSIX)
+#include <dirent.h>
+#elif BUILDFLAG(IS_WIN)
+#include <windows.h>
+#endif
+
+namespace base {
+
+// Lists the entries of a single directory, in no particular order. "." and ".." are skipped.
+class DirectoryEnumerator {
+public:
+    struct Entry {
+        FilePath path;
+        // On POSIX, these describe the target of a symlink, and are false if it is dangling. On
+        // Windows, they describe the link itself.
+        bool is_directory = false;
+        bool is_file = false;
+        bool is_symlink = false;
+    };
+
+    explicit DirectoryEnumerator(const FilePath& dir);
+    ~DirectoryEnumerator();
+
+    DirectoryEnumerator(const DirectoryEnumerator&) = delete;
+    DirectoryEnumerator& operator=(const DirectoryEnumerator&) = delete;
+
+    // Returns the next entry, or nothing once all entries were returned or the directory can't
+    // be read.
+    std::optional<Entry> Next();
+
+private:
+    FilePath dir_;
+
+#if BUILDFLAG(IS_POSIX)
+    DIR* dir_handle_ = nullptr;
+#elif BUILDFLAG(IS_WIN)
+    HANDLE find_handle_ = INVALID_HANDLE_VALUE;
+    WIN32_FIND_DATA find_data_;
+    bool has_started_ = false;
+#endif
+};
+
+}  // namespace base
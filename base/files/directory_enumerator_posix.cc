@@ -0,0 +1,38 @@
+#include "directory_enumerator.h"
+
+#include <string_view>
+#include <sys/stat.h>
+
+#include "base/files/file.h"
+
+namespace base {
+
+DirectoryEnumerator::DirectoryEnumerator(const FilePath& dir)
+    : dir_{dir}, dir_handle_{opendir(dir.value().c_str())} {}
+
+DirectoryEnumerator::~DirectoryEnumerator() {
+    if (dir_handle_) closedir(dir_handle_);
+}
+
+std::optional<DirectoryEnumerator::Entry> DirectoryEnumerator::Next() {
+    if (!dir_handle_) return std::nullopt;
+
+    while (const dirent* dent = readdir(dir_handle_)) {
+        std::string_view name = dent->d_name;
+        if (name == FilePath::kCurrentDirectory || name == FilePath::kParentDirectory) continue;
+
+        Entry entry{.path = dir_.Append(name)};
+        stat_wrapper_t file_info;
+        // The entry may have been deleted since it was read.
+        if (File::Lstat(entry.path, &file_info) != 0) continue;
+
+        entry.is_symlink = S_ISLNK(file_info.st_mode);
+        if (entry.is_symlink && File::Stat(entry.path, &file_info) != 0) return entry;
+        entry.is_directory = S_ISDIR(file_info.st_mode);
+        entry.is_file = S_ISREG(file_info.st_mode);
+        return entry;
+    }
+    return std::nullopt;
+}
+
+}  // namespace base
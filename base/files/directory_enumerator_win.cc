@@ -0,0 +1,40 @@
+#include "directory_enumerator.h"
+
+#include <string_view>
+
+namespace base {
+
+DirectoryEnumerator::DirectoryEnumerator(const FilePath& dir) : dir_{dir} {}
+
+DirectoryEnumerator::~DirectoryEnumerator() {
+    if (find_handle_ != INVALID_HANDLE_VALUE) ::FindClose(find_handle_);
+}
+
+std::optional<DirectoryEnumerator::Entry> DirectoryEnumerator::Next() {
+    while (true) {
+        if (!has_started_) {
+            has_started_ = true;
+            FilePath pattern = dir_.Append(FILE_PATH_LITERAL("*"));
+            find_handle_ = ::FindFirstFile(pattern.value().c_str(), &find_data_);
+            if (find_handle_ == INVALID_HANDLE_VALUE) return std::nullopt;
+        } else if (find_handle_ == INVALID_HANDLE_VALUE ||
+                   !::FindNextFile(find_handle_, &find_data_)) {
+            return std::nullopt;
+        }
+
+        std::wstring_view name = find_data_.cFileName;
+        if (name == FilePath::kCurrentDirectory || name == FilePath::kParentDirectory) continue;
+
+        // A symlink has the attributes of its own kind, i.e., a directory or a file link, rather
+        // than of its target.
+        DWORD attributes = find_data_.dwFileAttributes;
+        return Entry{
+            .path = dir_.Append(name),
+            .is_directory = (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0,
+            .is_file = (attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_DEVICE)) == 0,
+            .is_symlink = (attributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0,
+        };
+    }
+}
+
+}  // namespace base
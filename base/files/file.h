@@ -3,6 +3,8 @@
 #include "base/files/file_path.h"
 #include "build/build_config.h"
 
+#include <cstdint>
+
 struct stat;
 
 namespace base {
@@ -11,6 +13,17 @@ using stat_wrapper_t = struct stat;
 
 class File {
 public:
+    // Used to hold information about a given file path.
+    struct Info {
+        // The size of the file in bytes.
+        int64_t size = 0;
+        // True if the file corresponds to a directory.
+        bool is_directory = false;
+        // The time the file was last modified, in units that depend on the platform. It is only
+        // meaningful when compared with other values of it.
+        int64_t last_modified = 0;
+    };
+
 #if BUILDFLAG(IS_POSIX)
     // Wrapper for stat().
     static int Stat(const FilePath& path, stat_wrapper_t* sb);
@@ -1,5 +1,7 @@
 #include "file_util.h"
 
+#include "base/files/scoped_file.h"
+
 namespace base {
 
 bool CloseFile(FILE* file) {
@@ -9,4 +11,15 @@ bool CloseFile(FILE* file) {
     return fclose(file) == 0;
 }
 
+bool WriteFile(const FilePath& filename, std::string_view data) {
+    ScopedFILE fp(OpenFile(filename, "wb"));
+    if (!fp) {
+        return false;
+    }
+    if (fwrite(data.data(), 1, data.size(), fp.get()) != data.size()) {
+        return false;
+    }
+    return CloseFile(fp.release());
+}
+
 }  // namespace base
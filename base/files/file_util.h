@@ -1,11 +1,18 @@
 #pragma once
 
+#include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "build/build_config.h"
 
+#include <string_view>
+
 #if BUILDFLAG(IS_POSIX)
 #include <sys/stat.h>
 #include <unistd.h>
+#elif BUILDFLAG(IS_WIN)
+// windows.h renames some of the functions below, e.g., `DeleteFile` to `DeleteFileW`. Including
+// it here renames them the same way wherever they are declared, defined and called.
+#include <windows.h>
 #endif
 
 namespace base {
@@ -32,6 +39,21 @@ bool PathIsWritable(const FilePath& path);
 // Returns true if the given path exists and is a directory, false otherwise.
 bool DirectoryExists(const FilePath& path);
 
+// Returns information about the given file path. Returns false if the path
+// doesn't exist or can't be accessed.
+bool GetFileInfo(const FilePath& file_path, File::Info* info);
+
+// Deletes the given file. Returns true if it was deleted or didn't exist.
+bool DeleteFile(const FilePath& path);
+
+// Deletes the given file or directory, along with everything inside the directory. Symbolic
+// links are deleted, not followed. Returns true if it was deleted or didn't exist.
+bool DeletePathRecursively(const FilePath& path);
+
+// Creates the given directory, along with any missing parent directories. Returns true if the
+// directory exists afterwards.
+bool CreateDirectory(const FilePath& full_path);
+
 // Reads the given |symlink| and returns the raw string in |target|.
 // Returns false upon failure.
 // IMPORTANT NOTE: if the string stored in the symlink is a relative file path,
@@ -63,6 +85,15 @@ FILE* OpenFile(const FilePath& filename, const char* mode);
 // Closes file opened by OpenFile. Returns true on success.
 bool CloseFile(FILE* file);
 
+// Writes |data| to |filename|, replacing its contents if it exists. Returns true if all of |data|
+// was written.
+bool WriteFile(const FilePath& filename, std::string_view data);
+
+// Renames file |from_path| to |to_path|, replacing |to_path| if it exists. Both
+// paths must be on the same volume. Readers of |to_path| see either the old or
+// the new file, never a partly written one. Returns true on success.
+bool ReplaceFile(const FilePath& from_path, const FilePath& to_path);
+
 #if BUILDFLAG(IS_POSIX)
 
 // Sets the given |fd| to close-on-exec mode.
@@ -1,8 +1,10 @@
 #include "file_util.h"
 
 #include <fcntl.h>
+#include <stdlib.h>
 #include <unistd.h>
 
+#include "base/files/directory_enumerator.h"
 #include "base/files/file.h"
 
 namespace base {
@@ -35,6 +37,56 @@ bool DirectoryExists(const FilePath& path) {
     return S_ISDIR(file_info.st_mode);
 }
 
+bool GetFileInfo(const FilePath& file_path, File::Info* results) {
+    stat_wrapper_t file_info;
+    if (File::Stat(file_path, &file_info) != 0) {
+        return false;
+    }
+    results->size = file_info.st_size;
+    results->is_directory = S_ISDIR(file_info.st_mode);
+#if BUILDFLAG(IS_MAC)
+    const timespec& last_modified = file_info.st_mtimespec;
+#else
+    const timespec& last_modified = file_info.st_mtim;
+#endif
+    results->last_modified =
+        int64_t{last_modified.tv_sec} * 1'000'000'000 + last_modified.tv_nsec;
+    return true;
+}
+
+bool DeleteFile(const FilePath& path) {
+    return unlink(path.value().c_str()) == 0 || errno == ENOENT;
+}
+
+bool DeletePathRecursively(const FilePath& path) {
+    stat_wrapper_t file_info;
+    if (File::Lstat(path, &file_info) != 0) {
+        return errno == ENOENT;
+    }
+    if (!S_ISDIR(file_info.st_mode)) {
+        return DeleteFile(path);
+    }
+
+    bool success = true;
+    DirectoryEnumerator enumerator(path);
+    while (auto entry = enumerator.Next()) {
+        success &= DeletePathRecursively(entry->path);
+    }
+    return rmdir(path.value().c_str()) == 0 && success;
+}
+
+bool CreateDirectory(const FilePath& full_path) {
+    if (DirectoryExists(full_path)) {
+        return true;
+    }
+    FilePath parent = full_path.DirName();
+    if (parent != full_path && !CreateDirectory(parent)) {
+        return false;
+    }
+    // Another thread or process may have created the directory in the meantime.
+    return mkdir(full_path.value().c_str(), 0700) == 0 || DirectoryExists(full_path);
+}
+
 bool ReadSymbolicLink(const FilePath& symlink_path, FilePath* target_path) {
     char buf[PATH_MAX];
     ssize_t count = ::readlink(symlink_path.value().c_str(), buf, std::size(buf));
@@ -49,6 +101,14 @@ bool ReadSymbolicLink(const FilePath& symlink_path, FilePath* target_path) {
     return true;
 }
 
+#if !BUILDFLAG(IS_MAC)
+bool GetTempDir(FilePath* path) {
+    const char* tmp = getenv("TMPDIR");
+    *path = FilePath(tmp && *tmp ? tmp : "/tmp");
+    return true;
+}
+#endif
+
 namespace {
 
 #if !BUILDFLAG(IS_MAC)
@@ -89,6 +149,10 @@ FILE* OpenFile(const FilePath& filename, const char* mode) {
     return result;
 }
 
+bool ReplaceFile(const FilePath& from_path, const FilePath& to_path) {
+    return rename(from_path.value().c_str(), to_path.value().c_str()) == 0;
+}
+
 bool SetCloseOnExec(int fd) {
     const int flags = fcntl(fd, F_GETFD);
     if (flags == -1) {
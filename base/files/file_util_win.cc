@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <windows.h>
 
+#include "base/files/directory_enumerator.h"
 #include "base/windows/unicode.h"
 
 namespace base {
@@ -53,6 +54,66 @@ bool DirectoryExists(const FilePath& path) {
     return false;
 }
 
+bool GetFileInfo(const FilePath& file_path, File::Info* results) {
+    WIN32_FILE_ATTRIBUTE_DATA attr;
+    if (!::GetFileAttributesEx(file_path.value().c_str(), GetFileExInfoStandard, &attr)) {
+        return false;
+    }
+
+    ULARGE_INTEGER size;
+    size.HighPart = attr.nFileSizeHigh;
+    size.LowPart = attr.nFileSizeLow;
+    results->size = static_cast<int64_t>(size.QuadPart);
+    results->is_directory = (attr.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    ULARGE_INTEGER last_modified;
+    last_modified.HighPart = attr.ftLastWriteTime.dwHighDateTime;
+    last_modified.LowPart = attr.ftLastWriteTime.dwLowDateTime;
+    results->last_modified = static_cast<int64_t>(last_modified.QuadPart);
+    return true;
+}
+
+bool DeleteFile(const FilePath& path) {
+    if (::DeleteFile(path.value().c_str())) return true;
+    DWORD error = ::GetLastError();
+    return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+}
+
+bool DeletePathRecursively(const FilePath& path) {
+    DWORD fileattr = ::GetFileAttributes(path.value().c_str());
+    if (fileattr == INVALID_FILE_ATTRIBUTES) {
+        DWORD error = ::GetLastError();
+        return error == ERROR_FILE_NOT_FOUND || error == ERROR_PATH_NOT_FOUND;
+    }
+    if (!(fileattr & FILE_ATTRIBUTE_DIRECTORY)) return DeleteFile(path);
+
+    // A directory symlink or junction is removed as an empty directory, without deleting what it
+    // points to.
+    bool success = true;
+    if (!(fileattr & FILE_ATTRIBUTE_REPARSE_POINT)) {
+        DirectoryEnumerator enumerator(path);
+        while (auto entry = enumerator.Next()) {
+            success &= DeletePathRecursively(entry->path);
+        }
+    }
+    return ::RemoveDirectory(path.value().c_str()) && success;
+}
+
+bool CreateDirectory(const FilePath& full_path) {
+    if (DirectoryExists(full_path)) return true;
+    FilePath parent = full_path.DirName();
+    if (parent != full_path && !CreateDirectory(parent)) return false;
+    // Another thread or process may have created the directory in the meantime.
+    return ::CreateDirectory(full_path.value().c_str(), nullptr) || DirectoryExists(full_path);
+}
+
+bool GetTempDir(FilePath* path) {
+    wchar_t temp_path[MAX_PATH + 1];
+    DWORD length = ::GetTempPath(MAX_PATH + 1, temp_path);
+    if (length == 0 || length > MAX_PATH) return false;
+    *path = FilePath(std::wstring_view(temp_path, length));
+    return true;
+}
+
 namespace {
 
 // Appends |mode_char| to |mode| before the optional character set encoding; see
@@ -72,4 +133,9 @@ FILE* OpenFile(const FilePath& filename, const char* mode) {
     return _wfsopen(filename.value().c_str(), w_mode.c_str(), _SH_DENYNO);
 }
 
+bool ReplaceFile(const FilePath& from_path, const FilePath& to_path) {
+    return ::MoveFileEx(from_path.value().c_str(), to_path.value().c_str(),
+                        MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
 }  // namespace base
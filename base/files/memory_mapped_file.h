@@ -0,0 +1,43 @@
+#pragma once
+
+#include "base/files/file_path.h"
+#include "build/build_config.h"
+
+#include <string_view>
+
+#if BUILDFLAG(IS_WIN)
+#include <windows.h>
+#endif
+
+namespace base {
+
+// A read-only mapping of an entire file into memory.
+class MemoryMappedFile {
+public:
+    MemoryMappedFile() = default;
+    ~MemoryMappedFile();
+
+    MemoryMappedFile(const MemoryMappedFile&) = delete;
+    MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+    // Opens and maps the file at |path|. Returns false on failure. An empty file is valid, but
+    // has no data.
+    bool Initialize(const FilePath& path);
+    bool IsValid() const;
+
+    // The contents of the file. Only valid while this object is alive.
+    std::string_view data() const;
+
+private:
+    void CloseHandles();
+
+    const char* data_ = nullptr;
+    size_t length_ = 0;
+    bool valid_ = false;
+
+#if BUILDFLAG(IS_WIN)
+    HANDLE file_mapping_ = nullptr;
+#endif
+};
+
+}  // namespace base
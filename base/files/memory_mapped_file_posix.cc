@@ -0,0 +1,58 @@
+#include "memory_mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace base {
+
+MemoryMappedFile::~MemoryMappedFile() {
+    CloseHandles();
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& path) {
+    CloseHandles();
+
+    int fd = open(path.value().c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0 || !S_ISREG(file_info.st_mode)) {
+        close(fd);
+        return false;
+    }
+
+    length_ = file_info.st_size;
+    if (length_ > 0) {
+        void* data = mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            length_ = 0;
+            return false;
+        }
+        data_ = static_cast<const char*>(data);
+    }
+
+    // The mapping stays valid after the descriptor is closed.
+    close(fd);
+    valid_ = true;
+    return true;
+}
+
+bool MemoryMappedFile::IsValid() const {
+    return valid_;
+}
+
+std::string_view MemoryMappedFile::data() const {
+    return {data_, length_};
+}
+
+void MemoryMappedFile::CloseHandles() {
+    if (data_) munmap(const_cast<char*>(data_), length_);
+    data_ = nullptr;
+    length_ = 0;
+    valid_ = false;
+}
+
+}  // namespace base
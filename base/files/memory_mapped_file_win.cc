@@ -0,0 +1,62 @@
+#include "memory_mapped_file.h"
+
+namespace base {
+
+MemoryMappedFile::~MemoryMappedFile() {
+    CloseHandles();
+}
+
+bool MemoryMappedFile::Initialize(const FilePath& path) {
+    CloseHandles();
+
+    constexpr DWORD kFileShareAll = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    HANDLE file = ::CreateFile(path.value().c_str(), GENERIC_READ, kFileShareAll, nullptr,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size)) {
+        ::CloseHandle(file);
+        return false;
+    }
+
+    length_ = static_cast<size_t>(size.QuadPart);
+    if (length_ > 0) {
+        file_mapping_ = ::CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!file_mapping_) {
+            ::CloseHandle(file);
+            length_ = 0;
+            return false;
+        }
+        data_ = static_cast<const char*>(::MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0));
+        if (!data_) {
+            ::CloseHandle(file);
+            CloseHandles();
+            return false;
+        }
+    }
+
+    // The mapping keeps the file open.
+    ::CloseHandle(file);
+    valid_ = true;
+    return true;
+}
+
+bool MemoryMappedFile::IsValid() const {
+    return valid_;
+}
+
+std::string_view MemoryMappedFile::data() const {
+    return {data_, length_};
+}
+
+void MemoryMappedFile::CloseHandles() {
+    if (data_) ::UnmapViewOfFile(data_);
+    if (file_mapping_) ::CloseHandle(file_mapping_);
+    data_ = nullptr;
+    file_mapping_ = nullptr;
+    length_ = 0;
+    valid_ = false;
+}
+
+}  // namespace base
@@ -7,6 +7,8 @@ namespace base {
 enum class PathKey {
     kFileExe,
     kDirAssets,
+    // The user's cache directory, for files that speed up later launches and may be deleted.
+    kDirCache,
 };
 
 // The path service is a global table mapping keys to file system paths.
@@ -4,6 +4,8 @@
 
 #include "base/files/file_util.h"
 
+#include <cstdlib>
+
 namespace base {
 
 namespace {
@@ -19,6 +21,17 @@ FilePath ExecutablePath() {
     return bin_dir;
 }
 
+// https://specifications.freedesktop.org/basedir-spec/latest/
+FilePath CachePath() {
+    if (const char* cache_home = std::getenv("XDG_CACHE_HOME"); cache_home && *cache_home) {
+        return FilePath(cache_home);
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return FilePath(home).Append(".cache");
+    }
+    return FilePath("/tmp");
+}
+
 }  // namespace
 
 FilePath PathService::get_special_path(PathKey key) {
@@ -27,6 +40,8 @@ FilePath PathService::get_special_path(PathKey key) {
         return ExecutablePath();
     case PathKey::kDirAssets:
         return ExecutablePath().DirName();
+    case PathKey::kDirCache:
+        return CachePath();
     }
 }
 
@@ -48,6 +48,8 @@ FilePath PathService::get_special_path(PathKey key) {
         return ExecutablePath();
     case PathKey::kDirAssets:
         return ResourcesPath();
+    case PathKey::kDirCache:
+        return GetHomeDir().Append("Library").Append("Caches");
     }
 }
 
@@ -24,6 +24,15 @@ FilePath ExecutablePath() {
     return FilePath(system_buffer);
 }
 
+FilePath CachePath() {
+    wchar_t system_buffer[MAX_PATH];
+    DWORD length = ::GetEnvironmentVariable(L"LOCALAPPDATA", system_buffer, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) {
+        return ExecutablePath().DirName();
+    }
+    return FilePath(system_buffer);
+}
+
 }  // namespace
 
 FilePath PathService::get_special_path(PathKey key) {
@@ -32,6 +41,8 @@ FilePath PathService::get_special_path(PathKey key) {
         return ExecutablePath();
     case PathKey::kDirAssets:
         return ExecutablePath().DirName();
+    case PathKey::kDirCache:
+        return CachePath();
     }
 }
 
@@ -0,0 +1,74 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+namespace base {
+
+ThreadPool::ThreadPool(size_t thread_count) {
+    thread_count = std::max<size_t>(thread_count, 1);
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        threads.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+        pending -= tasks.size();
+        tasks.clear();
+    }
+    task_available.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::post(std::function<void()> task) {
+    {
+        std::lock_guard lock(mutex);
+        if (stopping) return;
+        tasks.emplace_back(std::move(task));
+        ++pending;
+    }
+    task_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(mutex);
+    idle.wait(lock, [this] { return pending == 0; });
+}
+
+size_t ThreadPool::thread_count() const {
+    return threads.size();
+}
+
+size_t ThreadPool::DefaultThreadCount() {
+    size_t cores = std::thread::hardware_concurrency();
+    return cores > 1 ? cores - 1 : 1;
+}
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex);
+            task_available.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+
+        task();
+
+        bool now_idle;
+        {
+            std::lock_guard lock(mutex);
+            now_idle = --pending == 0;
+        }
+        if (now_idle) idle.notify_all();
+    }
+}
+
+}  // namespace base
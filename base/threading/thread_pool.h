@@ -0,0 +1,47 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace base {
+
+// A fixed number of worker threads that run posted tasks in FIFO order.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t thread_count = DefaultThreadCount());
+    // Drops the tasks that haven't started, and waits for the running ones to finish.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Tasks may post more tasks.
+    void post(std::function<void()> task);
+    // Blocks until every posted task, including ones posted meanwhile, has finished.
+    void wait();
+
+    size_t thread_count() const;
+
+    // One thread per core, leaving one for the UI thread.
+    static size_t DefaultThreadCount();
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::condition_variable idle;
+    std::deque<std::function<void()>> tasks;
+    // The number of tasks that are queued or running.
+    size_t pending = 0;
+    bool stopping = false;
+
+    void run();
+};
+
+}  // namespace base
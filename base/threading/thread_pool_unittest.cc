@@ -0,0 +1,37 @@
+#include "base/threading/thread_pool.h"
+#include "base/numeric/literals.h"
+
+#include <atomic>
+#include <gtest/gtest.h>
+
+namespace base {
+
+TEST(ThreadPoolTest, RunsAllTasks) {
+    ThreadPool pool(4);
+    EXPECT_EQ(pool.thread_count(), 4_Z);
+
+    std::atomic<size_t> count = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        pool.post([&count] { ++count; });
+    }
+    pool.wait();
+    EXPECT_EQ(count, 1000_Z);
+}
+
+TEST(ThreadPoolTest, TasksPostTasks) {
+    ThreadPool pool(2);
+    std::atomic<size_t> count = 0;
+    std::function<void(size_t)> fan_out = [&](size_t depth) {
+        ++count;
+        if (depth == 0) return;
+        pool.post([&, depth] { fan_out(depth - 1); });
+        pool.post([&, depth] { fan_out(depth - 1); });
+    };
+    pool.post([&] { fan_out(9); });
+
+    // Waiting covers the tasks posted while waiting.
+    pool.wait();
+    EXPECT_EQ(count, 1023_Z);
+}
+
+}  // namespace base
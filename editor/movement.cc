@@ -1,6 +1,6 @@
 #include "movement.h"
 
-#include "third_party/uni_algo/include/uni_algo/prop.h"
+#include "unicode/char_kind.h"
 
 #include <numeric>
 #include <optional>
@@ -19,15 +19,8 @@ namespace gui {
 namespace movement {
 
 namespace {
-
-enum class CharKind {
-    kWhitespace,
-    kPunctuation,
-    kWord,
-};
-
-constexpr CharKind to_kind(int32_t codepoint);
-
+using unicode::CharKind;
+using unicode::to_kind;
 }  // namespace
 
 size_t column_at_x(const font::LineLayout& layout, int x) {
@@ -191,19 +184,5 @@ bool is_inside_word(const base::PieceTree& tree, size_t offset) {
     return prev_kind == CharKind::kWord && next_kind == CharKind::kWord;
 }
 
-namespace {
-
-constexpr CharKind to_kind(int32_t codepoint) {
-    if (una::codepoint::is_whitespace(codepoint)) {
-        return CharKind::kWhitespace;
-    } else if (una::codepoint::is_alphanumeric(codepoint) || codepoint == '_') {
-        return CharKind::kWord;
-    } else {
-        return CharKind::kPunctuation;
-    }
-}
-
-}  // namespace
-
 }  // namespace movement
 }  // namespace gui
@@ -11,7 +11,7 @@ namespace {
 font::LineLayout CreateLayout(std::string_view str) {
     auto& rasterizer = font::FontRasterizer::instance();
     size_t font_id = rasterizer.add_system_font(32);
-    return rasterizer.layout_line(font_id, str);
+    return rasterizer.layout_line(font_id, str, 2);
 }
 }  // namespace
 
@@ -0,0 +1,112 @@
+#include "font/distance_field.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace font {
+
+namespace {
+
+// Stands in for the distance from pixels that have no zero pixel in their row or column. It is
+// finite so that the parabolas rooted at such pixels still intersect the others.
+constexpr float kInfinity = 1e20f;
+
+// Scratch space for the distance transform of a row or column.
+struct Envelope {
+    std::vector<float> values;
+    // The roots of the parabolas in the lower envelope, and the boundaries between them.
+    std::vector<int> roots;
+    std::vector<float> bounds;
+};
+
+// Replaces the `size` samples of `f`, `stride` apart, with their squared distance transform. This
+// is the exact linear-time algorithm by Felzenszwalb and Huttenlocher: each sample becomes the
+// lowest of the parabolas rooted at every sample.
+void DistanceTransform(float* f, int size, int stride, Envelope& envelope) {
+    auto& [values, roots, bounds] = envelope;
+    values.resize(size);
+    roots.resize(size);
+    bounds.resize(size + 1);
+    for (int q = 0; q < size; ++q) {
+        values[q] = f[q * stride];
+    }
+
+    int k = 0;
+    roots[0] = 0;
+    bounds[0] = -kInfinity;
+    bounds[1] = kInfinity;
+    for (int q = 1; q < size; ++q) {
+        float s;
+        while (true) {
+            int r = roots[k];
+            s = ((values[q] + q * q) - (values[r] + r * r)) / (2.0f * (q - r));
+            if (s > bounds[k]) break;
+            --k;
+        }
+        ++k;
+        roots[k] = q;
+        bounds[k] = s;
+        bounds[k + 1] = kInfinity;
+    }
+
+    k = 0;
+    for (int q = 0; q < size; ++q) {
+        while (bounds[k + 1] < q) ++k;
+        int r = roots[k];
+        f[q * stride] = (q - r) * (q - r) + values[r];
+    }
+}
+
+// Returns the squared distance from each pixel to the nearest pixel where `grid` is zero.
+void DistanceTransform(std::vector<float>& grid, int width, int height) {
+    Envelope envelope;
+    for (int x = 0; x < width; ++x) {
+        DistanceTransform(&grid[x], height, width, envelope);
+    }
+    for (int y = 0; y < height; ++y) {
+        DistanceTransform(&grid[y * width], width, 1, envelope);
+    }
+}
+
+}  // namespace
+
+std::vector<uint8_t> DistanceField(std::span<const uint8_t> coverage,
+                                   int width,
+                                   int height,
+                                   int spread) {
+    int field_width = width + spread * 2;
+    int field_height = height + spread * 2;
+    size_t size = static_cast<size_t>(field_width) * field_height;
+
+    // Pixels that are at least half covered are inside the glyph.
+    std::vector<bool> inside(size, false);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            if (coverage[y * width + x] >= 128) {
+                inside[(y + spread) * field_width + x + spread] = true;
+            }
+        }
+    }
+
+    // The distance to the nearest inside pixel, for pixels outside, and vice versa.
+    std::vector<float> to_inside(size);
+    std::vector<float> to_outside(size);
+    for (size_t i = 0; i < size; ++i) {
+        to_inside[i] = inside[i] ? 0 : kInfinity;
+        to_outside[i] = inside[i] ? kInfinity : 0;
+    }
+    DistanceTransform(to_inside, field_width, field_height);
+    DistanceTransform(to_outside, field_width, field_height);
+
+    std::vector<uint8_t> field(size);
+    for (size_t i = 0; i < size; ++i) {
+        // The outline lies halfway between an inside pixel and its nearest outside pixel.
+        float distance = inside[i] ? std::sqrt(to_outside[i]) - 0.5f
+                                   : 0.5f - std::sqrt(to_inside[i]);
+        float value = 128 + distance * 128 / spread;
+        field[i] = static_cast<uint8_t>(std::clamp(std::lround(value), 0L, 255L));
+    }
+    return field;
+}
+
+}  // namespace font
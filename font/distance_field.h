@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace font {
+
+// Converts a glyph's coverage bitmap, with a byte per pixel, into a signed distance field padded
+// by `spread` pixels on each side. Each byte is the distance to the glyph's outline: 128 on the
+// outline, rising to 255 at `spread` pixels inside and falling to 0 at `spread` pixels outside.
+// With linear filtering and a threshold at 128, the field draws the glyph sharply at any size.
+std::vector<uint8_t> DistanceField(std::span<const uint8_t> coverage,
+                                   int width,
+                                   int height,
+                                   int spread);
+
+}  // namespace font
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+
+#include "font/distance_field.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace font {
+
+namespace {
+
+constexpr int kSpread = 4;
+
+}  // namespace
+
+TEST(DistanceFieldTest, Square) {
+    constexpr int kSize = 10;
+    std::vector<uint8_t> coverage(kSize * kSize, 255);
+    auto field = DistanceField(coverage, kSize, kSize, kSpread);
+
+    constexpr int kFieldSize = kSize + kSpread * 2;
+    ASSERT_EQ(field.size(), static_cast<size_t>(kFieldSize * kFieldSize));
+    auto at = [&](int x, int y) { return field[y * kFieldSize + x]; };
+
+    // Half a pixel on either side of the outline.
+    EXPECT_EQ(at(kSpread, kFieldSize / 2), 128 + 128 / kSpread / 2);
+    EXPECT_EQ(at(kSpread - 1, kFieldSize / 2), 128 - 128 / kSpread / 2);
+    // Saturated at the spread.
+    EXPECT_EQ(at(kFieldSize / 2, kFieldSize / 2), 255);
+    EXPECT_EQ(at(0, 0), 0);
+
+    // Distances increase towards the center, in every direction.
+    for (int i = 1; i <= kFieldSize / 2; ++i) {
+        EXPECT_GE(at(i, kFieldSize / 2), at(i - 1, kFieldSize / 2));
+        EXPECT_GE(at(kFieldSize / 2, i), at(kFieldSize / 2, i - 1));
+        EXPECT_GE(at(i, i), at(i - 1, i - 1));
+    }
+}
+
+// Coverage follows the outline, so thresholding the field gives back the glyph.
+TEST(DistanceFieldTest, Threshold) {
+    constexpr int kWidth = 7;
+    constexpr int kHeight = 5;
+    std::vector<uint8_t> coverage = {
+        0,   0,   0,   0,   0,   0,   0,    //
+        0,   255, 255, 255, 200, 0,   0,    //
+        0,   255, 0,   0,   255, 100, 0,    //
+        0,   255, 255, 255, 255, 0,   0,    //
+        0,   0,   0,   0,   0,   0,   255,  //
+    };
+    auto field = DistanceField(coverage, kWidth, kHeight, kSpread);
+
+    int field_width = kWidth + kSpread * 2;
+    for (int y = 0; y < kHeight; ++y) {
+        for (int x = 0; x < kWidth; ++x) {
+            uint8_t value = field[(y + kSpread) * field_width + x + kSpread];
+            EXPECT_EQ(value >= 128, coverage[y * kWidth + x] >= 128) << x << ", " << y;
+        }
+    }
+}
+
+TEST(DistanceFieldTest, Empty) {
+    std::vector<uint8_t> coverage(3 * 2, 0);
+    auto field = DistanceField(coverage, 3, 2, kSpread);
+    ASSERT_EQ(field.size(), static_cast<size_t>((3 + kSpread * 2) * (2 + kSpread * 2)));
+    for (uint8_t value : field) {
+        EXPECT_EQ(value, 0);
+    }
+
+    EXPECT_EQ(DistanceField({}, 0, 0, kSpread).size(), static_cast<size_t>(kSpread * kSpread * 4));
+}
+
+}  // namespace font
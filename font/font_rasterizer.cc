@@ -1,7 +1,11 @@
 #include "font_rasterizer.h"
 
+#include "base/files/file_util.h"
 #include "base/hash/hash.h"
 
+#include <algorithm>
+#include <fmt/format.h>
+
 namespace font {
 
 FontRasterizer& FontRasterizer::instance() {
@@ -9,14 +13,61 @@ FontRasterizer& FontRasterizer::instance() {
     return renderer;
 }
 
-const Metrics& FontRasterizer::metrics(size_t font_id) const {
-    return font_id_to_metrics.at(font_id);
+const Metrics& FontRasterizer::metrics(size_t font_id, int scale) const {
+    return font_id_to_metrics.at(font_id)[clamp_scale(scale) - 1];
 }
 
 std::string_view FontRasterizer::postscript_name(size_t font_id) const {
     return font_id_to_postscript_name.at(font_id);
 }
 
+std::string_view FontRasterizer::file_key(size_t font_id) const {
+    return font_id_to_file_key.at(font_id);
+}
+
+size_t FontRasterizer::font_count() const {
+    return font_id_to_metrics.size();
+}
+
+int FontRasterizer::clamp_scale(int scale) {
+    return std::clamp(scale, 1, kMaxScale);
+}
+
+void FontRasterizer::pack_batch(GlyphBatch& batch) {
+    // Rows are about as wide as a line of text at large sizes. Each row is as tall as its tallest
+    // glyph.
+    constexpr int kMaxBatchWidth = 1024;
+
+    int x = 0;
+    int y = 0;
+    int row_height = 0;
+    batch.width = 0;
+    for (auto& glyph : batch.glyphs) {
+        int width = std::max(glyph.rglyph.width, 0);
+        int height = std::max(glyph.rglyph.height, 0);
+        if (x > 0 && x + width > kMaxBatchWidth) {
+            x = 0;
+            y += row_height;
+            row_height = 0;
+        }
+        glyph.x = x;
+        glyph.y = y;
+        x += width;
+        row_height = std::max(height, row_height);
+        batch.width = std::max(x, batch.width);
+    }
+    batch.height = y + row_height;
+    batch.buffer.assign(static_cast<size_t>(batch.width) * batch.height * 4, 0);
+}
+
+#if BUILDFLAG(IS_POSIX)
+std::string FontRasterizer::file_key_from_path(std::string_view path) {
+    base::File::Info info;
+    if (!base::GetFileInfo(base::FilePath{path}, &info)) return {};
+    return fmt::format("{}:{}:{}", path, info.size, info.last_modified);
+}
+#endif
+
 size_t FontRasterizer::hash_font(std::string_view font_name8, int font_size) const {
     uint64_t str_hash = base::hash_string(font_name8);
     return base::hash_combine(str_hash, font_size);
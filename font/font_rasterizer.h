@@ -1,8 +1,12 @@
 #pragma once
 
+#include "build/build_config.h"
 #include "font/types.h"
 
+#include <array>
 #include <memory>
+#include <mutex>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -17,6 +21,9 @@ public:
     FontRasterizer(const FontRasterizer&) = delete;
     FontRasterizer& operator=(const FontRasterizer&) = delete;
 
+    // The largest supported display scale. Metrics are computed for every scale up front.
+    static constexpr int kMaxScale = 4;
+
     FontId add_font(std::string_view font_name8,
                     int font_size,
                     FontStyle font_style = FontStyle::kNone);
@@ -24,11 +31,45 @@ public:
     // TODO: Clean this up. Consider keeping the same font ID or change method name from "resize"
     // to "create copy".
     FontId resize_font(FontId font_id, int font_size);
-    const Metrics& metrics(FontId font_id) const;
+    // Metrics and line layouts are at the display scale of the window that they are for, which is
+    // clamped to [1, `kMaxScale`]. The font size is the same at every scale.
+    const Metrics& metrics(FontId font_id, int scale) const;
+    static int clamp_scale(int scale);
     std::string_view postscript_name(FontId font_id) const;
+    // Identifies the file that the font was loaded from and the file's version, so that glyphs
+    // saved for the font aren't reused once the font is updated. This is empty if the file is
+    // unknown.
+    std::string_view file_key(FontId font_id) const;
+    // Font IDs are assigned consecutively, starting at 0.
+    size_t font_count() const;
 
-    RasterizedGlyph rasterize(FontId font_id, uint32_t glyph_id) const;
-    LineLayout layout_line(FontId font_id, std::string_view str8);
+    // This is safe to call from worker threads, including while the UI thread adds fonts or lays
+    // out text. Glyphs are rasterized at `scale`, which should be the scale of the layout they
+    // came from, since the current scale may change in the meantime. The glyph is shifted right by
+    // `x_phase / kSubpixelPhases` of a pixel.
+    RasterizedGlyph rasterize(FontId font_id, uint32_t glyph_id, int scale, int x_phase) const;
+    // Like above, but the BGRA bitmap is drawn into `buffer`, e.g., an upload staging buffer, and
+    // the returned glyph's own buffer is left empty. If `buffer` holds fewer than
+    // `width * height * 4` bytes of the returned glyph, nothing is drawn. The returned glyph's
+    // bounds and `colored` are set either way, so an empty `buffer` only measures the glyph.
+    RasterizedGlyph rasterize(FontId font_id,
+                              uint32_t glyph_id,
+                              int scale,
+                              int x_phase,
+                              std::span<uint8_t> buffer) const;
+    // Rasterizes several glyphs of a font at `scale` at once, e.g., the glyphs of a line that
+    // aren't cached yet. This pays the per-call costs of `rasterize()`, such as locking and
+    // clearing the drawing surface, once for the whole batch. This is safe to call from worker
+    // threads, like `rasterize()`.
+    GlyphBatch rasterize_batch(FontId font_id,
+                               int scale,
+                               std::span<const BatchGlyph> glyphs) const;
+    LineLayout layout_line(FontId font_id, std::string_view str8, int scale);
+#if BUILDFLAG(IS_LINUX)
+    // Returns whether `layout_line()` lays out lines of printable ASCII in `font_id` at `scale`
+    // without shaping them. This is for tests.
+    bool has_ascii_fast_path(FontId font_id, int scale);
+#endif
 
 private:
     friend class impl;
@@ -39,8 +80,21 @@ private:
     struct NativeFontType;
     std::unordered_map<size_t, FontId> font_hash_to_id;
     std::vector<NativeFontType> font_id_to_native;
-    std::vector<Metrics> font_id_to_metrics;
+    // Indexed by the font, then by the scale minus one.
+    std::vector<std::array<Metrics, kMaxScale>> font_id_to_metrics;
     std::vector<std::string> font_id_to_postscript_name;
+    std::vector<std::string> font_id_to_file_key;
+    // Guards the tables above against `rasterize()` on worker threads. Only the UI thread adds
+    // fonts, so it may read the tables without locking.
+    mutable std::mutex font_mutex;
+
+    // Places the measured glyphs of `batch` in rows, and sizes its image to fit them.
+    static void pack_batch(GlyphBatch& batch);
+#if BUILDFLAG(IS_POSIX)
+    // Returns the `file_key()` of the font file at `path`, which is the path with the file's size
+    // and modification time. Returns an empty key if the file can't be found.
+    static std::string file_key_from_path(std::string_view path);
+#endif
 
     // TODO: This is a hack for DirectWrite. Find a way to make this private.
 public:
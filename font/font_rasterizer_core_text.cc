@@ -10,6 +10,9 @@
 #include <CoreGraphics/CoreGraphics.h>
 #include <CoreText/CoreText.h>
 
+#include <algorithm>
+#include <climits>
+
 // TODO: Debug use; remove this.
 #include <cassert>
 #include <fmt/base.h>
@@ -26,6 +29,13 @@ namespace font {
 namespace {
 ScopedCFTypeRef<CTLineRef> CreateCTLine(CTFontRef ct_font, FontId font_id, std::string_view str8);
 bool FontSmoothingEnabled();
+RasterizedGlyph MeasureGlyph(CTFontRef font_ref, CGGlyph glyph_index, int scale, int x_phase);
+void DrawGlyphs(std::span<uint8_t> image,
+                int width,
+                int height,
+                CTFontRef font_ref,
+                int scale,
+                std::span<const GlyphBatch::Glyph> glyphs);
 }  // namespace
 
 struct FontRasterizer::NativeFontType {
@@ -80,84 +90,81 @@ FontId FontRasterizer::resize_font(FontId font_id, int font_size) {
     return cache_font({copy}, font_size);
 }
 
-RasterizedGlyph FontRasterizer::rasterize(FontId font_id, uint32_t glyph_id) const {
-    CTFontRef font_ref = font_id_to_native[font_id].font.get();
-
-    if (!font_ref) {
-        fmt::println("FontRasterizer::rasterize() error: CTFontRef is null!");
-        std::abort();
+RasterizedGlyph FontRasterizer::rasterize(FontId font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase) const {
+    // Core Text fonts are thread-safe, so only the lookup is guarded.
+    CTFontRef font_ref;
+    {
+        std::lock_guard lock{font_mutex};
+        font_ref = font_id_to_native[font_id].font.get();
     }
 
-    CGGlyph glyph_index = glyph_id;
-    CGRect bounds = CTFontGetBoundingRectsForGlyphs(font_ref, kCTFontOrientationDefault,
-                                                    &glyph_index, nullptr, 1);
-
-    // TODO: Don't hard-code scale factor.
-    int scale_factor = 2;
-
-    int left = std::floor(bounds.origin.x);
-    int descent = std::ceil(-bounds.origin.y);
-    int ascent = std::ceil(bounds.origin.y + bounds.size.height);
-    int width = std::ceil(bounds.origin.x + bounds.size.width);
-    int height = ascent + descent;
-    int top = ascent;
+    auto rglyph = MeasureGlyph(font_ref, glyph_id, scale, x_phase);
+    GlyphBatch::Glyph glyph = {glyph_id, x_phase, std::move(rglyph), 0, 0};
+    int width = glyph.rglyph.width;
+    int height = glyph.rglyph.height;
+    if (width <= 0 || height <= 0) return std::move(glyph.rglyph);
 
-    width *= 2;
-    height *= 2;
-    top *= 2;
-    // TODO: Why do we not scale `top` and `left` here?
-    // left *= 2;
-    // descent *= 2;
+    std::vector<uint8_t> buffer(static_cast<size_t>(width) * height * 4);
+    DrawGlyphs(buffer, width, height, font_ref, scale, {&glyph, 1});
+    glyph.rglyph.buffer = std::move(buffer);
+    return std::move(glyph.rglyph);
+}
 
-    if (width < 0 || height < 0) {
-        fmt::println("Warning: width/height < 0 for font ID = {}, glyph ID = {}, font name = {}",
-                     font_id, glyph_id, font_id_to_postscript_name[font_id]);
-        return {};
+// https://skia.googlesource.com/skia/+/0a7c7b0b96fc897040e71ea3304d9d6a042cda8b/modules/skshaper/src/SkShaper_coretext.cpp#195
+RasterizedGlyph FontRasterizer::rasterize(FontId font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase,
+                                          std::span<uint8_t> buffer) const {
+    CTFontRef font_ref;
+    {
+        std::lock_guard lock{font_mutex};
+        font_ref = font_id_to_native[font_id].font.get();
     }
 
-    std::vector<uint8_t> bitmap_data(height * width * 4);
-    auto color_space_ref = ScopedTypeRef<CGColorSpaceRef>(CGColorSpaceCreateDeviceRGB());
-    auto context = ScopedTypeRef<CGContextRef>(CGBitmapContextCreate(
-        bitmap_data.data(), width, height, 8, width * 4, color_space_ref.get(),
-        kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host));
-
-    CGContextSetAllowsFontSmoothing(context.get(), true);
-    CGContextSetShouldSmoothFonts(context.get(), FontSmoothingEnabled());
-    CGContextSetAllowsFontSubpixelQuantization(context.get(), true);
-    CGContextSetShouldSubpixelQuantizeFonts(context.get(), true);
-    CGContextSetAllowsFontSubpixelPositioning(context.get(), true);
-    CGContextSetShouldSubpixelPositionFonts(context.get(), true);
-    CGContextSetAllowsAntialiasing(context.get(), true);
-    CGContextSetShouldAntialias(context.get(), true);
-
-    CGContextSetRGBFillColor(context.get(), 1.0, 1.0, 1.0, 1.0);
+    auto rglyph = MeasureGlyph(font_ref, glyph_id, scale, x_phase);
+    GlyphBatch::Glyph glyph = {glyph_id, x_phase, std::move(rglyph), 0, 0};
+    int width = glyph.rglyph.width;
+    int height = glyph.rglyph.height;
+    if (width <= 0 || height <= 0 || buffer.size() < static_cast<size_t>(width) * height * 4) {
+        return std::move(glyph.rglyph);
+    }
 
-    // TODO: Why do we not offset by `-left` here?
-    CGPoint rasterization_origin = CGPointMake(0, descent);
-    CGContextScaleCTM(context.get(), scale_factor, scale_factor);
+    // The bitmap context draws straight into `buffer`.
+    DrawGlyphs(buffer, width, height, font_ref, scale, {&glyph, 1});
+    return std::move(glyph.rglyph);
+}
 
-    CTFontDrawGlyphs(font_ref, &glyph_index, &rasterization_origin, 1, context.get());
+GlyphBatch FontRasterizer::rasterize_batch(FontId font_id,
+                                           int scale,
+                                           std::span<const BatchGlyph> glyphs) const {
+    CTFontRef font_ref;
+    {
+        std::lock_guard lock{font_mutex};
+        font_ref = font_id_to_native[font_id].font.get();
+    }
 
-    // If the font is a color font and the glyph doesn't have an outline, it is a color glyph.
-    // https://github.com/sublimehq/sublime_text/issues/3747#issuecomment-726837744
-    bool colored_font = CTFontGetSymbolicTraits(font_ref) & kCTFontTraitColorGlyphs;
-    bool has_outline = CTFontCreatePathForGlyph(font_ref, glyph_index, nullptr);
-    bool colored = colored_font && !has_outline;
+    GlyphBatch batch;
+    for (const auto& [glyph_id, x_phase] : glyphs) {
+        auto rglyph = MeasureGlyph(font_ref, glyph_id, scale, x_phase);
+        batch.glyphs.push_back({glyph_id, x_phase, std::move(rglyph), 0, 0});
+    }
+    pack_batch(batch);
+    if (batch.width <= 0 || batch.height <= 0) return batch;
 
-    return {
-        .left = left,
-        .top = top,
-        .width = static_cast<int32_t>(width),
-        .height = static_cast<int32_t>(height),
-        .buffer = std::move(bitmap_data),
-        .colored = colored,
-    };
+    // All glyphs are drawn by one bitmap context over the batch's image.
+    DrawGlyphs(batch.buffer, batch.width, batch.height, font_ref, scale, batch.glyphs);
+    return batch;
 }
 
-// https://skia.googlesource.com/skia/+/0a7c7b0b96fc897040e71ea3304d9d6a042cda8b/modules/skshaper/src/SkShaper_coretext.cpp#195
-LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
+LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8, int scale) {
     assert(str8.find('\n') == std::string_view::npos);
 
+    scale = clamp_scale(scale);
+
     unicode::UTF16ToUTF8IndicesMap indices_map;
     if (!indices_map.set_utf8(str8.data(), str8.length())) {
         fmt::println("UTF16ToUTF8IndicesMap::setUTF8 error");
@@ -167,6 +174,9 @@ LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
     CTFontRef ct_font = font_id_to_native[font_id].font.get();
     auto ct_line = ScopedCFTypeRef<CTLineRef>(CreateCTLine(ct_font, font_id, str8));
 
+    // Glyphs are positioned from the unrounded pen position, so that rounding errors don't add up
+    // along the line. Advances are the differences between the rounded pen positions.
+    double pen = 0;
     int total_advance = 0;
     std::vector<ShapedGlyph> glyphs;
     CFArrayRef run_array = CTLineGetGlyphRuns(ct_line.get());
@@ -193,19 +203,20 @@ LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
         CTRunGetPositions(ct_run, {0, glyph_count}, positions.data());
         CTRunGetAdvances(ct_run, {0, glyph_count}, advances.data());
 
-        // TODO: Don't hard-code scale factor.
-        int scale_factor = 2;
-
         for (CFIndex i = 0; i < glyph_count; ++i) {
-            // TODO: Use subpixel variants instead of rounding.
+            auto [x, x_phase] = SplitSubpixel(pen);
+            double x_advance = advances[i].width * scale;
+            pen += x_advance;
+            int next_advance = std::lround(pen);
+
             Point position = {
-                .x = total_advance,
+                .x = x,
                 // TODO: Do we scale y here?
                 .y = static_cast<int>(std::ceil(positions[i].y)),
             };
             Point advance = {
-                .x = static_cast<int>(std::ceil(advances[i].width * scale_factor)),
-                .y = static_cast<int>(std::ceil(advances[i].height * scale_factor)),
+                .x = next_advance - total_advance,
+                .y = static_cast<int>(std::ceil(advances[i].height * scale)),
             };
 
             size_t utf8_index = indices_map.map_index(indices[i]);
@@ -213,17 +224,21 @@ LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
                 .font_id = run_font_id,
                 .glyph_id = glyph_ids[i],
                 .position = std::move(position),
+                .x_phase = x_phase,
                 .advance = std::move(advance),
                 .index = utf8_index,
+                .x_offset = 0,
+                .x_advance = x_advance,
             };
             glyphs.emplace_back(std::move(glyph));
 
-            total_advance += advance.x;
+            total_advance = next_advance;
         }
     }
 
     return {
         .layout_font_id = font_id,
+        .scale = scale,
         .width = total_advance,
         .length = str8.length(),
         .glyphs = std::move(glyphs),
@@ -246,31 +261,37 @@ FontId FontRasterizer::cache_font(NativeFontType native_font, int font_size) {
         return it->second;
     }
 
-    // TODO: Don't hard-code scale factor.
-    int scale_factor = 2;
-
     // TODO: Do we multiply before std::ceil()? That is correct for DirectWrite.
     int ascent = std::ceil(CTFontGetAscent(ct_font));
     int descent = std::ceil(CTFontGetDescent(ct_font));
     int leading = std::ceil(CTFontGetLeading(ct_font));
-    ascent *= scale_factor;
-    descent *= scale_factor;
-    leading *= scale_factor;
 
-    int line_height = ascent + descent + leading;
+    std::array<Metrics, kMaxScale> metrics;
+    for (int scale = 1; scale <= kMaxScale; ++scale) {
+        metrics[scale - 1] = {
+            .line_height = (ascent + descent + leading) * scale,
+            .ascent = ascent * scale,
+            .descent = descent * scale,
+            .font_size = font_size,
+        };
+    }
 
-    Metrics metrics = {
-        .line_height = line_height,
-        .ascent = ascent,
-        .descent = descent,
-        .font_size = font_size,
-    };
+    std::string file_key;
+    auto url = ScopedCFTypeRef<CFURLRef>(
+        static_cast<CFURLRef>(CTFontCopyAttribute(ct_font, kCTFontURLAttribute)));
+    char path[PATH_MAX];
+    if (url && CFURLGetFileSystemRepresentation(url.get(), true,
+                                                reinterpret_cast<UInt8*>(path), sizeof(path))) {
+        file_key = file_key_from_path(path);
+    }
 
+    std::lock_guard lock{font_mutex};
     FontId font_id = font_hash_to_id.size();
     font_hash_to_id.emplace(hash, font_id);
     font_id_to_native.emplace_back(std::move(native_font));
     font_id_to_metrics.emplace_back(std::move(metrics));
     font_id_to_postscript_name.emplace_back(std::move(font_name));
+    font_id_to_file_key.emplace_back(std::move(file_key));
     return font_id;
 }
 
@@ -289,6 +310,97 @@ ScopedCFTypeRef<CTLineRef> CreateCTLine(CTFontRef ct_font, FontId font_id, std::
     return CTLineCreateWithAttributedString(attr_string.get());
 }
 
+// Returns the bounds of the glyph's bitmap, and whether it is colored.
+RasterizedGlyph MeasureGlyph(CTFontRef font_ref, CGGlyph glyph_index, int scale, int x_phase) {
+    CGRect bounds = CTFontGetBoundingRectsForGlyphs(font_ref, kCTFontOrientationDefault,
+                                                    &glyph_index, nullptr, 1);
+
+    int left = std::floor(bounds.origin.x);
+    int descent = std::ceil(-bounds.origin.y);
+    int ascent = std::ceil(bounds.origin.y + bounds.size.height);
+    int width = std::ceil(bounds.origin.x + bounds.size.width);
+    int height = ascent + descent;
+    int top = ascent;
+
+    width *= scale;
+    height *= scale;
+    top *= scale;
+    // TODO: Why do we not scale `top` and `left` here?
+    // left *= scale;
+    // descent *= scale;
+
+    // Make room for the glyph to be shifted right by the subpixel phase.
+    if (x_phase > 0) {
+        width += 1;
+    }
+    if (width < 0 || height < 0) return {};
+
+    // If the font is a color font and the glyph doesn't have an outline, it is a color glyph.
+    // https://github.com/sublimehq/sublime_text/issues/3747#issuecomment-726837744
+    bool colored_font = CTFontGetSymbolicTraits(font_ref) & kCTFontTraitColorGlyphs;
+    auto path =
+        ScopedCFTypeRef<CGPathRef>(CTFontCreatePathForGlyph(font_ref, glyph_index, nullptr));
+    bool colored = colored_font && !path.get();
+
+    return {
+        .left = left,
+        .top = top,
+        .width = width,
+        .height = height,
+        .colored = colored,
+    };
+}
+
+// Draws the measured `glyphs` into `image`, a BGRA bitmap of `width` by `height` pixels with rows
+// of `width * 4` bytes, each with its bitmap's top left corner at its `x` and `y`.
+void DrawGlyphs(std::span<uint8_t> image,
+                int width,
+                int height,
+                CTFontRef font_ref,
+                int scale,
+                std::span<const GlyphBatch::Glyph> glyphs) {
+    size_t stride = static_cast<size_t>(width) * 4;
+    std::fill_n(image.begin(), stride * height, 0);
+
+    auto color_space_ref = ScopedTypeRef<CGColorSpaceRef>(CGColorSpaceCreateDeviceRGB());
+    auto context = ScopedTypeRef<CGContextRef>(CGBitmapContextCreate(
+        image.data(), width, height, 8, stride, color_space_ref.get(),
+        kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Host));
+
+    CGContextSetAllowsFontSmoothing(context.get(), true);
+    CGContextSetShouldSmoothFonts(context.get(), FontSmoothingEnabled());
+    CGContextSetAllowsFontSubpixelQuantization(context.get(), true);
+    CGContextSetShouldSubpixelQuantizeFonts(context.get(), true);
+    CGContextSetAllowsFontSubpixelPositioning(context.get(), true);
+    CGContextSetShouldSubpixelPositionFonts(context.get(), true);
+    CGContextSetAllowsAntialiasing(context.get(), true);
+    CGContextSetShouldAntialias(context.get(), true);
+
+    CGContextSetRGBFillColor(context.get(), 1.0, 1.0, 1.0, 1.0);
+
+    for (const auto& glyph : glyphs) {
+        const auto& rglyph = glyph.rglyph;
+        if (rglyph.width <= 0 || rglyph.height <= 0) continue;
+
+        // Core Graphics has a bottom left origin.
+        CGFloat x = glyph.x;
+        CGFloat y = height - glyph.y - rglyph.height;
+        CGContextSaveGState(context.get());
+        CGContextClipToRect(context.get(), CGRectMake(x, y, rglyph.width, rglyph.height));
+        CGContextTranslateCTM(context.get(), x, y);
+        CGContextScaleCTM(context.get(), scale, scale);
+
+        // TODO: Why do we not offset by `-left` here?
+        // The context is scaled, so the subpixel shift and the descent are in points.
+        CGFloat x_shift = static_cast<CGFloat>(glyph.x_phase) / kSubpixelPhases / scale;
+        CGFloat descent = static_cast<CGFloat>(rglyph.height - rglyph.top) / scale;
+        CGPoint rasterization_origin = CGPointMake(x_shift, descent);
+        CGGlyph glyph_index = glyph.glyph_id;
+        CTFontDrawGlyphs(font_ref, &glyph_index, &rasterization_origin, 1, context.get());
+        CGContextRestoreGState(context.get());
+    }
+}
+
 // https://github.com/alacritty/crossfont/blob/9cd8ed05c9cc7ec17fe69183912560f97c050a1a/src/darwin/mod.rs#L275
 bool FontSmoothingEnabled() {
     auto pref = ScopedCFTypeRef<CFPropertyListRef>(
@@ -1,5 +1,6 @@
 #include "font/font_rasterizer.h"
 
+#include <algorithm>
 #include <cwchar>
 #include <limits>
 #include <vector>
@@ -32,6 +33,7 @@ namespace {
 inline std::wstring GetPostscriptName(IDWriteFont* font, std::wstring_view locale);
 inline std::wstring GetFontFamilyName(IDWriteFont* font, std::wstring_view locale);
 inline std::wstring GetLocaleName(IDWriteLocalizedStrings* strings, std::wstring_view locale);
+inline std::string GetFileKey(IDWriteFontFace* font_face);
 
 }  // namespace
 
@@ -53,6 +55,27 @@ public:
     };
     std::vector<DWriteInfo> font_id_to_dwrite_info;
     std::wstring locale;
+
+    // The Direct2D factory is single-threaded, and the DC render target is shared.
+    std::mutex render_mutex;
+
+    // Returns the bounds of the glyph's bitmap at `scale`, and whether it is colored.
+    // `render_mutex` must be held.
+    RasterizedGlyph measure_glyph(IDWriteFontFace* font_face,
+                                  float em_size,
+                                  uint32_t glyph_id,
+                                  int scale,
+                                  int x_phase);
+    // Draws the measured `glyphs` into `image`, a BGRA bitmap of `width` by `height` pixels with
+    // rows of `width * 4` bytes, each with its bitmap's top left corner at its `x` and `y`.
+    // `render_mutex` must be held.
+    void draw_glyphs(std::span<uint8_t> image,
+                     int width,
+                     int height,
+                     IDWriteFontFace* font_face,
+                     float em_size,
+                     int scale,
+                     std::span<GlyphBatch::Glyph> glyphs);
 };
 
 FontRasterizer::FontRasterizer() : pimpl(new impl()) {
@@ -192,42 +215,52 @@ FontId FontRasterizer::resize_font(FontId font_id, int font_size) {
     return add_font(font_name8, font_size);
 }
 
-RasterizedGlyph FontRasterizer::rasterize(FontId font_id, uint32_t glyph_id) const {
-    HRESULT hr;
-
-    int scale_factor = 2;
-
-    ComPtr<IDWriteFont> font = font_id_to_native[font_id].font;
-    const auto& dwrite_info = pimpl->font_id_to_dwrite_info[font_id];
-
-    ComPtr<IDWriteFontFace> font_face;
-    font->CreateFontFace(&font_face);
+namespace {
 
-    UINT16 glyph_index = glyph_id;
+// A run of a single glyph, which is drawn at the run's origin.
+struct SingleGlyphRun {
+    UINT16 glyph_index;
     FLOAT advance = 0.0;
     DWRITE_GLYPH_OFFSET offset{};
-    DWRITE_GLYPH_RUN glyph_run = {
-        .fontFace = font_face.Get(),
-        .fontEmSize = dwrite_info.em_size,
-        .glyphCount = 1,
-        .glyphIndices = &glyph_index,
-        .glyphAdvances = &advance,
-        .glyphOffsets = &offset,
-        .isSideways = 0,
-        .bidiLevel = 0,
-    };
+    DWRITE_GLYPH_RUN run;
+
+    SingleGlyphRun(IDWriteFontFace* font_face, float em_size, uint32_t glyph_id)
+        : glyph_index{static_cast<UINT16>(glyph_id)},
+          run{
+              .fontFace = font_face,
+              .fontEmSize = em_size,
+              .glyphCount = 1,
+              .glyphIndices = &glyph_index,
+              .glyphAdvances = &advance,
+              .glyphOffsets = &offset,
+              .isSideways = 0,
+              .bidiLevel = 0,
+          } {}
+    SingleGlyphRun(const SingleGlyphRun&) = delete;
+    SingleGlyphRun& operator=(const SingleGlyphRun&) = delete;
+};
+
+}  // namespace
+
+RasterizedGlyph FontRasterizer::impl::measure_glyph(IDWriteFontFace* font_face,
+                                                    float em_size,
+                                                    uint32_t glyph_id,
+                                                    int scale,
+                                                    int x_phase) {
+    SingleGlyphRun glyph_run{font_face, em_size, glyph_id};
 
     ComPtr<ID2D1DeviceContext4> dc_target4;
-    hr = pimpl->dc_target.As(&dc_target4);
+    HRESULT hr = dc_target.As(&dc_target4);
     if (FAILED(hr)) {
         fmt::println("ID2D1DeviceContext4 error: Windows 10 is the oldest supported version");
         std::abort();
     }
     dc_target4->SetUnitMode(D2D1_UNIT_MODE_DIPS);
-    dc_target4->SetDpi(96.0 * scale_factor, 96.0 * scale_factor);
+    dc_target4->SetDpi(96.0 * scale, 96.0 * scale);
 
     D2D1_RECT_F bounds;
-    dc_target4->GetGlyphRunWorldBounds({}, &glyph_run, DWRITE_MEASURING_MODE_NATURAL, &bounds);
+    dc_target4->GetGlyphRunWorldBounds({}, &glyph_run.run, DWRITE_MEASURING_MODE_NATURAL,
+                                       &bounds);
     // TODO: Clean this up.
     if (bounds.right < bounds.left) {
         return {};
@@ -243,19 +276,44 @@ RasterizedGlyph FontRasterizer::rasterize(FontId font_id, uint32_t glyph_id) con
     // TODO: Is this ascent or descent?
     int descent = -top;
 
-    D2D1_POINT_2F baseline_origin = {
-        .x = static_cast<FLOAT>(-left),
-        .y = static_cast<FLOAT>(-top),
+    width *= scale;
+    height *= scale;
+    left *= scale;
+    descent *= scale;
+
+    // Make room for the glyph to be shifted right by the subpixel phase.
+    if (x_phase > 0) {
+        width += 1;
+    }
+
+    // Glyphs with color layers, e.g., emoji, are colored. This is known without drawing them.
+    ComPtr<IDWriteColorGlyphRunEnumerator1> color_run_enumerator;
+    hr = dwrite_factory->TranslateColorGlyphRun({}, &glyph_run.run, nullptr,
+                                                DWRITE_GLYPH_IMAGE_FORMATS_COLR,
+                                                DWRITE_MEASURING_MODE_NATURAL, nullptr, 0,
+                                                &color_run_enumerator);
+
+    return {
+        .left = left,
+        .top = descent,
+        .width = static_cast<int32_t>(width),
+        .height = static_cast<int32_t>(height),
+        .colored = hr != DWRITE_E_NOCOLOR,
     };
+}
 
-    width *= scale_factor;
-    height *= scale_factor;
-    left *= scale_factor;
-    descent *= scale_factor;
+void FontRasterizer::impl::draw_glyphs(std::span<uint8_t> image,
+                                       int width,
+                                       int height,
+                                       IDWriteFontFace* font_face,
+                                       float em_size,
+                                       int scale,
+                                       std::span<GlyphBatch::Glyph> glyphs) {
+    HRESULT hr;
 
     ComPtr<IWICBitmap> wic_bitmap;
-    pimpl->wic_factory->CreateBitmap(width, height, GUID_WICPixelFormat32bppPBGRA,
-                                     WICBitmapCacheOnDemand, &wic_bitmap);
+    wic_factory->CreateBitmap(width, height, GUID_WICPixelFormat32bppPBGRA,
+                              WICBitmapCacheOnDemand, &wic_bitmap);
 
     // TODO: Consider making a helper function for this. Also see if the below method works.
     // D2D1_RENDER_TARGET_PROPERTIES render_target_properties = D2D1::RenderTargetProperties();
@@ -273,8 +331,8 @@ RasterizedGlyph FontRasterizer::rasterize(FontId font_id, uint32_t glyph_id) con
     };
 
     ComPtr<ID2D1RenderTarget> render_target;
-    pimpl->d2d1_factory->CreateWicBitmapRenderTarget(wic_bitmap.Get(), render_target_properties,
-                                                     &render_target);
+    d2d1_factory->CreateWicBitmapRenderTarget(wic_bitmap.Get(), render_target_properties,
+                                              &render_target);
     ComPtr<ID2D1DeviceContext4> render_target4;
     hr = render_target.As(&render_target4);
     if (FAILED(hr)) {
@@ -282,61 +340,105 @@ RasterizedGlyph FontRasterizer::rasterize(FontId font_id, uint32_t glyph_id) con
         std::abort();
     }
     render_target4->SetUnitMode(D2D1_UNIT_MODE_DIPS);
-    render_target4->SetDpi(96.0 * scale_factor, 96.0 * scale_factor);
-    render_target4->SetTextRenderingParams(pimpl->text_rendering_params.Get());
-
-    ComPtr<IDWriteColorGlyphRunEnumerator1> color_run_enumerator;
-    DWRITE_GLYPH_IMAGE_FORMATS image_formats = DWRITE_GLYPH_IMAGE_FORMATS_COLR;
-    hr = pimpl->dwrite_factory->TranslateColorGlyphRun({}, &glyph_run, nullptr, image_formats,
-                                                       DWRITE_MEASURING_MODE_NATURAL, nullptr, 0,
-                                                       &color_run_enumerator);
+    render_target4->SetDpi(96.0 * scale, 96.0 * scale);
+    render_target4->SetTextRenderingParams(text_rendering_params.Get());
 
     ComPtr<ID2D1SolidColorBrush> brush;
     render_target4->CreateSolidColorBrush({1.0f, 1.0f, 1.0f, 1.0f}, &brush);
 
     render_target4->BeginDraw();
-
-    bool colored = hr != DWRITE_E_NOCOLOR;
-    if (colored) {
-        while (true) {
-            BOOL has_run;
-            const DWRITE_COLOR_GLYPH_RUN1* color_run;
-            if (FAILED(color_run_enumerator->MoveNext(&has_run)) || !has_run) {
-                break;
-            }
-            if (FAILED(color_run_enumerator->GetCurrentRun(&color_run))) {
-                break;
-            }
-
-            switch (color_run->glyphImageFormat) {
-            case DWRITE_GLYPH_IMAGE_FORMATS_COLR:
-                brush->SetColor(color_run->runColor);
-                render_target4->DrawGlyphRun(baseline_origin, &color_run->glyphRun, brush.Get(),
-                                             color_run->measuringMode);
-                break;
-            default:
-                fmt::println("Error: DirectWrite glyph image format unimplemented");
-                std::abort();
+    render_target4->Clear({0.0f, 0.0f, 0.0f, 0.0f});
+    for (auto& glyph : glyphs) {
+        RasterizedGlyph& rglyph = glyph.rglyph;
+        if (rglyph.width <= 0 || rglyph.height <= 0) continue;
+
+        SingleGlyphRun glyph_run{font_face, em_size, glyph.glyph_id};
+
+        // Units are DIPs, so pixels and the subpixel shift are divided by the scale.
+        FLOAT dips_per_pixel = 1.0f / scale;
+        FLOAT x_shift = static_cast<FLOAT>(glyph.x_phase) / kSubpixelPhases * dips_per_pixel;
+        D2D1_POINT_2F baseline_origin = {
+            .x = (glyph.x - rglyph.left) * dips_per_pixel + x_shift,
+            .y = (glyph.y + rglyph.top) * dips_per_pixel,
+        };
+        D2D1_RECT_F clip = {
+            .left = glyph.x * dips_per_pixel,
+            .top = glyph.y * dips_per_pixel,
+            .right = (glyph.x + rglyph.width) * dips_per_pixel,
+            .bottom = (glyph.y + rglyph.height) * dips_per_pixel,
+        };
+        render_target4->PushAxisAlignedClip(clip, D2D1_ANTIALIAS_MODE_ALIASED);
+
+        // `measure_glyph()` found whether the glyph is colored.
+        ComPtr<IDWriteColorGlyphRunEnumerator1> color_run_enumerator;
+        if (rglyph.colored) {
+            DWRITE_GLYPH_IMAGE_FORMATS image_formats = DWRITE_GLYPH_IMAGE_FORMATS_COLR;
+            dwrite_factory->TranslateColorGlyphRun({}, &glyph_run.run, nullptr, image_formats,
+                                                   DWRITE_MEASURING_MODE_NATURAL, nullptr, 0,
+                                                   &color_run_enumerator);
+        }
+        if (rglyph.colored && color_run_enumerator) {
+            while (true) {
+                BOOL has_run;
+                const DWRITE_COLOR_GLYPH_RUN1* color_run;
+                if (FAILED(color_run_enumerator->MoveNext(&has_run)) || !has_run) {
+                    break;
+                }
+                if (FAILED(color_run_enumerator->GetCurrentRun(&color_run))) {
+                    break;
+                }
+
+                switch (color_run->glyphImageFormat) {
+                case DWRITE_GLYPH_IMAGE_FORMATS_COLR:
+                    brush->SetColor(color_run->runColor);
+                    render_target4->DrawGlyphRun(baseline_origin, &color_run->glyphRun,
+                                                 brush.Get(), color_run->measuringMode);
+                    break;
+                default:
+                    fmt::println("Error: DirectWrite glyph image format unimplemented");
+                    std::abort();
+                }
             }
+            brush->SetColor({1.0f, 1.0f, 1.0f, 1.0f});
+        } else {
+            render_target4->DrawGlyphRun(baseline_origin, &glyph_run.run, brush.Get(),
+                                         DWRITE_MEASURING_MODE_NATURAL);
         }
-    } else {
-        render_target4->DrawGlyphRun(baseline_origin, &glyph_run, brush.Get(),
-                                     DWRITE_MEASURING_MODE_NATURAL);
+        render_target4->PopAxisAlignedClip();
     }
     render_target4->EndDraw();
 
     UINT stride = width * 4;
-    std::vector<uint8_t> bitmap_data(stride * height);
-    wic_bitmap->CopyPixels(nullptr, stride, bitmap_data.size(), bitmap_data.data());
+    wic_bitmap->CopyPixels(nullptr, stride, stride * height, image.data());
+}
 
-    return {
-        .left = left,
-        .top = descent,
-        .width = static_cast<int32_t>(width),
-        .height = static_cast<int32_t>(height),
-        .buffer = std::move(bitmap_data),
-        .colored = colored,
-    };
+RasterizedGlyph FontRasterizer::rasterize(FontId font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase) const {
+    ComPtr<IDWriteFont> font;
+    impl::DWriteInfo dwrite_info;
+    {
+        std::lock_guard lock{font_mutex};
+        font = font_id_to_native[font_id].font;
+        dwrite_info = pimpl->font_id_to_dwrite_info[font_id];
+    }
+    std::lock_guard render_lock{pimpl->render_mutex};
+
+    ComPtr<IDWriteFontFace> font_face;
+    font->CreateFontFace(&font_face);
+
+    float em_size = dwrite_info.em_size;
+    auto rglyph = pimpl->measure_glyph(font_face.Get(), em_size, glyph_id, scale, x_phase);
+    GlyphBatch::Glyph glyph = {glyph_id, x_phase, std::move(rglyph), 0, 0};
+    int width = glyph.rglyph.width;
+    int height = glyph.rglyph.height;
+    if (width <= 0 || height <= 0) return std::move(glyph.rglyph);
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(width) * height * 4);
+    pimpl->draw_glyphs(buffer, width, height, font_face.Get(), em_size, scale, {&glyph, 1});
+    glyph.rglyph.buffer = std::move(buffer);
+    return std::move(glyph.rglyph);
 }
 
 namespace {
@@ -361,8 +463,10 @@ std::vector<size_t> get_inverted_cluster_map(
 
 class FontFallbackRenderer : public IDWriteTextRenderer {
 public:
-    FontFallbackRenderer(ComPtr<IDWriteFontCollection> font_collection, std::string_view str8)
-        : ref_count(1), font_collection(font_collection) {
+    FontFallbackRenderer(ComPtr<IDWriteFontCollection> font_collection,
+                         std::string_view str8,
+                         int scale)
+        : ref_count(1), font_collection(font_collection), scale(scale) {
 
         if (!indices_map.set_utf8(str8.data(), str8.length())) {
             fmt::println("UTF16ToUTF8IndicesMap::setUTF8 error");
@@ -403,8 +507,6 @@ public:
                                 DWRITE_GLYPH_RUN_DESCRIPTION const* glyph_run_description,
                                 IUnknown* client_drawing_effect) override {
 
-        int scale_factor = 2;
-
         if (!glyph_run->fontFace) {
             fmt::println("Glyph run without font face.");
             std::abort();
@@ -426,21 +528,26 @@ public:
 
         for (size_t i = 0; i < glyph_count; ++i) {
             uint32_t glyph_id = glyph_run->glyphIndices[i];
-            // TODO: Verify that rounding up is correct.
-            int advance = std::ceil(glyph_run->glyphAdvances[i] * scale_factor);
+            auto [x, x_phase] = SplitSubpixel(pen);
+            double x_advance = glyph_run->glyphAdvances[i] * scale;
+            pen += x_advance;
+            int next_advance = std::lround(pen);
 
             size_t utf8_index = indices_map.map_index(text_position + inverted_cluster_map[i]);
             ShapedGlyph glyph = {
                 .font_id = run_font_id,
                 .glyph_id = glyph_id,
                 // TODO: Do we need the y values?
-                .position = {.x = total_advance},
-                .advance = {.x = advance},
+                .position = {.x = x},
+                .x_phase = x_phase,
+                .advance = {.x = next_advance - total_advance},
                 .index = utf8_index,
+                .x_offset = 0,
+                .x_advance = x_advance,
             };
             glyphs.emplace_back(std::move(glyph));
 
-            total_advance += advance;
+            total_advance = next_advance;
         }
 
         return S_OK;
@@ -497,6 +604,10 @@ private:
     ULONG ref_count;
     ComPtr<IDWriteFontCollection> font_collection;
     unicode::UTF16ToUTF8IndicesMap indices_map;
+    int scale;
+    // Glyphs are positioned from the unrounded pen position, so that rounding errors don't add up
+    // along the line. Advances are the differences between the rounded pen positions.
+    double pen = 0;
 
     // Outputs for FontRasterizer.
     friend class ::font::FontRasterizer;
@@ -506,9 +617,72 @@ private:
 
 }  // namespace
 
-LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
+RasterizedGlyph FontRasterizer::rasterize(FontId font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase,
+                                          std::span<uint8_t> buffer) const {
+    ComPtr<IDWriteFont> font;
+    impl::DWriteInfo dwrite_info;
+    {
+        std::lock_guard lock{font_mutex};
+        font = font_id_to_native[font_id].font;
+        dwrite_info = pimpl->font_id_to_dwrite_info[font_id];
+    }
+    std::lock_guard render_lock{pimpl->render_mutex};
+
+    ComPtr<IDWriteFontFace> font_face;
+    font->CreateFontFace(&font_face);
+
+    float em_size = dwrite_info.em_size;
+    auto rglyph = pimpl->measure_glyph(font_face.Get(), em_size, glyph_id, scale, x_phase);
+    GlyphBatch::Glyph glyph = {glyph_id, x_phase, std::move(rglyph), 0, 0};
+    int width = glyph.rglyph.width;
+    int height = glyph.rglyph.height;
+    if (width <= 0 || height <= 0 || buffer.size() < static_cast<size_t>(width) * height * 4) {
+        return std::move(glyph.rglyph);
+    }
+
+    // The bitmap is copied out once, straight into `buffer`.
+    pimpl->draw_glyphs(buffer, width, height, font_face.Get(), em_size, scale, {&glyph, 1});
+    return std::move(glyph.rglyph);
+}
+
+GlyphBatch FontRasterizer::rasterize_batch(FontId font_id,
+                                           int scale,
+                                           std::span<const BatchGlyph> glyphs) const {
+    ComPtr<IDWriteFont> font;
+    impl::DWriteInfo dwrite_info;
+    {
+        std::lock_guard lock{font_mutex};
+        font = font_id_to_native[font_id].font;
+        dwrite_info = pimpl->font_id_to_dwrite_info[font_id];
+    }
+    std::lock_guard render_lock{pimpl->render_mutex};
+
+    ComPtr<IDWriteFontFace> font_face;
+    font->CreateFontFace(&font_face);
+
+    float em_size = dwrite_info.em_size;
+    GlyphBatch batch;
+    for (const auto& [glyph_id, x_phase] : glyphs) {
+        auto rglyph = pimpl->measure_glyph(font_face.Get(), em_size, glyph_id, scale, x_phase);
+        batch.glyphs.push_back({glyph_id, x_phase, std::move(rglyph), 0, 0});
+    }
+    pack_batch(batch);
+    if (batch.width <= 0 || batch.height <= 0) return batch;
+
+    // All glyphs are drawn into one render target, which is cleared and copied out once.
+    pimpl->draw_glyphs(batch.buffer, batch.width, batch.height, font_face.Get(), em_size, scale,
+                       batch.glyphs);
+    return batch;
+}
+
+LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8, int scale) {
     assert(str8.find('\n') == std::string_view::npos);
 
+    scale = clamp_scale(scale);
+
     std::wstring str16 = base::windows::ConvertToUTF16(str8);
 
     auto& native_font = font_id_to_native[font_id];
@@ -557,11 +731,12 @@ LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
     text_layout->SetFontCollection(font_collection.Get(), {0, len});
 
     ComPtr<FontFallbackRenderer> font_fallback_renderer =
-        new FontFallbackRenderer(font_collection, str8);
+        new FontFallbackRenderer(font_collection, str8, scale);
     text_layout->Draw(this, font_fallback_renderer.Get(), 0.0f, 0.0f);
 
     return {
         .layout_font_id = font_id,
+        .scale = scale,
         .width = font_fallback_renderer->total_advance,
         .length = str8.length(),
         .glyphs = font_fallback_renderer->glyphs,
@@ -569,8 +744,6 @@ LineLayout FontRasterizer::layout_line(FontId font_id, std::string_view str8) {
 }
 
 FontId FontRasterizer::cache_font(NativeFontType native_font, int font_size) {
-    int scale_factor = 2;
-
     ComPtr<IDWriteFont> dwrite_font = native_font.font;
     std::wstring font_name = GetPostscriptName(dwrite_font.Get(), pimpl->locale);
 
@@ -587,25 +760,28 @@ FontId FontRasterizer::cache_font(NativeFontType native_font, int font_size) {
     font_face->GetMetrics(&dwrite_metrics);
 
     float em_size = font_size * 96.f / 72;
-    float scale = em_size / dwrite_metrics.designUnitsPerEm;
-
-    int ascent = std::ceil(dwrite_metrics.ascent * scale * scale_factor);
-    int descent = std::ceil(dwrite_metrics.descent * scale * scale_factor);
-    int line_gap = std::ceil(dwrite_metrics.lineGap * scale * scale_factor);
-
-    int line_height = ascent + descent + line_gap;
-
-    Metrics metrics = {
-        .line_height = line_height,
-        .ascent = ascent,
-        .descent = descent,
-        .font_size = font_size,
-    };
+    float pixels_per_unit = em_size / dwrite_metrics.designUnitsPerEm;
+
+    std::array<Metrics, kMaxScale> metrics;
+    for (int scale = 1; scale <= kMaxScale; ++scale) {
+        int ascent = std::ceil(dwrite_metrics.ascent * pixels_per_unit * scale);
+        int descent = std::ceil(dwrite_metrics.descent * pixels_per_unit * scale);
+        int line_gap = std::ceil(dwrite_metrics.lineGap * pixels_per_unit * scale);
+
+        metrics[scale - 1] = {
+            .line_height = ascent + descent + line_gap,
+            .ascent = ascent,
+            .descent = descent,
+            .font_size = font_size,
+        };
+    }
     impl::DWriteInfo dwrite_info = {
         .font_name16 = GetFontFamilyName(dwrite_font.Get(), pimpl->locale),
         .em_size = em_size,
     };
+    std::string file_key = GetFileKey(font_face.Get());
 
+    std::lock_guard lock{font_mutex};
     FontId font_id = font_id_to_native.size();
     font_hash_to_id.emplace(hash, font_id);
     font_id_to_native.emplace_back(std::move(native_font));
@@ -613,6 +789,7 @@ FontId FontRasterizer::cache_font(NativeFontType native_font, int font_size) {
     // TODO: See if we can prevent this conversion.
     std::string font_name8 = base::windows::ConvertToUTF8(font_name);
     font_id_to_postscript_name.emplace_back(std::move(font_name8));
+    font_id_to_file_key.emplace_back(std::move(file_key));
     pimpl->font_id_to_dwrite_info.emplace_back(std::move(dwrite_info));
     return font_id;
 }
@@ -627,6 +804,29 @@ std::wstring GetPostscriptName(IDWriteFont* font, std::wstring_view locale) {
     return GetLocaleName(font_id_keyed_names.Get(), locale);
 }
 
+// The reference key identifies the font file to its loader. Fonts loaded from local files also
+// include the file's last write time, in case the key doesn't.
+std::string GetFileKey(IDWriteFontFace* font_face) {
+    UINT32 file_count = 1;
+    ComPtr<IDWriteFontFile> font_file;
+    if (FAILED(font_face->GetFiles(&file_count, &font_file)) || !font_file) return {};
+
+    const void* reference_key;
+    UINT32 key_size;
+    if (FAILED(font_file->GetReferenceKey(&reference_key, &key_size))) return {};
+    std::string file_key(static_cast<const char*>(reference_key), key_size);
+
+    ComPtr<IDWriteFontFileLoader> loader;
+    ComPtr<IDWriteLocalFontFileLoader> local_loader;
+    FILETIME last_write_time;
+    if (SUCCEEDED(font_file->GetLoader(&loader)) && SUCCEEDED(loader.As(&local_loader)) &&
+        SUCCEEDED(local_loader->GetLastWriteTimeFromKey(reference_key, key_size,
+                                                        &last_write_time))) {
+        file_key.append(reinterpret_cast<const char*>(&last_write_time), sizeof(FILETIME));
+    }
+    return file_key;
+}
+
 std::wstring GetFontFamilyName(IDWriteFont* font, std::wstring_view locale) {
     ComPtr<IDWriteFontFamily> font_family;
     font->GetFontFamily(&font_family);
@@ -1,9 +1,19 @@
 #include "font/font_rasterizer.h"
 
+#include "third_party/hash_maps/robin_hood.h"
+#include "unicode/unicode.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
 
 #include <pango/pangocairo.h>
+#include <pango/pangofc-font.h>
 
 // TODO: Debug use; remove this.
 #include <cassert>
@@ -29,6 +39,7 @@ using PangoFontMetricsPtr = UniquePtrDeleter<PangoFontMetrics, pango_font_metric
 using PangoGlyphStringPtr = UniquePtrDeleter<PangoGlyphString, pango_glyph_string_free>;
 using CairoSurfacePtr = UniquePtrDeleter<cairo_surface_t, cairo_surface_destroy>;
 using CairoContextPtr = UniquePtrDeleter<cairo_t, cairo_destroy>;
+using CairoScaledFontPtr = UniquePtrDeleter<cairo_scaled_font_t, cairo_scaled_font_destroy>;
 
 struct FontRasterizer::NativeFontType {
     GObjectPtr<PangoFont> font;
@@ -36,9 +47,178 @@ struct FontRasterizer::NativeFontType {
 
 class FontRasterizer::impl {
 public:
-    std::vector<std::unordered_map<PangoGlyph, PangoGlyphInfo>> glyph_info_cache;
+    // Written for every glyph of every shaped line, so this is a flat map to avoid a node
+    // allocation per new glyph and pointer chasing per lookup.
+    std::vector<robin_hood::unordered_flat_map<PangoGlyph, PangoGlyphInfo>> glyph_info_cache;
+
+    // Returns the glyph's info from shaping. Fonts that never shaped a line, e.g., fonts resized
+    // for distance fields, have no cached glyph info. Their glyphs are drawn without color
+    // attributes. `pango_mutex` must be locked.
+    PangoGlyphInfo glyph_info(size_t font_id, uint32_t glyph_id) const {
+        PangoGlyphInfo gi{.glyph = glyph_id};
+        if (font_id < glyph_info_cache.size()) {
+            const auto& glyph_infos = glyph_info_cache[font_id];
+            if (auto it = glyph_infos.find(glyph_id); it != glyph_infos.end()) {
+                gi = it->second;
+            }
+        }
+        return gi;
+    }
+
+    // Pango fonts cache glyph extents and create their Cairo fonts without locking, so every use
+    // of Pango is serialized with `rasterize()` on worker threads. Workers only hold this to look
+    // up a font's glyphs, since they measure and draw them with Cairo, which has its own locks.
+    // This must be locked before `font_mutex`.
+    std::mutex pango_mutex;
+
+    // What rasterizing glyphs of a font on a worker thread needs from Pango.
+    struct GlyphSource {
+        PangoFont* font;
+        // The font's Cairo font, which is safe to use from any thread.
+        CairoScaledFontPtr scaled_font;
+        std::vector<PangoGlyphInfo> glyph_infos;
+    };
+    // Locks `pango_mutex`.
+    GlyphSource glyph_source(const FontRasterizer& rasterizer,
+                             size_t font_id,
+                             std::span<const BatchGlyph> glyphs);
+
+    // The layout of every ASCII character on its own. Lines of printable ASCII text are laid out
+    // from this table instead of being shaped, if the font shapes them the same way.
+    struct AsciiTable {
+        bool usable = false;
+        std::array<ShapedGlyph, 128> glyphs;
+    };
+
+    // Returns the layout used to shape lines in `font`, which is created on first use. Laying out
+    // a line only replaces its text.
+    PangoLayout* layout_for(size_t font_id, PangoFont* font);
+    // Shapes `str8` with Pango at `scale`. `pango_mutex` must be held.
+    LineLayout shape_line(FontRasterizer& rasterizer,
+                          size_t font_id,
+                          std::string_view str8,
+                          int scale);
+    // Returns the ASCII table of `font_id` at `scale`, which is built on first use. `pango_mutex`
+    // must be held.
+    const AsciiTable& ascii_table(FontRasterizer& rasterizer, size_t font_id, int scale);
+    // Returns the ID of `run_font`, which shaped a run of a line in `font_id`. This is the font
+    // itself or a fallback font. `pango_mutex` must be held.
+    size_t run_font_id(FontRasterizer& rasterizer, size_t font_id, PangoFont* run_font);
+
+private:
+    std::vector<GObjectPtr<PangoLayout>> layouts;
+    // The fonts that shaped runs of each font, so that `cache_font()` only describes and hashes a
+    // font the first time that it's used for a run. Holding a reference keeps the pointer from
+    // being reused by another font.
+    struct RunFont {
+        GObjectPtr<PangoFont> font;
+        size_t font_id;
+    };
+    std::vector<robin_hood::unordered_flat_map<PangoFont*, RunFont>> run_fonts;
+    // Indexed by the font, then by the scale minus one.
+    std::vector<std::array<std::unique_ptr<AsciiTable>, kMaxScale>> ascii_tables;
 };
 
+namespace {
+
+constexpr char kFirstPrintable = ' ';
+constexpr char kLastPrintable = '~';
+
+// Text that triggers common programming ligatures and kerning pairs. A font that changes any of it
+// when shaped needs Pango.
+constexpr std::string_view kShapingProbe =
+    "-> => != !== == === <= >= <> :: ... /* */ // && || ++ www ffi fl AV Te To Wa";
+
+// Lays out `str8` from `table`, or returns nothing if it contains characters that are not
+// printable ASCII.
+std::optional<LineLayout> LayoutASCII(const FontRasterizer::impl::AsciiTable& table,
+                                      size_t font_id,
+                                      int scale,
+                                      std::string_view str8) {
+    // Glyphs are positioned from the unrounded pen position, like `shape_line()` does.
+    double pen = 0;
+    int total_advance = 0;
+    std::vector<ShapedGlyph> glyphs;
+    glyphs.reserve(str8.length());
+    for (size_t i = 0; i < str8.length(); ++i) {
+        char ch = str8[i];
+        if (ch < kFirstPrintable || ch > kLastPrintable) return std::nullopt;
+
+        ShapedGlyph glyph = table.glyphs[ch];
+        std::tie(glyph.position.x, glyph.x_phase) = SplitSubpixel(pen + glyph.x_offset);
+        pen += glyph.x_advance;
+        int next_advance = std::lround(pen);
+        glyph.advance.x = next_advance - total_advance;
+        glyph.index = i;
+        glyphs.emplace_back(std::move(glyph));
+        total_advance = next_advance;
+    }
+
+    return LineLayout{
+        .layout_font_id = font_id,
+        .scale = scale,
+        .width = total_advance,
+        .length = str8.length(),
+        .glyphs = std::move(glyphs),
+    };
+}
+
+bool SameLayout(const LineLayout& lhs, const LineLayout& rhs) {
+    auto same_glyph = [](const ShapedGlyph& a, const ShapedGlyph& b) {
+        return a.font_id == b.font_id && a.glyph_id == b.glyph_id &&
+               a.position.x == b.position.x && a.position.y == b.position.y &&
+               a.x_phase == b.x_phase &&
+               a.advance.x == b.advance.x && a.advance.y == b.advance.y && a.index == b.index;
+    };
+    return lhs.scale == rhs.scale && lhs.width == rhs.width && lhs.length == rhs.length &&
+           std::ranges::equal(lhs.glyphs, rhs.glyphs, same_glyph);
+}
+
+}  // namespace
+
+PangoLayout* FontRasterizer::impl::layout_for(size_t font_id, PangoFont* font) {
+    if (layouts.size() <= font_id) {
+        layouts.resize(font_id + 1);
+    }
+
+    GObjectPtr<PangoLayout>& layout = layouts[font_id];
+    if (!layout) {
+        // The layout copies the font options into its own context, so the Cairo context is only
+        // needed to create it.
+        CairoSurfacePtr temp_surface{cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 0, 0)};
+        CairoContextPtr layout_context{cairo_create(temp_surface.get())};
+
+        cairo_font_options_t* font_options = cairo_font_options_create();
+        cairo_font_options_set_antialias(font_options, CAIRO_ANTIALIAS_SUBPIXEL);
+        cairo_set_font_options(layout_context.get(), font_options);
+        cairo_font_options_destroy(font_options);
+
+        layout.reset(pango_cairo_create_layout(layout_context.get()));
+
+        PangoFontDescriptionPtr desc{pango_font_describe(font)};
+        pango_layout_set_font_description(layout.get(), desc.get());
+    }
+    return layout.get();
+}
+
+FontRasterizer::impl::GlyphSource FontRasterizer::impl::glyph_source(
+    const FontRasterizer& rasterizer, size_t font_id, std::span<const BatchGlyph> glyphs) {
+    std::lock_guard pango_lock{pango_mutex};
+    GlyphSource source;
+    {
+        std::lock_guard lock{rasterizer.font_mutex};
+        source.font = rasterizer.font_id_to_native[font_id].font.get();
+    }
+
+    cairo_scaled_font_t* scaled_font =
+        pango_cairo_font_get_scaled_font(PANGO_CAIRO_FONT(source.font));
+    source.scaled_font.reset(cairo_scaled_font_reference(scaled_font));
+    for (const auto& glyph : glyphs) {
+        source.glyph_infos.emplace_back(glyph_info(font_id, glyph.glyph_id));
+    }
+    return source;
+}
+
 FontRasterizer::FontRasterizer() : pimpl{new impl{}} {}
 
 FontRasterizer::~FontRasterizer() {}
@@ -46,6 +226,7 @@ FontRasterizer::~FontRasterizer() {}
 size_t FontRasterizer::add_font(std::string_view font_name_utf8,
                                 int font_size,
                                 FontStyle font_style) {
+    std::lock_guard pango_lock{pimpl->pango_mutex};
     PangoFontMap* font_map = pango_cairo_font_map_get_default();
     GObjectPtr<PangoContext> context{pango_font_map_create_context(font_map)};
 
@@ -74,6 +255,7 @@ size_t FontRasterizer::add_system_font(int font_size, FontStyle font_style) {
 }
 
 size_t FontRasterizer::resize_font(size_t font_id, int font_size) {
+    std::lock_guard pango_lock{pimpl->pango_mutex};
     PangoFont* font = font_id_to_native[font_id].font.get();
     PangoFontDescription* desc = pango_font_describe(font);
 
@@ -90,84 +272,333 @@ size_t FontRasterizer::resize_font(size_t font_id, int font_size) {
     return cache_font({std::move(pango_font)}, font_size);
 }
 
-RasterizedGlyph FontRasterizer::rasterize(size_t font_id, uint32_t glyph_id) const {
-    PangoFont* font = font_id_to_native[font_id].font.get();
+namespace {
+
+// Glyphs are drawn into a surface that is reused across glyphs, so that rasterizing doesn't
+// allocate. It grows to the largest glyph drawn so far.
+struct ScratchSurface {
+    CairoSurfacePtr surface;
+    CairoContextPtr context;
+    PangoGlyphStringPtr glyph_string{pango_glyph_string_new()};
+    int width = 0;
+    int height = 0;
+
+    ScratchSurface() {
+        pango_glyph_string_set_size(glyph_string.get(), 1);
+    }
+
+    void reserve(int min_width, int min_height) {
+        if (min_width <= width && min_height <= height) return;
+
+        width = std::max(min_width, width);
+        height = std::max(min_height, height);
+        surface.reset(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height));
+        context.reset(cairo_create(surface.get()));
+        cairo_set_source_rgba(context.get(), 1, 1, 1, 1);
+    }
+
+    // Clears the top left `clear_width` by `clear_height` pixels.
+    void clear(int clear_width, int clear_height) {
+        unsigned char* data = cairo_image_surface_get_data(surface.get());
+        int stride = cairo_image_surface_get_stride(surface.get());
+        cairo_surface_flush(surface.get());
+        for (int y = 0; y < clear_height; ++y) {
+            std::memset(data + y * stride, 0, clear_width * 4);
+        }
+        cairo_surface_mark_dirty(surface.get());
+    }
+
+    // Copies the `copy_width` by `copy_height` pixels at (x, y) to `buffer`, in rows of
+    // `row_size` bytes.
+    void copy_to(std::span<uint8_t> buffer,
+                 int x,
+                 int y,
+                 int copy_width,
+                 int copy_height,
+                 size_t row_size) {
+        const unsigned char* data = cairo_image_surface_get_data(surface.get());
+        int stride = cairo_image_surface_get_stride(surface.get());
+        cairo_surface_flush(surface.get());
+        for (int row = 0; row < copy_height; ++row) {
+            std::memcpy(buffer.data() + row * row_size, data + (y + row) * stride + x * 4,
+                        copy_width * 4);
+        }
+    }
+};
 
-    PangoRectangle ink_rect;
-    PangoRectangle logical_rect;
-    pango_font_get_glyph_extents(font, glyph_id, &ink_rect, &logical_rect);
-    int width = PANGO_PIXELS(logical_rect.width);
-    int height = PANGO_PIXELS(logical_rect.height);
-    int descent = PANGO_PIXELS(PANGO_DESCENT(logical_rect));
-    int ascent = PANGO_PIXELS(PANGO_ASCENT(logical_rect));
-    int top = ascent;
-    // TODO: Do we need these?
-    // int ink_width = PANGO_PIXELS(ink_rect.width);
-    // int ink_height = PANGO_PIXELS(ink_rect.height);
-    // int ink_top = PANGO_PIXELS(PANGO_ASCENT(ink_rect));
-    // int ink_left = PANGO_PIXELS(PANGO_LBEARING(ink_rect));
-    // int ink_descent = PANGO_PIXELS(PANGO_DESCENT(ink_rect));
-
-    // TODO: Don't hard-code this.
-    int scale_factor = 2;
-    width *= scale_factor;
-    height *= scale_factor;
-    descent *= scale_factor;
-    top *= scale_factor;
-
-    auto glyph_string = PangoGlyphStringPtr{pango_glyph_string_new()};
-    pango_glyph_string_set_size(glyph_string.get(), 1);
-
-    PangoGlyphInfo gi = pimpl->glyph_info_cache[font_id][glyph_id];
-    bool colored = gi.attr.is_color;
-    glyph_string->glyphs[0] = std::move(gi);
-
-    std::vector<uint8_t> bitmap_data(height * width * 4);
-    auto surface = CairoSurfacePtr{cairo_image_surface_create_for_data(
-        bitmap_data.data(), CAIRO_FORMAT_ARGB32, width, height, width * 4)};
-    auto context = CairoContextPtr{cairo_create(surface.get())};
-
-    cairo_translate(context.get(), 0, -descent);
-    cairo_scale(context.get(), scale_factor, scale_factor);
-
-    cairo_set_source_rgba(context.get(), 1, 1, 1, 1);
-    pango_cairo_show_glyph_string(context.get(), font, glyph_string.get());
+using GlyphSource = FontRasterizer::impl::GlyphSource;
+
+// Pango's own glyphs, such as the hex boxes of missing characters, aren't in the Cairo font and
+// are drawn by Pango.
+bool IsPangoGlyph(PangoGlyph glyph) {
+    return glyph >= PANGO_GLYPH_EMPTY;
+}
+
+// Returns the bounds of the glyph's bitmap, which only covers its ink, shifted by the subpixel
+// phase and rounded out to whole pixels. `left` and `top` are the offsets from the glyph origin on
+// the baseline to the bitmap's top left corner.
+RasterizedGlyph MeasureGlyph(const GlyphSource& source,
+                             const PangoGlyphInfo& gi,
+                             int scale,
+                             int x_phase,
+                             std::mutex& pango_mutex) {
+    // Pango measures the ink of its Cairo font's glyphs with Cairo as well.
+    cairo_text_extents_t extents;
+    if (IsPangoGlyph(gi.glyph)) {
+        PangoRectangle ink_rect;
+        {
+            std::lock_guard pango_lock{pango_mutex};
+            pango_font_get_glyph_extents(source.font, gi.glyph, &ink_rect, nullptr);
+        }
+        extents = {
+            .x_bearing = pango_units_to_double(ink_rect.x),
+            .y_bearing = pango_units_to_double(ink_rect.y),
+            .width = pango_units_to_double(ink_rect.width),
+            .height = pango_units_to_double(ink_rect.height),
+        };
+    } else {
+        cairo_glyph_t glyph = {.index = gi.glyph, .x = 0, .y = 0};
+        cairo_scaled_font_glyph_extents(source.scaled_font.get(), &glyph, 1, &extents);
+    }
+
+    double x_shift = static_cast<double>(x_phase) / kSubpixelPhases;
+    int ink_left = std::floor(extents.x_bearing * scale + x_shift);
+    int ink_top = std::floor(extents.y_bearing * scale);
+    int ink_right = std::ceil((extents.x_bearing + extents.width) * scale + x_shift);
+    int ink_bottom = std::ceil((extents.y_bearing + extents.height) * scale);
+
+    int width = 0;
+    int height = 0;
+    if (extents.width > 0 && extents.height > 0) {
+        // Pad each side by a pixel for antialiasing and hinting, which may reach past the ink.
+        ink_left -= 1;
+        ink_top -= 1;
+        width = ink_right - ink_left + 1;
+        height = ink_bottom - ink_top + 1;
+    }
 
     return {
-        .left = 0,
-        .top = top,
+        .left = ink_left,
+        .top = -ink_top,
         .width = width,
         .height = height,
-        .buffer = std::move(bitmap_data),
-        .colored = colored,
+        .colored = static_cast<bool>(gi.attr.is_color),
     };
 }
 
-LineLayout FontRasterizer::layout_line(size_t font_id, std::string_view str8) {
-    assert(str8.find('\n') == std::string_view::npos);
+// Draws the glyph measured as `rglyph` with its bitmap's top left corner at (x, y) of the
+// surface, clipped to the bitmap.
+void DrawGlyph(ScratchSurface& scratch,
+               const GlyphSource& source,
+               const PangoGlyphInfo& gi,
+               const RasterizedGlyph& rglyph,
+               int scale,
+               int x_phase,
+               int x,
+               int y,
+               std::mutex& pango_mutex) {
+    cairo_t* context = scratch.context.get();
+    double x_shift = static_cast<double>(x_phase) / kSubpixelPhases;
+    cairo_save(context);
+    cairo_rectangle(context, x, y, rglyph.width, rglyph.height);
+    cairo_clip(context);
+    cairo_translate(context, x + x_shift - rglyph.left, y + rglyph.top);
+    cairo_scale(context, scale, scale);
+
+    // The glyph is drawn at its origin, since its offsets within the line are applied when the
+    // line is rendered. This is what `pango_cairo_show_glyph_string()` does for the glyphs of the
+    // Cairo font, without touching the Pango font.
+    if (IsPangoGlyph(gi.glyph)) {
+        scratch.glyph_string->glyphs[0] = gi;
+        scratch.glyph_string->glyphs[0].geometry.x_offset = 0;
+        scratch.glyph_string->glyphs[0].geometry.y_offset = 0;
+        std::lock_guard pango_lock{pango_mutex};
+        pango_cairo_show_glyph_string(context, source.font, scratch.glyph_string.get());
+    } else {
+        cairo_glyph_t glyph = {.index = gi.glyph, .x = 0, .y = 0};
+        cairo_set_scaled_font(context, source.scaled_font.get());
+        cairo_show_glyphs(context, &glyph, 1);
+    }
+    cairo_restore(context);
+}
 
-    PangoFont* font = font_id_to_native[font_id].font.get();
+// Draws the glyph measured as `rglyph` into `buffer`, which holds its bitmap.
+void DrawGlyphInto(std::span<uint8_t> buffer,
+                   const GlyphSource& source,
+                   const PangoGlyphInfo& gi,
+                   const RasterizedGlyph& rglyph,
+                   int scale,
+                   int x_phase,
+                   std::mutex& pango_mutex) {
+    int width = rglyph.width;
+    int height = rglyph.height;
+    thread_local ScratchSurface scratch;
+    scratch.reserve(width, height);
+    scratch.clear(width, height);
+    DrawGlyph(scratch, source, gi, rglyph, scale, x_phase, 0, 0, pango_mutex);
+    scratch.copy_to(buffer, 0, 0, width, height, static_cast<size_t>(width) * 4);
+}
+
+}  // namespace
+
+RasterizedGlyph FontRasterizer::rasterize(size_t font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase) const {
+    BatchGlyph glyph = {glyph_id, x_phase};
+    GlyphSource source = pimpl->glyph_source(*this, font_id, {&glyph, 1});
+    const PangoGlyphInfo& gi = source.glyph_infos.front();
+    RasterizedGlyph rglyph = MeasureGlyph(source, gi, scale, x_phase, pimpl->pango_mutex);
+    if (rglyph.width <= 0 || rglyph.height <= 0) return rglyph;
+
+    std::vector<uint8_t> buffer(static_cast<size_t>(rglyph.width) * rglyph.height * 4);
+    DrawGlyphInto(buffer, source, gi, rglyph, scale, x_phase, pimpl->pango_mutex);
+    rglyph.buffer = std::move(buffer);
+    return rglyph;
+}
+
+RasterizedGlyph FontRasterizer::rasterize(size_t font_id,
+                                          uint32_t glyph_id,
+                                          int scale,
+                                          int x_phase,
+                                          std::span<uint8_t> buffer) const {
+    BatchGlyph glyph = {glyph_id, x_phase};
+    GlyphSource source = pimpl->glyph_source(*this, font_id, {&glyph, 1});
+    const PangoGlyphInfo& gi = source.glyph_infos.front();
+    RasterizedGlyph rglyph = MeasureGlyph(source, gi, scale, x_phase, pimpl->pango_mutex);
+    if (rglyph.width <= 0 || rglyph.height <= 0) return rglyph;
+    if (buffer.size() < static_cast<size_t>(rglyph.width) * rglyph.height * 4) return rglyph;
+
+    DrawGlyphInto(buffer, source, gi, rglyph, scale, x_phase, pimpl->pango_mutex);
+    return rglyph;
+}
+
+GlyphBatch FontRasterizer::rasterize_batch(size_t font_id,
+                                           int scale,
+                                           std::span<const BatchGlyph> glyphs) const {
+    GlyphSource source = pimpl->glyph_source(*this, font_id, glyphs);
+    std::mutex& pango_mutex = pimpl->pango_mutex;
+
+    GlyphBatch batch;
+    for (size_t i = 0; i < glyphs.size(); ++i) {
+        auto [glyph_id, x_phase] = glyphs[i];
+        auto rglyph = MeasureGlyph(source, source.glyph_infos[i], scale, x_phase, pango_mutex);
+        batch.glyphs.push_back({glyph_id, x_phase, std::move(rglyph), 0, 0});
+    }
+    pack_batch(batch);
+    if (batch.width <= 0 || batch.height <= 0) return batch;
+
+    // All glyphs are drawn into the surface, which is cleared and copied out once.
+    thread_local ScratchSurface scratch;
+    scratch.reserve(batch.width, batch.height);
+    scratch.clear(batch.width, batch.height);
+    for (size_t i = 0; i < batch.glyphs.size(); ++i) {
+        const auto& glyph = batch.glyphs[i];
+        if (glyph.rglyph.width <= 0 || glyph.rglyph.height <= 0) continue;
+        DrawGlyph(scratch, source, source.glyph_infos[i], glyph.rglyph, scale, glyph.x_phase,
+                  glyph.x, glyph.y, pango_mutex);
+    }
+    size_t row_size = static_cast<size_t>(batch.width) * 4;
+    scratch.copy_to(batch.buffer, 0, 0, batch.width, batch.height, row_size);
+    return batch;
+}
+
+size_t FontRasterizer::impl::run_font_id(FontRasterizer& rasterizer,
+                                         size_t font_id,
+                                         PangoFont* run_font) {
+    if (run_fonts.size() <= font_id) {
+        run_fonts.resize(font_id + 1);
+    }
+    auto& fonts = run_fonts[font_id];
+    if (auto it = fonts.find(run_font); it != fonts.end()) {
+        return it->second.font_id;
+    }
+
+    g_object_ref(run_font);
+    GObjectPtr<PangoFont> run_font_ptr{run_font};
+    g_object_ref(run_font);
+    GObjectPtr<PangoFont> cached_font_ptr{run_font};
+    int font_size = rasterizer.metrics(font_id, 1).font_size;
+    size_t id = rasterizer.cache_font({std::move(cached_font_ptr)}, font_size);
+    fonts.emplace(run_font, RunFont{std::move(run_font_ptr), id});
+    return id;
+}
+
+const FontRasterizer::impl::AsciiTable& FontRasterizer::impl::ascii_table(
+    FontRasterizer& rasterizer, size_t font_id, int scale) {
+    if (ascii_tables.size() <= font_id) {
+        ascii_tables.resize(font_id + 1);
+    }
+
+    std::unique_ptr<AsciiTable>& table = ascii_tables[font_id][scale - 1];
+    if (table) return *table;
+    table = std::make_unique<AsciiTable>();
+
+    std::string printable;
+    for (char ch = kFirstPrintable; ch <= kLastPrintable; ++ch) {
+        auto layout = shape_line(rasterizer, font_id, std::string_view{&ch, 1}, scale);
+        if (layout.glyphs.size() != 1) return *table;
+
+        table->glyphs[ch] = layout.glyphs[0];
+        printable += ch;
+    }
+
+    // Without shaping, every character has the same advance regardless of its neighbors, so the
+    // font must be monospace. This also rules out kerning.
+    double advance = table->glyphs[kFirstPrintable].x_advance;
+    for (char ch : printable) {
+        if (table->glyphs[ch].x_advance != advance) return *table;
+    }
+    for (std::string_view probe : {std::string_view{printable}, kShapingProbe}) {
+        auto expected = shape_line(rasterizer, font_id, probe, scale);
+        auto layout = LayoutASCII(*table, font_id, scale, probe);
+        if (!layout || !SameLayout(*layout, expected)) return *table;
+    }
+
+    table->usable = true;
+    return *table;
+}
+
+LineLayout FontRasterizer::layout_line(size_t font_id, std::string_view str8, int scale) {
+    assert(str8.find('\n') == std::string_view::npos);
 
-    CairoSurfacePtr temp_surface{cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 0, 0)};
-    CairoContextPtr layout_context{cairo_create(temp_surface.get())};
+    scale = clamp_scale(scale);
+    std::lock_guard pango_lock{pimpl->pango_mutex};
+    if (unicode::IsASCII(str8.data(), str8.length())) {
+        const auto& table = pimpl->ascii_table(*this, font_id, scale);
+        if (table.usable) {
+            if (auto layout = LayoutASCII(table, font_id, scale, str8)) {
+                return std::move(*layout);
+            }
+        }
+    }
+    return pimpl->shape_line(*this, font_id, str8, scale);
+}
 
-    cairo_font_options_t* font_options = cairo_font_options_create();
-    cairo_font_options_set_antialias(font_options, CAIRO_ANTIALIAS_SUBPIXEL);
-    cairo_set_font_options(layout_context.get(), font_options);
-    cairo_font_options_destroy(font_options);
+bool FontRasterizer::has_ascii_fast_path(FontId font_id, int scale) {
+    std::lock_guard pango_lock{pimpl->pango_mutex};
+    return pimpl->ascii_table(*this, font_id, clamp_scale(scale)).usable;
+}
 
-    GObjectPtr<PangoLayout> layout{pango_cairo_create_layout(layout_context.get())};
-    pango_layout_set_text(layout.get(), str8.data(), str8.length());
+LineLayout FontRasterizer::impl::shape_line(FontRasterizer& rasterizer,
+                                            size_t font_id,
+                                            std::string_view str8,
+                                            int scale) {
+    PangoFont* font = rasterizer.font_id_to_native[font_id].font.get();
 
-    PangoFontDescriptionPtr desc{pango_font_describe(font)};
-    pango_layout_set_font_description(layout.get(), desc.get());
+    PangoLayout* layout = layout_for(font_id, font);
+    pango_layout_set_text(layout, str8.data(), str8.length());
 
-    // We don't need to free this. This is owned by the `PangoLayout` instance.
-    PangoLayoutLine* layout_line = pango_layout_get_line_readonly(layout.get(), 0);
+    // We don't need to free this. This is owned by the `PangoLayout` instance, and stays valid
+    // until its text is replaced.
+    PangoLayoutLine* layout_line = pango_layout_get_line_readonly(layout, 0);
 
-    int font_size = metrics(font_id).font_size;
-    int line_height = metrics(font_id).line_height;
+    int line_height = rasterizer.metrics(font_id, scale).line_height;
 
+    // Glyphs are positioned from the unrounded pen position, so that rounding errors don't add up
+    // along the line. Advances are the differences between the rounded pen positions.
+    double pixels_per_unit = static_cast<double>(scale) / PANGO_SCALE;
+    double pen = 0;
     int total_advance = 0;
     std::vector<ShapedGlyph> glyphs;
     for (GSList* run = layout_line->runs; run != nullptr; run = run->next) {
@@ -175,9 +606,7 @@ LineLayout FontRasterizer::layout_line(size_t font_id, std::string_view str8) {
         PangoItem* item = glyph_item->item;
 
         PangoFont* run_font = item->analysis.font;
-        g_object_ref(run_font);
-        GObjectPtr<PangoFont> run_font_ptr{run_font};
-        size_t run_font_id = cache_font({std::move(run_font_ptr)}, font_size);
+        size_t run_font_id = this->run_font_id(rasterizer, font_id, run_font);
 
         PangoGlyphString* glyph_string = glyph_item->glyphs;
         PangoGlyphInfo* glyph_infos = glyph_string->glyphs;
@@ -199,47 +628,49 @@ LineLayout FontRasterizer::layout_line(size_t font_id, std::string_view str8) {
             gi.geometry.y_offset = height * PANGO_SCALE;
 
             // Cache glyph info struct.
-            if (pimpl->glyph_info_cache.size() <= run_font_id) {
-                pimpl->glyph_info_cache.resize(run_font_id + 1);
+            if (glyph_info_cache.size() <= run_font_id) {
+                glyph_info_cache.resize(run_font_id + 1);
             }
-            pimpl->glyph_info_cache[run_font_id][gi.glyph] = gi;
+            glyph_info_cache[run_font_id][gi.glyph] = gi;
 
             const PangoGlyphGeometry& geometry = gi.geometry;
-            int x_offset = PANGO_PIXELS(geometry.x_offset);
-            int y_offset = PANGO_PIXELS(geometry.y_offset);
-
-            // TODO: Don't hard-code this.
-            int scale_factor = 2;
-            width *= scale_factor;
-            height *= scale_factor;
-            x_offset *= scale_factor;
-            y_offset *= scale_factor;
+            int y_offset = PANGO_PIXELS(geometry.y_offset) * scale;
+            double x_offset = geometry.x_offset * pixels_per_unit;
+            double x_advance = logical_rect.width * pixels_per_unit;
+            auto [x, x_phase] = SplitSubpixel(pen + x_offset);
 
             // Pango's origin is at the top left. Invert the y-axis.
             // TODO: Since our app uses a top left origin, consider inverting bottom left origin
             // rasterizers (e.g., Core Text) instead of Pango.
             y_offset = line_height - y_offset;
 
+            pen += x_advance;
+            int next_advance = std::lround(pen);
+
             uint32_t glyph_id = gi.glyph;
-            Point position = {.x = total_advance + x_offset, .y = y_offset};
-            Point advance = {.x = width};
+            Point position = {.x = x, .y = y_offset};
+            Point advance = {.x = next_advance - total_advance};
             size_t index = offset + log_clusters[i];
 
             ShapedGlyph glyph = {
                 .font_id = run_font_id,
                 .glyph_id = glyph_id,
                 .position = std::move(position),
+                .x_phase = x_phase,
                 .advance = std::move(advance),
                 .index = index,
+                .x_offset = x_offset,
+                .x_advance = x_advance,
             };
             glyphs.emplace_back(std::move(glyph));
 
-            total_advance += advance.x;
+            total_advance = next_advance;
         }
     }
 
     return {
         .layout_font_id = font_id,
+        .scale = scale,
         // We shouldn't use Pango's width since we make our own slight adjustments.
         .width = total_advance,
         .length = str8.length(),
@@ -265,31 +696,38 @@ size_t FontRasterizer::cache_font(NativeFontType native_font, int font_size) {
         std::abort();
     }
 
-    // TODO: Don't hard-code this.
-    int scale_factor = 2;
-
     // TODO: Do we use std::ceil()?
     int ascent = pango_font_metrics_get_ascent(pango_metrics.get()) / PANGO_SCALE;
     int descent = pango_font_metrics_get_descent(pango_metrics.get()) / PANGO_SCALE;
     int height = pango_font_metrics_get_height(pango_metrics.get()) / PANGO_SCALE;
-    ascent *= scale_factor;
-    descent *= scale_factor;
-    height *= scale_factor;
 
-    int line_height = std::max(ascent + descent, height);
+    std::array<Metrics, kMaxScale> metrics;
+    for (int scale = 1; scale <= kMaxScale; ++scale) {
+        metrics[scale - 1] = {
+            .line_height = std::max(ascent + descent, height) * scale,
+            .ascent = ascent * scale,
+            .descent = descent * scale,
+            .font_size = font_size,
+        };
+    }
 
-    Metrics metrics = {
-        .line_height = line_height,
-        .ascent = ascent,
-        .descent = descent,
-        .font_size = font_size,
-    };
+    // Fontconfig knows the file of the font.
+    std::string file_key;
+    if (PANGO_IS_FC_FONT(native_font.font.get())) {
+        FcPattern* pattern = pango_fc_font_get_pattern(PANGO_FC_FONT(native_font.font.get()));
+        FcChar8* file = nullptr;
+        if (FcPatternGetString(pattern, FC_FILE, 0, &file) == FcResultMatch) {
+            file_key = file_key_from_path(reinterpret_cast<const char*>(file));
+        }
+    }
 
+    std::lock_guard lock{font_mutex};
     size_t font_id = font_hash_to_id.size();
     font_hash_to_id.emplace(hash, font_id);
     font_id_to_native.emplace_back(std::move(native_font));
     font_id_to_metrics.emplace_back(std::move(metrics));
     font_id_to_postscript_name.emplace_back(std::move(font_name));
+    font_id_to_file_key.emplace_back(std::move(file_key));
     return font_id;
 }
 
@@ -1,33 +1,341 @@
 #include <gtest/gtest.h>
 
+#include "base/files/file_util.h"
+#include "base/numeric/literals.h"
+#include "build/build_config.h"
 #include "font/font_rasterizer.h"
+#include "font/glyph_disk_cache.h"
 #include "util/random_util.h"
 
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fmt/base.h>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> allocation_count = 0;
+
+}  // namespace
+
+// Counts heap allocations, so that the rasterizer's can be reported per glyph. On Linux, malloc()
+// is interposed to also see the allocations made by Pango and Cairo. Elsewhere, only C++
+// allocations are counted. The replacements apply to the whole `perftest_runner` on purpose: they
+// only add a relaxed atomic increment, which is cheaper than a separate runner for this file.
+#if BUILDFLAG(IS_LINUX)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+}
+#else
+void* operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* ptr = std::malloc(size);
+    // Exceptions are disabled, so allocation failures abort like they do everywhere else.
+    if (!ptr) std::abort();
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+    std::free(ptr);
+}
+#endif
+
 namespace font {
 
+namespace {
+
+constexpr size_t kGlyphCount = 10000;
+
+// Rasterizes `kGlyphCount` glyphs with `rasterize` and reports the throughput and allocations.
+template <typename Rasterize>
+void Measure(const char* name, Rasterize&& rasterize) {
+    // Warm up caches, e.g., the thread's scratch surface.
+    rasterize();
+
+    size_t allocations_before = allocation_count.load();
+    auto t1 = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kGlyphCount; ++i) {
+        rasterize();
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    size_t allocations = allocation_count.load() - allocations_before;
+
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    fmt::println("{}: {:.0f} glyphs/sec, {:.2f} allocations/glyph", name, kGlyphCount / seconds,
+                 static_cast<double>(allocations) / kGlyphCount);
+}
+
+}  // namespace
+
 // We should move the rasterized bitmap data *directly* into OpenGL. Manually creating the buffer
 // via rearranging pixels will be too slow.
 TEST(FontRasterizerTest, RasterizePerformance) {
     auto& rasterizer = FontRasterizer::instance();
     size_t font_id = rasterizer.add_system_font(32);
 
-    auto layout = rasterizer.layout_line(font_id, "a");
+    auto layout = rasterizer.layout_line(font_id, "a", 2);
     uint32_t glyph_id = layout.glyphs[0].glyph_id;
 
-    for (int i = 0; i < 10000; ++i) {
-        auto rglyph = rasterizer.rasterize(font_id, glyph_id);
+    Measure("rasterize", [&] {
+        auto rglyph = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0);
         EXPECT_GT(rglyph.width, 0);
         EXPECT_GT(rglyph.height, 0);
+    });
+
+    // Drawing into a reused buffer, like the texture cache's upload staging buffer, should not
+    // allocate at all.
+    auto measured = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0);
+    std::vector<uint8_t> buffer(measured.width * measured.height * 4);
+    Measure("rasterize into buffer", [&] {
+        auto rglyph = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0, buffer);
+        EXPECT_GT(rglyph.width, 0);
+        EXPECT_GT(rglyph.height, 0);
+    });
+}
+
+// Bitmaps should be tight around the glyph's ink, so that each atlas page holds as many glyphs as
+// possible. This compares them with cells of the line height by the advance.
+TEST(FontRasterizerTest, AtlasOccupancy) {
+    // The area of a page of the texture atlas in the GUI.
+    constexpr size_t kAtlasPageArea = 2048 * 2048;
+
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+    int line_height = rasterizer.metrics(font_id, 2).line_height;
+
+    std::string printable;
+    for (char ch = ' '; ch <= '~'; ++ch) {
+        printable += ch;
     }
+    auto layout = rasterizer.layout_line(font_id, printable, 2);
+
+    size_t bitmap_area = 0;
+    size_t cell_area = 0;
+    size_t ink_area = 0;
+    for (const auto& glyph : layout.glyphs) {
+        auto rglyph =
+            rasterizer.rasterize(glyph.font_id, glyph.glyph_id, layout.scale, glyph.x_phase);
+        bitmap_area += rglyph.width * rglyph.height;
+        cell_area += glyph.advance.x * line_height;
+        for (size_t i = 3; i < rglyph.buffer.size(); i += 4) {
+            if (rglyph.buffer[i] != 0) ++ink_area;
+        }
+    }
+
+    size_t glyph_count = layout.glyphs.size();
+    fmt::println("bitmaps: {} px, {:.1f}% ink, ~{} glyphs per atlas page", bitmap_area,
+                 100.0 * ink_area / bitmap_area, kAtlasPageArea * glyph_count / bitmap_area);
+    fmt::println("cells: {} px, {:.1f}% ink, ~{} glyphs per atlas page", cell_area,
+                 100.0 * ink_area / cell_area, kAtlasPageArea * glyph_count / cell_area);
+    EXPECT_LT(bitmap_area, cell_area);
+}
+
+// Each subpixel phase of a glyph takes its own space in the atlas. This reports how often each
+// phase is used in proportional text, and what its distinct glyphs cost in the atlas.
+TEST(FontRasterizerTest, SubpixelPhaseCost) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+
+    struct PhaseCost {
+        size_t uses = 0;
+        std::set<std::pair<size_t, uint32_t>> glyphs;
+        size_t atlas_area = 0;
+    };
+    std::array<PhaseCost, kSubpixelPhases> costs;
+    size_t total_uses = 0;
+    for (int i = 0; i < 100; ++i) {
+        auto layout = rasterizer.layout_line(font_id, util::RandomString(100), 2);
+        for (const auto& glyph : layout.glyphs) {
+            auto& cost = costs[glyph.x_phase];
+            ++cost.uses;
+            ++total_uses;
+            if (cost.glyphs.emplace(glyph.font_id, glyph.glyph_id).second) {
+                auto rglyph = rasterizer.rasterize(glyph.font_id, glyph.glyph_id, layout.scale,
+                                                   glyph.x_phase);
+                cost.atlas_area += rglyph.width * rglyph.height;
+            }
+        }
+    }
+
+    for (int phase = 0; phase < kSubpixelPhases; ++phase) {
+        const auto& cost = costs[phase];
+        fmt::println("phase {}: {:.1f}% of glyphs, {} distinct glyphs, {} px in atlas", phase,
+                     100.0 * cost.uses / total_uses, cost.glyphs.size(), cost.atlas_area);
+    }
+}
+
+// Times the glyphs drawn before the first frame on a cold start, when every glyph is rasterized,
+// and on a warm start, when they are read from the glyph disk cache. Layout and the atlas upload
+// are the same for both, so they are left out.
+TEST(FontRasterizerTest, ColdAndWarmStart) {
+    auto& rasterizer = FontRasterizer::instance();
+    std::string printable;
+    for (char ch = ' '; ch <= '~'; ++ch) {
+        printable += ch;
+    }
+    // The main font and the UI fonts.
+    std::vector<LineLayout> layouts;
+    for (size_t font_id : {rasterizer.add_font("monospace", 16), rasterizer.add_system_font(11),
+                           rasterizer.add_system_font(12)}) {
+        layouts.emplace_back(rasterizer.layout_line(font_id, printable, 2));
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    std::vector<GlyphDiskCache::Entry> entries;
+    std::vector<uint8_t> bitmaps;
+    for (const auto& layout : layouts) {
+        for (const auto& glyph : layout.glyphs) {
+            auto rglyph = rasterizer.rasterize(glyph.font_id, glyph.glyph_id, layout.scale,
+                                               glyph.x_phase);
+            // Plain glyphs keep only their coverage, like in the atlas.
+            size_t offset = bitmaps.size();
+            for (size_t i = 3; i < rglyph.buffer.size(); i += 4) {
+                bitmaps.emplace_back(rglyph.buffer[i]);
+            }
+            int font_size = rasterizer.metrics(glyph.font_id, layout.scale).font_size;
+            entries.push_back({
+                .font_key = GlyphDiskCache::font_key(rasterizer.postscript_name(glyph.font_id),
+                                                     font_size,
+                                                     rasterizer.file_key(glyph.font_id)),
+                .glyph_key = glyph.glyph_id,
+                .left = rglyph.left,
+                .top = rglyph.top,
+                .width = rglyph.width,
+                .height = rglyph.height,
+                .offset = offset,
+                .size = bitmaps.size() - offset,
+            });
+        }
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    base::FilePath path;
+    ASSERT_TRUE(base::GetTempDir(&path));
+    path = path.Append(FILE_PATH_LITERAL("glyph_disk_cache_perftest"));
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+
+    auto t3 = std::chrono::steady_clock::now();
+    GlyphDiskCache disk_cache;
+    ASSERT_TRUE(disk_cache.load(path));
+    // Read every bitmap, like the upload to the atlas does.
+    size_t checksum = 0;
+    for (const auto& entry : disk_cache.entries()) {
+        for (uint8_t byte : disk_cache.bitmap(entry)) {
+            checksum += byte;
+        }
+    }
+    auto t4 = std::chrono::steady_clock::now();
+
+    EXPECT_EQ(disk_cache.entries().size(), entries.size());
+    EXPECT_GT(checksum, 0_Z);
+    double cold_ms = std::chrono::duration<double, std::milli>(t2 - t1).count();
+    double warm_ms = std::chrono::duration<double, std::milli>(t4 - t3).count();
+    fmt::println("{} glyphs: cold start {:.2f} ms, warm start {:.2f} ms", entries.size(), cold_ms,
+                 warm_ms);
+    base::DeleteFile(path);
 }
 
 TEST(FontRasterizerTest, LineLayoutPerformance) {
     auto& rasterizer = FontRasterizer::instance();
     size_t font_id = rasterizer.add_system_font(32);
 
-    for (int i = 0; i < 1000; ++i) {
-        std::string str = util::RandomString(100);
-        auto layout = rasterizer.layout_line(font_id, str);
+    for (size_t line_length : {100, 1000}) {
+        // Generate the lines up front so that only layout is timed.
+        std::vector<std::string> lines;
+        for (int i = 0; i < 1000; ++i) {
+            lines.emplace_back(util::RandomString(line_length));
+        }
+
+        auto t1 = std::chrono::steady_clock::now();
+        for (const auto& line : lines) {
+            auto layout = rasterizer.layout_line(font_id, line, 2);
+            EXPECT_EQ(layout.length, line_length);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double seconds = std::chrono::duration<double>(t2 - t1).count();
+        fmt::println("layout_line ({} characters): {:.0f} lines/sec", line_length,
+                     lines.size() / seconds);
+    }
+}
+
+// Lines that mix scripts are shaped in runs of fallback fonts, each of which is mapped back to a
+// font ID.
+TEST(FontRasterizerTest, LineLayoutMixedScripts) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+
+    // Alternating Latin, CJK and emoji runs.
+    std::string line;
+    for (int i = 0; i < 20; ++i) {
+        line += "text 日本語 😄 ";
+    }
+
+    auto t1 = std::chrono::steady_clock::now();
+    constexpr int kIterations = 1000;
+    for (int i = 0; i < kIterations; ++i) {
+        auto layout = rasterizer.layout_line(font_id, line, 2);
+        EXPECT_EQ(layout.length, line.length());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(t2 - t1).count();
+    fmt::println("layout_line (mixed scripts): {:.0f} lines/sec", kIterations / seconds);
+}
+
+// Shaping caches each glyph's info for rasterization. This reports what that costs when a line
+// introduces many glyphs that weren't seen before, like the first screen of CJK text, and when
+// its glyphs were all seen before.
+TEST(FontRasterizerTest, LineLayoutNewGlyphs) {
+    auto& rasterizer = FontRasterizer::instance();
+    // A font size that no other test uses, so that none of its glyphs were seen before.
+    size_t font_id = rasterizer.add_system_font(31);
+
+    // 1000 distinct CJK ideographs, from U+4E00.
+    std::string line;
+    for (char32_t ch = 0x4E00; ch < 0x4E00 + 1000; ++ch) {
+        line += static_cast<char>(0xE0 | (ch >> 12));
+        line += static_cast<char>(0x80 | ((ch >> 6) & 0x3F));
+        line += static_cast<char>(0x80 | (ch & 0x3F));
+    }
+
+    for (const char* name : {"new glyphs", "seen glyphs"}) {
+        size_t allocations_before = allocation_count.load();
+        auto t1 = std::chrono::steady_clock::now();
+        auto layout = rasterizer.layout_line(font_id, line, 2);
+        auto t2 = std::chrono::steady_clock::now();
+        size_t allocations = allocation_count.load() - allocations_before;
+
+        size_t glyph_count = layout.glyphs.size();
+        double micros = std::chrono::duration<double, std::micro>(t2 - t1).count();
+        fmt::println("layout_line ({}): {:.3f} us/glyph, {:.2f} allocations/glyph", name,
+                     micros / glyph_count, static_cast<double>(allocations) / glyph_count);
     }
 }
 
@@ -4,6 +4,10 @@
 #include "build/build_config.h"
 #include "font/font_rasterizer.h"
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace font {
 
 static_assert(!std::is_copy_constructible_v<FontRasterizer>);
@@ -14,7 +18,7 @@ static_assert(!std::is_move_assignable_v<FontRasterizer>);
 TEST(FontRasterizerTest, LayoutLine1) {
     auto& rasterizer = FontRasterizer::instance();
     size_t font_id = rasterizer.add_system_font(32);
-    auto layout = rasterizer.layout_line(font_id, "Hello😄🙂hi");
+    auto layout = rasterizer.layout_line(font_id, "Hello😄🙂hi", 2);
 
     EXPECT_GT(layout.width, 0);
     EXPECT_EQ(layout.glyphs.size(), 9_Z);
@@ -30,12 +34,14 @@ TEST(FontRasterizerTest, LayoutLine1) {
     EXPECT_EQ(emoji_glyph_2.index, 9_Z);
 
     // Emojis should be colored and should have 4 channels.
-    auto emoji_rglyph = rasterizer.rasterize(emoji_glyph_1.font_id, emoji_glyph_1.glyph_id);
+    auto emoji_rglyph =
+        rasterizer.rasterize(emoji_glyph_1.font_id, emoji_glyph_1.glyph_id, layout.scale, 0);
     EXPECT_TRUE(emoji_rglyph.colored);
     EXPECT_EQ(emoji_rglyph.buffer.size(), emoji_rglyph.width * emoji_rglyph.height * 4_Z);
 
     // Regular text should not be colored, but should also have 4 channels.
-    auto letter_rglyph = rasterizer.rasterize(letter_glyph_1.font_id, letter_glyph_1.glyph_id);
+    auto letter_rglyph =
+        rasterizer.rasterize(letter_glyph_1.font_id, letter_glyph_1.glyph_id, layout.scale, 0);
     EXPECT_FALSE(letter_rglyph.colored);
     EXPECT_EQ(letter_rglyph.buffer.size(), letter_rglyph.width * letter_rglyph.height * 4_Z);
 
@@ -50,7 +56,7 @@ TEST(FontRasterizerTest, LayoutLine1) {
 TEST(FontRasterizerTest, LayoutLine2) {
     auto& rasterizer = FontRasterizer::instance();
     size_t font_id = rasterizer.add_system_font(32);
-    auto layout = rasterizer.layout_line(font_id, "Hello😄🙂hi");
+    auto layout = rasterizer.layout_line(font_id, "Hello😄🙂hi", 2);
 
     int total_advance = 0;
     for (const auto& glyph : layout.glyphs) {
@@ -60,4 +66,172 @@ TEST(FontRasterizerTest, LayoutLine2) {
     EXPECT_EQ(total_advance, layout.width);
 }
 
+// ASCII lines in a monospace font may skip shaping, which must not change the result.
+TEST(FontRasterizerTest, LayoutLineASCII) {
+    auto& rasterizer = FontRasterizer::instance();
+    // Advances at this size aren't whole pixels, so glyphs land on several subpixel phases.
+    size_t font_id = rasterizer.add_font("monospace", 15);
+#if BUILDFLAG(IS_LINUX)
+    EXPECT_TRUE(rasterizer.has_ascii_fast_path(font_id, 2));
+#endif
+
+    auto long_line = rasterizer.layout_line(font_id, "int main() { return 0; }", 2);
+    EXPECT_TRUE(std::ranges::any_of(long_line.glyphs,
+                                    [](const auto& glyph) { return glyph.x_phase != 0; }));
+
+    for (std::string str : {"int main() { return 0; }", "    auto x = a->b != c;", " ", ""}) {
+        auto layout = rasterizer.layout_line(font_id, str, 2);
+        // A non-ASCII character at the end forces the line to be shaped, without affecting the
+        // glyphs before it.
+        auto shaped = rasterizer.layout_line(font_id, str + "é", 2);
+        ASSERT_EQ(layout.glyphs.size() + 1, shaped.glyphs.size()) << str;
+        EXPECT_EQ(layout.width, shaped.width - shaped.glyphs.back().advance.x) << str;
+        EXPECT_EQ(layout.length, str.length());
+
+        for (size_t i = 0; i < layout.glyphs.size(); ++i) {
+            const auto& glyph = layout.glyphs[i];
+            const auto& expected = shaped.glyphs[i];
+            EXPECT_EQ(glyph.font_id, expected.font_id) << str << " " << i;
+            EXPECT_EQ(glyph.glyph_id, expected.glyph_id) << str << " " << i;
+            EXPECT_EQ(glyph.position.x, expected.position.x) << str << " " << i;
+            EXPECT_EQ(glyph.position.y, expected.position.y) << str << " " << i;
+            EXPECT_EQ(glyph.x_phase, expected.x_phase) << str << " " << i;
+            EXPECT_EQ(glyph.advance.x, expected.advance.x) << str << " " << i;
+            EXPECT_EQ(glyph.index, expected.index) << str << " " << i;
+        }
+    }
+}
+
+TEST(FontRasterizerTest, RasterizeIntoBuffer) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+    auto layout = rasterizer.layout_line(font_id, "a", 2);
+    uint32_t glyph_id = layout.glyphs[0].glyph_id;
+
+    auto expected = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0);
+    ASSERT_FALSE(expected.buffer.empty());
+
+    // The bitmap is drawn into the caller's buffer, which may be larger than needed.
+    std::vector<uint8_t> buffer(expected.buffer.size() + 16, 0xAB);
+    auto rglyph = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0, buffer);
+    EXPECT_TRUE(rglyph.buffer.empty());
+    EXPECT_EQ(rglyph.width, expected.width);
+    EXPECT_EQ(rglyph.height, expected.height);
+    EXPECT_EQ(rglyph.left, expected.left);
+    EXPECT_EQ(rglyph.top, expected.top);
+    EXPECT_EQ(rglyph.colored, expected.colored);
+    EXPECT_TRUE(std::equal(expected.buffer.begin(), expected.buffer.end(), buffer.begin()));
+
+    // A buffer that is too small is left untouched, but the size is still reported.
+    std::vector<uint8_t> small_buffer(expected.buffer.size() - 1, 0xAB);
+    rglyph = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0, small_buffer);
+    EXPECT_EQ(rglyph.width, expected.width);
+    EXPECT_EQ(rglyph.height, expected.height);
+    EXPECT_TRUE(std::ranges::all_of(small_buffer, [](uint8_t byte) { return byte == 0xAB; }));
+}
+
+// A batch holds the same bitmaps as rasterizing each glyph on its own.
+TEST(FontRasterizerTest, RasterizeBatch) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+    auto layout = rasterizer.layout_line(font_id, "Hello world", 2);
+
+    std::vector<BatchGlyph> glyphs;
+    for (const auto& glyph : layout.glyphs) {
+        glyphs.push_back({glyph.glyph_id, glyph.x_phase});
+    }
+    auto batch = rasterizer.rasterize_batch(font_id, layout.scale, glyphs);
+    ASSERT_EQ(batch.glyphs.size(), glyphs.size());
+    EXPECT_EQ(batch.buffer.size(), batch.width * batch.height * 4_Z);
+
+    for (const auto& glyph : batch.glyphs) {
+        auto expected = rasterizer.rasterize(font_id, glyph.glyph_id, layout.scale, glyph.x_phase);
+        EXPECT_TRUE(glyph.rglyph.buffer.empty());
+        EXPECT_EQ(glyph.rglyph.left, expected.left);
+        EXPECT_EQ(glyph.rglyph.top, expected.top);
+        ASSERT_EQ(glyph.rglyph.width, expected.width);
+        ASSERT_EQ(glyph.rglyph.height, expected.height);
+        EXPECT_LE(glyph.x + glyph.rglyph.width, batch.width);
+        EXPECT_LE(glyph.y + glyph.rglyph.height, batch.height);
+
+        size_t row_size = expected.width * 4_Z;
+        for (int y = 0; y < expected.height; ++y) {
+            auto row = batch.buffer.begin() + (glyph.y + y) * batch.width * 4 + glyph.x * 4;
+            EXPECT_TRUE(std::equal(row, row + row_size, expected.buffer.begin() + y * row_size));
+        }
+    }
+}
+
+// Metrics, layouts and glyphs are at the given scale.
+TEST(FontRasterizerTest, Scale) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+
+    auto metrics_1x = rasterizer.metrics(font_id, 1);
+    auto layout_1x = rasterizer.layout_line(font_id, "Hello", 1);
+    auto metrics_2x = rasterizer.metrics(font_id, 2);
+    auto layout_2x = rasterizer.layout_line(font_id, "Hello", 2);
+
+    EXPECT_EQ(layout_1x.scale, 1);
+    EXPECT_EQ(layout_2x.scale, 2);
+    // Backends may round after scaling, so each value may be off by a pixel.
+    EXPECT_NEAR(metrics_2x.ascent, metrics_1x.ascent * 2, 1);
+    EXPECT_NEAR(metrics_2x.descent, metrics_1x.descent * 2, 1);
+    EXPECT_EQ(metrics_2x.font_size, metrics_1x.font_size);
+    ASSERT_EQ(layout_2x.glyphs.size(), layout_1x.glyphs.size());
+    EXPECT_NEAR(layout_2x.width, layout_1x.width * 2, layout_1x.glyphs.size());
+
+    uint32_t glyph_id = layout_1x.glyphs[0].glyph_id;
+    auto rglyph_1x = rasterizer.rasterize(font_id, glyph_id, 1, 0);
+    auto rglyph_2x = rasterizer.rasterize(font_id, glyph_id, 2, 0);
+    EXPECT_GT(rglyph_2x.width, rglyph_1x.width);
+    EXPECT_GT(rglyph_2x.height, rglyph_1x.height);
+
+    // Scales are clamped to the supported range.
+    EXPECT_EQ(rasterizer.layout_line(font_id, "Hello", 0).scale, 1);
+    EXPECT_EQ(rasterizer.layout_line(font_id, "Hello", FontRasterizer::kMaxScale + 1).scale,
+              FontRasterizer::kMaxScale);
+    EXPECT_EQ(rasterizer.metrics(font_id, 0).ascent, metrics_1x.ascent);
+}
+
+TEST(FontRasterizerTest, SplitSubpixel) {
+    EXPECT_EQ(SplitSubpixel(0), std::make_pair(0, 0));
+    EXPECT_EQ(SplitSubpixel(10.25), std::make_pair(10, 1));
+    EXPECT_EQ(SplitSubpixel(10.6), std::make_pair(10, 2));
+    // Rounds up to the next pixel.
+    EXPECT_EQ(SplitSubpixel(10.9), std::make_pair(11, 0));
+    EXPECT_EQ(SplitSubpixel(-0.25), std::make_pair(-1, 3));
+}
+
+// Glyphs are placed at subpixel positions, while advances stay whole pixels that add up to the
+// width of the line.
+TEST(FontRasterizerTest, SubpixelPositions) {
+    auto& rasterizer = FontRasterizer::instance();
+    size_t font_id = rasterizer.add_system_font(32);
+    auto layout =
+        rasterizer.layout_line(font_id, "The quick brown fox jumps over the lazy dog", 2);
+
+    int total_advance = 0;
+    for (const auto& glyph : layout.glyphs) {
+        EXPECT_GE(glyph.x_phase, 0);
+        EXPECT_LT(glyph.x_phase, kSubpixelPhases);
+        // Advances are rounded from the pen position, so they may be up to a pixel away from the
+        // subpixel position.
+        EXPECT_NEAR(glyph.position.x + static_cast<double>(glyph.x_phase) / kSubpixelPhases,
+                    total_advance, 1.0);
+        total_advance += glyph.advance.x;
+    }
+    EXPECT_EQ(total_advance, layout.width);
+
+    // Each phase is rasterized separately and shifts the ink to the right.
+    uint32_t glyph_id = layout.glyphs[0].glyph_id;
+    auto rglyph = rasterizer.rasterize(font_id, glyph_id, layout.scale, 0);
+    for (int x_phase = 1; x_phase < kSubpixelPhases; ++x_phase) {
+        auto shifted = rasterizer.rasterize(font_id, glyph_id, layout.scale, x_phase);
+        EXPECT_GE(shifted.left, rglyph.left);
+        EXPECT_LE(shifted.left + shifted.width, rglyph.left + rglyph.width + 1);
+        EXPECT_EQ(shifted.height, rglyph.height);
+    }
+}
+
 }  // namespace font
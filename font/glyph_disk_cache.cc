@@ -0,0 +1,105 @@
+#include "font/glyph_disk_cache.h"
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/hash/hash.h"
+
+#include <cstring>
+#include <type_traits>
+
+namespace font {
+
+namespace {
+
+constexpr char kMagic[4] = {'S', 'T', 'G', 'C'};
+
+// The file is the header, the entries, then the bitmaps. The entries follow the header directly,
+// so the header keeps them 8-byte aligned in the mapping.
+struct Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t entry_count;
+    uint64_t bitmaps_size;
+};
+
+static_assert(std::is_trivially_copyable_v<Header>);
+static_assert(std::is_trivially_copyable_v<GlyphDiskCache::Entry>);
+static_assert(sizeof(Header) % alignof(GlyphDiskCache::Entry) == 0);
+
+}  // namespace
+
+uint64_t GlyphDiskCache::font_key(std::string_view font_name,
+                                  int font_size,
+                                  std::string_view file_key) {
+    uint64_t hash = base::hash_combine(base::hash_string(font_name), font_size);
+    return base::hash_combine(hash, base::hash_string(file_key));
+}
+
+bool GlyphDiskCache::load(const base::FilePath& path) {
+    entry_table = {};
+    bitmaps = {};
+    if (!file.Initialize(path)) return false;
+
+    std::string_view data = file.data();
+    Header header;
+    if (data.size() < sizeof(Header)) return false;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        return false;
+    }
+
+    // Reject truncated files, checking the counts against the size before multiplying them.
+    size_t remaining = data.size() - sizeof(Header);
+    if (header.entry_count > remaining / sizeof(Entry)) return false;
+    size_t entries_size = header.entry_count * sizeof(Entry);
+    if (header.bitmaps_size != remaining - entries_size) return false;
+
+    const auto* entry_data = reinterpret_cast<const Entry*>(data.data() + sizeof(Header));
+    const auto* bitmap_data =
+        reinterpret_cast<const uint8_t*>(data.data() + sizeof(Header) + entries_size);
+    std::span<const Entry> entries{entry_data, header.entry_count};
+    for (const auto& entry : entries) {
+        uint64_t bitmaps_size = header.bitmaps_size;
+        if (entry.offset > bitmaps_size || entry.size > bitmaps_size - entry.offset) return false;
+    }
+
+    entry_table = entries;
+    bitmaps = {bitmap_data, header.bitmaps_size};
+    return true;
+}
+
+std::span<const GlyphDiskCache::Entry> GlyphDiskCache::entries() const {
+    return entry_table;
+}
+
+std::span<const uint8_t> GlyphDiskCache::bitmap(const Entry& entry) const {
+    return bitmaps.subspan(entry.offset, entry.size);
+}
+
+bool GlyphDiskCache::save(const base::FilePath& path,
+                          std::span<const Entry> entries,
+                          std::span<const uint8_t> bitmaps) {
+    base::FilePath temp_path{path.value() + FILE_PATH_LITERAL(".tmp")};
+    base::ScopedFILE fp(base::OpenFile(temp_path, "wb"));
+    if (!fp) return false;
+
+    Header header{
+        .version = kVersion,
+        .entry_count = entries.size(),
+        .bitmaps_size = bitmaps.size(),
+    };
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    bool written =
+        std::fwrite(&header, sizeof(Header), 1, fp.get()) == 1 &&
+        std::fwrite(entries.data(), sizeof(Entry), entries.size(), fp.get()) == entries.size() &&
+        std::fwrite(bitmaps.data(), 1, bitmaps.size(), fp.get()) == bitmaps.size();
+    // The file must be closed before it is moved on Windows, and closing flushes it.
+    written = base::CloseFile(fp.release()) && written;
+    if (!written || !base::ReplaceFile(temp_path, path)) {
+        base::DeleteFile(temp_path);
+        return false;
+    }
+    return true;
+}
+
+}  // namespace font
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "base/files/file_path.h"
+#include "base/files/memory_mapped_file.h"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace font {
+
+// A file of rasterized glyphs that persists between launches, so that the glyphs drawn at startup
+// aren't rasterized again. Glyphs are keyed by their font's name, size and file, and by a key of
+// the caller's choosing, e.g., the glyph ID, scale and subpixel phase. Bitmaps are stored as given,
+// in the caller's format. The file is memory-mapped, so loading it doesn't copy the bitmaps.
+class GlyphDiskCache {
+public:
+    // Files of other versions are ignored. Bump this when the layout below changes, or when the
+    // rasterizers draw glyphs differently.
+    static constexpr uint32_t kVersion = 1;
+
+    struct Entry {
+        uint64_t font_key;
+        uint64_t glyph_key;
+        int32_t left;
+        int32_t top;
+        int32_t width;
+        int32_t height;
+        // The bitmap's range in `bitmaps()`.
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // Font IDs differ between launches, so fonts are identified by their name and size instead.
+    // `file_key` identifies the font's file and its version, e.g., `FontRasterizer::file_key()`,
+    // so that glyphs of an updated font or another font of the same name aren't reused.
+    static uint64_t font_key(std::string_view font_name,
+                             int font_size,
+                             std::string_view file_key);
+
+    // Maps the file at `path`. Returns false if it is missing, truncated or of another version, in
+    // which case the cache is empty.
+    bool load(const base::FilePath& path);
+    std::span<const Entry> entries() const;
+    std::span<const uint8_t> bitmap(const Entry& entry) const;
+
+    // Writes the glyphs to `path`, replacing the file. The glyphs are written to a temporary file
+    // that is then moved over `path`, so that a crash or another window saving at the same time
+    // never leaves a partly written file. The file must not be mapped by a loaded cache.
+    static bool save(const base::FilePath& path,
+                     std::span<const Entry> entries,
+                     std::span<const uint8_t> bitmaps);
+
+private:
+    base::MemoryMappedFile file;
+    std::span<const Entry> entry_table;
+    std::span<const uint8_t> bitmaps;
+};
+
+}  // namespace font
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+
+#include "base/files/file_util.h"
+#include "base/files/scoped_file.h"
+#include "base/numeric/literals.h"
+#include "font/glyph_disk_cache.h"
+
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+namespace font {
+
+namespace {
+
+base::FilePath TempPath(base::FilePath::StringPieceType name) {
+    base::FilePath temp_dir;
+    EXPECT_TRUE(base::GetTempDir(&temp_dir));
+    return temp_dir.Append(name);
+}
+
+// Rewrites the file at |path| without its last byte.
+void TruncateLastByte(const base::FilePath& path) {
+    base::File::Info info;
+    ASSERT_TRUE(base::GetFileInfo(path, &info));
+    ASSERT_GT(info.size, 0);
+    std::vector<char> contents(static_cast<size_t>(info.size));
+    {
+        base::ScopedFILE fp(base::OpenFile(path, "rb"));
+        ASSERT_NE(fp, nullptr);
+        ASSERT_EQ(std::fread(contents.data(), 1, contents.size(), fp.get()), contents.size());
+    }
+    ASSERT_TRUE(base::WriteFile(path, {contents.data(), contents.size() - 1}));
+}
+
+}  // namespace
+
+TEST(GlyphDiskCacheTest, SaveAndLoad) {
+    auto path = TempPath(FILE_PATH_LITERAL("glyph_disk_cache_unittest"));
+    uint64_t font_key = GlyphDiskCache::font_key("Source Code Pro", 16, "");
+    std::vector<uint8_t> bitmaps = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    std::vector<GlyphDiskCache::Entry> entries = {
+        {font_key, 42, 1, 10, 2, 3, 0, 6},
+        {font_key, 43, -1, 8, 2, 2, 6, 4},
+    };
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+
+    GlyphDiskCache cache;
+    ASSERT_TRUE(cache.load(path));
+    ASSERT_EQ(cache.entries().size(), 2_Z);
+    const auto& entry = cache.entries()[1];
+    EXPECT_EQ(entry.font_key, font_key);
+    EXPECT_EQ(entry.glyph_key, 43_Z);
+    EXPECT_EQ(entry.left, -1);
+    EXPECT_EQ(entry.top, 8);
+    auto bitmap = cache.bitmap(entry);
+    EXPECT_EQ(std::vector<uint8_t>(bitmap.begin(), bitmap.end()),
+              (std::vector<uint8_t>{7, 8, 9, 10}));
+
+    base::DeleteFile(path);
+}
+
+TEST(GlyphDiskCacheTest, FontKey) {
+    constexpr std::string_view kFile = "/fonts/Menlo.ttc:100:1";
+    uint64_t key = GlyphDiskCache::font_key("Menlo", 16, kFile);
+    EXPECT_EQ(key, GlyphDiskCache::font_key("Menlo", 16, kFile));
+    EXPECT_NE(key, GlyphDiskCache::font_key("Menlo", 17, kFile));
+    EXPECT_NE(key, GlyphDiskCache::font_key("Monaco", 16, kFile));
+    // An updated font file has another size or modification time.
+    EXPECT_NE(key, GlyphDiskCache::font_key("Menlo", 16, "/fonts/Menlo.ttc:100:2"));
+}
+
+// Saving replaces the file as a whole, and leaves no temporary file behind.
+TEST(GlyphDiskCacheTest, SaveReplacesFile) {
+    auto path = TempPath(FILE_PATH_LITERAL("glyph_disk_cache_unittest_replace"));
+    std::vector<uint8_t> bitmaps(16, 0xFF);
+    std::vector<GlyphDiskCache::Entry> entries = {
+        {1, 2, 0, 0, 4, 4, 0, 16},
+        {1, 3, 0, 0, 0, 0, 16, 0},
+    };
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+    entries.pop_back();
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+
+    GlyphDiskCache cache;
+    ASSERT_TRUE(cache.load(path));
+    EXPECT_EQ(cache.entries().size(), 1_Z);
+    EXPECT_FALSE(base::PathExists(base::FilePath(path.value() + FILE_PATH_LITERAL(".tmp"))));
+
+    base::DeleteFile(path);
+}
+
+// Missing, truncated and foreign files leave the cache empty.
+TEST(GlyphDiskCacheTest, RejectInvalidFiles) {
+    auto path = TempPath(FILE_PATH_LITERAL("glyph_disk_cache_unittest_invalid"));
+    GlyphDiskCache cache;
+    base::DeleteFile(path);
+    EXPECT_FALSE(cache.load(path));
+
+    std::vector<uint8_t> bitmaps(16, 0xFF);
+    std::vector<GlyphDiskCache::Entry> entries = {{1, 2, 0, 0, 4, 4, 0, 16}};
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+    ASSERT_TRUE(cache.load(path));
+    TruncateLastByte(path);
+    EXPECT_FALSE(cache.load(path));
+    EXPECT_TRUE(cache.entries().empty());
+
+    // An entry whose bitmap reaches past the end of the file.
+    entries[0].size = 17;
+    ASSERT_TRUE(GlyphDiskCache::save(path, entries, bitmaps));
+    EXPECT_FALSE(cache.load(path));
+
+    {
+        base::ScopedFILE fp(base::OpenFile(path, "wb"));
+        ASSERT_NE(fp, nullptr);
+        std::fputs("not a glyph cache, but long enough for a header", fp.get());
+    }
+    EXPECT_FALSE(cache.load(path));
+
+    base::DeleteFile(path);
+}
+
+}  // namespace font
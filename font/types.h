@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cmath>
 #include <cstdint>
+#include <utility>
 #include <vector>
 
 namespace font {
@@ -59,22 +61,66 @@ struct RasterizedGlyph {
     bool colored;
 };
 
+// A glyph of a font to rasterize with `FontRasterizer::rasterize_batch()`.
+struct BatchGlyph {
+    uint32_t glyph_id;
+    int x_phase;
+};
+
+// Glyphs that were rasterized together. Their bitmaps are packed in rows of one BGRA image of
+// `width` by `height`, from which each glyph's rectangle can be copied.
+struct GlyphBatch {
+    struct Glyph {
+        uint32_t glyph_id;
+        int x_phase;
+        // The glyph's own buffer is left empty.
+        RasterizedGlyph rglyph;
+        // The top left corner of the glyph's bitmap in the image.
+        int x;
+        int y;
+    };
+    std::vector<Glyph> glyphs;
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> buffer;
+};
+
 // TODO: Consider making a global "geometry" namespace and moving Point there.
 struct Point {
     int x;
     int y;
 };
 
+// Glyphs are positioned horizontally in steps of 1 / `kSubpixelPhases` of a pixel, and each phase
+// of a glyph is rasterized separately.
+inline constexpr int kSubpixelPhases = 4;
+
 struct ShapedGlyph {
     size_t font_id;
     uint32_t glyph_id;
     Point position;
+    // The glyph is drawn `x_phase / kSubpixelPhases` of a pixel to the right of `position.x`.
+    int x_phase;
     Point advance;
     size_t index;  // UTF-8 index in the original text.
+    // The unrounded offset from the pen position and advance, in pixels. The pen position is the
+    // sum of the advances before the glyph, and `position.x`, `x_phase` and `advance.x` are
+    // rounded from it. Layouts can be joined from these without adding up rounding errors.
+    double x_offset;
+    double x_advance;
 };
 
+// Splits `x`, in pixels, into whole pixels and the nearest subpixel phase.
+inline std::pair<int, int> SplitSubpixel(double x) {
+    int steps = std::floor(x * kSubpixelPhases + 0.5);
+    int pixels = std::floor(static_cast<double>(steps) / kSubpixelPhases);
+    return {pixels, steps - pixels * kSubpixelPhases};
+}
+
 struct LineLayout {
     size_t layout_font_id;
+    // The display scale that positions and advances are in, which glyphs must be rasterized at.
+    int scale;
     int width;
     size_t length;
     std::vector<ShapedGlyph> glyphs;
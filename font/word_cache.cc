@@ -0,0 +1,134 @@
+#include "font/word_cache.h"
+
+#include "base/hash/hash.h"
+#include "third_party/uni_algo/include/uni_algo/script.h"
+#include "unicode/unicode.h"
+
+#include <cmath>
+#include <optional>
+#include <tuple>
+
+namespace font {
+
+namespace {
+
+// The cache is cleared when it grows past this many words, which bounds its memory use without
+// tracking recency.
+constexpr size_t kMaxWords = 100000;
+
+// Right-to-left text is reordered across words by the bidi algorithm, so it must be shaped with
+// the whole line. These are the blocks of the right-to-left scripts.
+bool IsRightToLeft(unicode::Unichar codepoint) {
+    return (0x0590 <= codepoint && codepoint <= 0x08FF) ||
+           (0xFB1D <= codepoint && codepoint <= 0xFDFF) ||
+           (0xFE70 <= codepoint && codepoint <= 0xFEFF) ||
+           (0x10800 <= codepoint && codepoint <= 0x10FFF) ||
+           (0x1E800 <= codepoint && codepoint <= 0x1EFFF);
+}
+
+// Returns the script of `codepoint`, or nothing if it takes on the script of the text around it,
+// e.g., punctuation, digits, emoji and combining marks.
+std::optional<una::locale::script> ScriptOf(unicode::Unichar codepoint) {
+    auto script = una::codepoint::get_script(codepoint);
+    if (script == una::locale::script{"Zyyy"} || script == una::locale::script{"Zinh"} ||
+        script == una::locale::script{"Zzzz"}) {
+        return std::nullopt;
+    }
+    return script;
+}
+
+}  // namespace
+
+LineLayout WordCache::layout_line(FontId font_id, std::string_view str8, int scale) {
+    scale = FontRasterizer::clamp_scale(scale);
+    auto segments = segment(str8);
+    if (segments.empty()) {
+        return FontRasterizer::instance().layout_line(font_id, str8, scale);
+    }
+
+    LineLayout layout = {
+        .layout_font_id = font_id,
+        .scale = scale,
+        .width = 0,
+        .length = str8.length(),
+    };
+    // Words are positioned from the unrounded pen position like glyphs in a line, so that the
+    // rounding errors of each word don't add up along the line.
+    double pen = 0;
+    for (std::string_view word : segments) {
+        size_t offset = word.data() - str8.data();
+        const LineLayout& word_layout = layout_word(font_id, word, scale);
+        for (ShapedGlyph glyph : word_layout.glyphs) {
+            std::tie(glyph.position.x, glyph.x_phase) = SplitSubpixel(pen + glyph.x_offset);
+            pen += glyph.x_advance;
+            int next_advance = std::lround(pen);
+            glyph.advance.x = next_advance - layout.width;
+            glyph.index += offset;
+            layout.glyphs.emplace_back(std::move(glyph));
+            layout.width = next_advance;
+        }
+    }
+    return layout;
+}
+
+void WordCache::clear() {
+    cache.clear();
+}
+
+size_t WordCache::size() const {
+    return cache.size();
+}
+
+std::vector<std::string_view> WordCache::segment(std::string_view str8) {
+    std::vector<std::string_view> segments;
+    size_t start = 0;
+    bool in_spaces = false;
+    std::optional<una::locale::script> word_script;
+
+    const char* begin = str8.data();
+    const char* end = begin + str8.length();
+    for (const char* ptr = begin; ptr < end;) {
+        size_t offset = ptr - begin;
+        unicode::Unichar codepoint = unicode::NextUTF8(&ptr, end);
+        // Tabs advance to a tab stop, which depends on the start of the line.
+        if (codepoint < 0 || codepoint == '\t' || IsRightToLeft(codepoint)) {
+            return {};
+        }
+
+        bool is_space = codepoint == ' ';
+        auto script = is_space ? std::nullopt : ScriptOf(codepoint);
+        bool boundary = is_space != in_spaces || (script && word_script && script != word_script);
+        if (boundary) {
+            if (offset > start) {
+                segments.emplace_back(str8.substr(start, offset - start));
+            }
+            start = offset;
+            word_script = script;
+        } else if (script) {
+            word_script = script;
+        }
+        in_spaces = is_space;
+    }
+
+    if (start < str8.length()) {
+        segments.emplace_back(str8.substr(start));
+    }
+    return segments;
+}
+
+const LineLayout& WordCache::layout_word(FontId font_id, std::string_view word, int scale) {
+    auto& rasterizer = FontRasterizer::instance();
+    uint64_t hash = base::hash_combine(base::hash_string(word), font_id);
+    hash = base::hash_combine(hash, scale);
+    if (auto it = cache.find(hash); it != cache.end()) {
+        return it->second;
+    }
+
+    if (cache.size() >= kMaxWords) {
+        cache.clear();
+    }
+    auto layout = rasterizer.layout_line(font_id, word, scale);
+    return cache.emplace(hash, std::move(layout)).first->second;
+}
+
+}  // namespace font
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "font/font_rasterizer.h"
+#include "font/types.h"
+
+#include "third_party/hash_maps/robin_hood.h"
+
+#include <string_view>
+#include <vector>
+
+namespace font {
+
+// Shapes lines one word at a time and caches the shaped words, so that editing a long line only
+// reshapes the words that changed. Like the word caches in browsers, lines are segmented at spaces
+// and script changes. This gives up kerning and ligatures across segment boundaries.
+class WordCache {
+public:
+    // Returns the same layout as `FontRasterizer::layout_line()`, assembled from cached words.
+    LineLayout layout_line(FontId font_id, std::string_view str8, int scale);
+    void clear();
+    size_t size() const;
+
+    // Splits `str8` into runs of spaces and words of a single script. Returns no segments if the
+    // line must be shaped as a whole, e.g., if it contains tabs or right-to-left text.
+    static std::vector<std::string_view> segment(std::string_view str8);
+
+private:
+    // Keyed by the word, font and scale. Glyph positions and indices are relative to the start of
+    // the word. We use a node-based map since we need to keep references stable.
+    robin_hood::unordered_node_map<uint64_t, LineLayout> cache;
+
+    const LineLayout& layout_word(FontId font_id, std::string_view word, int scale);
+};
+
+}  // namespace font
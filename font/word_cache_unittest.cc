@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "base/numeric/literals.h"
+#include "font/font_rasterizer.h"
+#include "font/word_cache.h"
+
+#include <string_view>
+#include <vector>
+
+namespace font {
+
+using Segments = std::vector<std::string_view>;
+
+TEST(WordCacheTest, SegmentAtSpaces) {
+    EXPECT_EQ(WordCache::segment("  int foo = bar(baz);"),
+              (Segments{"  ", "int", " ", "foo", " ", "=", " ", "bar(baz);"}));
+    EXPECT_EQ(WordCache::segment("word"), (Segments{"word"}));
+    EXPECT_EQ(WordCache::segment("   "), (Segments{"   "}));
+    EXPECT_EQ(WordCache::segment(""), Segments{});
+}
+
+TEST(WordCacheTest, SegmentAtScriptChanges) {
+    EXPECT_EQ(WordCache::segment("日本語abc def"), (Segments{"日本語", "abc", " ", "def"}));
+    // Punctuation, digits and emoji take on the script of the text around them.
+    EXPECT_EQ(WordCache::segment("a.日本"), (Segments{"a.", "日本"}));
+    EXPECT_EQ(WordCache::segment("x2😄y"), (Segments{"x2😄y"}));
+}
+
+TEST(WordCacheTest, SegmentWholeLine) {
+    EXPECT_EQ(WordCache::segment("hello\tworld"), Segments{});
+    EXPECT_EQ(WordCache::segment("שלום abc"), Segments{});
+    EXPECT_EQ(WordCache::segment("abc \xFF"), Segments{});
+}
+
+TEST(WordCacheTest, LayoutLine) {
+    auto& rasterizer = FontRasterizer::instance();
+    // The system font is proportional, and its advances at an odd size are fractional, which would
+    // add up along the line if words were joined at rounded widths.
+    size_t font_id = rasterizer.add_system_font(13);
+    WordCache word_cache;
+
+    std::string_view str = "foo bar foo  bar";
+    auto layout = word_cache.layout_line(font_id, str, 2);
+    auto expected = rasterizer.layout_line(font_id, str, 2);
+    // "foo", "bar", " " and "  ".
+    EXPECT_EQ(word_cache.size(), 4_Z);
+
+    EXPECT_EQ(layout.layout_font_id, expected.layout_font_id);
+    EXPECT_EQ(layout.width, expected.width);
+    EXPECT_EQ(layout.length, expected.length);
+    ASSERT_EQ(layout.glyphs.size(), expected.glyphs.size());
+    for (size_t i = 0; i < layout.glyphs.size(); ++i) {
+        EXPECT_EQ(layout.glyphs[i].glyph_id, expected.glyphs[i].glyph_id);
+        EXPECT_EQ(layout.glyphs[i].index, expected.glyphs[i].index);
+        EXPECT_EQ(layout.glyphs[i].position.x, expected.glyphs[i].position.x);
+        EXPECT_EQ(layout.glyphs[i].x_phase, expected.glyphs[i].x_phase);
+        EXPECT_EQ(layout.glyphs[i].advance.x, expected.glyphs[i].advance.x);
+    }
+
+    // Only the edited word is shaped.
+    word_cache.layout_line(font_id, "foo baz foo  bar", 2);
+    EXPECT_EQ(word_cache.size(), 5_Z);
+}
+
+}  // namespace font
@@ -1,5 +1,7 @@
 #include "atlas.h"
 
+#include <cstring>
+
 using namespace opengl;
 
 // TODO: For debugging; remove this.
@@ -13,7 +15,7 @@ static_assert(!std::is_copy_assignable_v<Atlas>);
 static_assert(std::is_move_constructible_v<Atlas>);
 static_assert(std::is_move_assignable_v<Atlas>);
 
-Atlas::Atlas() {
+Atlas::Atlas(Kind kind) : page_kind{kind} {
     constexpr bool kPrintMaxTextureSize = false;
     if constexpr (kPrintMaxTextureSize) {
         GLint max_texture_size;
@@ -54,13 +56,19 @@ Atlas::Atlas() {
         data = atlas_background.data();
     }
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kAtlasSize, kAtlasSize, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                 data);
+    if (kind != Kind::kColor) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, kAtlasSize, kAtlasSize, 0, GL_RED, GL_UNSIGNED_BYTE,
+                     data);
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kAtlasSize, kAtlasSize, 0, GL_RGBA,
+                     GL_UNSIGNED_BYTE, data);
+    }
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GLint filter = kind == Kind::kDistanceField ? GL_LINEAR : GL_NEAREST;
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
 
     glBindTexture(GL_TEXTURE_2D, 0);  // Unbind.
 }
@@ -69,13 +77,16 @@ Atlas::~Atlas() {
     glDeleteTextures(1, &tex_id);
 }
 
-Atlas::Atlas(Atlas&& other) : tex_id(other.tex_id) {
+Atlas::Atlas(Atlas&& other)
+    : tex_id(other.tex_id), page_kind(other.page_kind), allocator(std::move(other.allocator)) {
     other.tex_id = 0;
 }
 
 Atlas& Atlas::operator=(Atlas&& other) {
     if (&other != this) {
         tex_id = other.tex_id;
+        page_kind = other.page_kind;
+        allocator = std::move(other.allocator);
         other.tex_id = 0;
     }
     return *this;
@@ -85,9 +96,34 @@ GLuint Atlas::tex() const {
     return tex_id;
 }
 
+Atlas::Kind Atlas::kind() const {
+    return page_kind;
+}
+
 // TODO: Consider refactoring this.
 namespace {
 
+size_t bytes_per_pixel(Atlas::Format format) {
+    switch (format) {
+    case Atlas::Format::kBGRA:
+    case Atlas::Format::kRGBA:
+        return 4;
+    case Atlas::Format::kRGB:
+        return 3;
+    case Atlas::Format::kR8:
+        return 1;
+    }
+}
+
+Vec4 rect_to_uv(const AtlasAllocator::Rect& rect) {
+    return {
+        static_cast<float>(rect.x) / Atlas::kAtlasSize,
+        static_cast<float>(rect.y) / Atlas::kAtlasSize,
+        static_cast<float>(rect.width) / Atlas::kAtlasSize,
+        static_cast<float>(rect.height) / Atlas::kAtlasSize,
+    };
+}
+
 GLenum format_to_glenum(Atlas::Format format) {
     switch (format) {
     case Atlas::Format::kBGRA:
@@ -96,72 +132,87 @@ GLenum format_to_glenum(Atlas::Format format) {
         return GL_RGBA;
     case Atlas::Format::kRGB:
         return GL_RGB;
+    case Atlas::Format::kR8:
+        return GL_RED;
     }
 }
 
 }  // namespace
 
 bool Atlas::insert_texture(
-    int width, int height, Format format, const std::vector<uint8_t>& data, Vec4& out_uv) {
+    int width, int height, Format format, std::span<const uint8_t> data, Vec4& out_uv) {
     if (width > kAtlasSize || height > kAtlasSize) {
         fmt::println("Glyph is too large.");
         return false;
     }
 
-    // If there's not enough room in current row, advance to the next one.
-    if (!room_in_row(width, height)) {
-        if (!advance_row()) {
-            fmt::println("Atlas is full.");
-            return false;
-        }
-
-        // If there's still not enough room, then atlas is full.
-        if (!room_in_row(width, height)) {
-            fmt::println("Could not insert into atlas.");
-            return false;
-        }
+    auto rect = allocator.allocate(width, height);
+    if (!rect) {
+        fmt::println("Atlas is full.");
+        return false;
     }
 
     // Load data into OpenGL.
     GLenum gl_format = format_to_glenum(format);
 
     glBindTexture(GL_TEXTURE_2D, tex_id);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, row_extent, row_baseline, width, height, gl_format,
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect->x, rect->y, width, height, gl_format,
                     GL_UNSIGNED_BYTE, data.data());
     glBindTexture(GL_TEXTURE_2D, 0);  // Unbind.
 
-    // Generate UV coordinates.
-    float uv_x = static_cast<float>(row_extent) / kAtlasSize;
-    float uv_y = static_cast<float>(row_baseline) / kAtlasSize;
-    float uv_width = static_cast<float>(width) / kAtlasSize;
-    float uv_height = static_cast<float>(height) / kAtlasSize;
-
-    // Update atlas state.
-    row_extent += width;
-    row_tallest = std::max(height, row_tallest);
-
-    out_uv = {uv_x, uv_y, uv_width, uv_height};
+    out_uv = rect_to_uv(*rect);
     return true;
 }
 
-bool Atlas::room_in_row(int width, int height) {
-    int next_extent = row_extent + width;
-    bool enough_width = next_extent <= kAtlasSize;
-    bool enough_height = height < (kAtlasSize - row_baseline);
-
-    return enough_width && enough_height;
-}
+size_t Atlas::insert_textures(std::span<const Texture> textures,
+                              Format format,
+                              std::span<Vec4> out_uvs) {
+    // Nothing was ever inserted below `band_top`, so the textures there can be copied into
+    // full-width rows and uploaded at once. The others fill gaps between earlier textures.
+    int band_top = allocator.used_height();
+    int band_bottom = band_top;
+    std::vector<AtlasAllocator::Rect> rects;
+    for (const auto& texture : textures) {
+        auto rect = allocator.allocate(texture.width, texture.height);
+        if (!rect) break;
+
+        out_uvs[rects.size()] = rect_to_uv(*rect);
+        rects.emplace_back(*rect);
+        if (rect->y >= band_top) {
+            band_bottom = std::max(rect->y + rect->height, band_bottom);
+        }
+    }
 
-bool Atlas::advance_row() {
-    int advance_to = row_baseline + row_tallest;
-    if (kAtlasSize - advance_to <= 0) {
-        return false;
+    size_t pixel_size = bytes_per_pixel(format);
+    GLenum gl_format = format_to_glenum(format);
+    glBindTexture(GL_TEXTURE_2D, tex_id);
+    if (band_bottom > band_top) {
+        size_t row_size = kAtlasSize * pixel_size;
+        std::vector<uint8_t> band(row_size * (band_bottom - band_top), 0);
+        for (size_t i = 0; i < rects.size(); ++i) {
+            const auto& rect = rects[i];
+            if (rect.y < band_top) continue;
+
+            size_t texture_row_size = rect.width * pixel_size;
+            size_t offset = (rect.y - band_top) * row_size + rect.x * pixel_size;
+            for (int y = 0; y < rect.height; ++y) {
+                std::memcpy(&band[offset + y * row_size], &textures[i].data[y * texture_row_size],
+                            texture_row_size);
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, band_top, kAtlasSize, band_bottom - band_top,
+                        gl_format, GL_UNSIGNED_BYTE, band.data());
     }
+    // These are uploaded after the band, since they may reach into it.
+    for (size_t i = 0; i < rects.size(); ++i) {
+        const auto& rect = rects[i];
+        if (rect.y >= band_top || rect.width <= 0 || rect.height <= 0) continue;
 
-    row_baseline = advance_to;
-    row_extent = 0;
-    row_tallest = 0;
-    return true;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, gl_format,
+                        GL_UNSIGNED_BYTE, textures[i].data.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);  // Unbind.
+    return rects.size();
 }
 
 }  // namespace gui
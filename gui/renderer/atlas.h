@@ -1,9 +1,11 @@
 #pragma once
 
+#include "gui/renderer/atlas_allocator.h"
 #include "gui/renderer/types.h"
 #include "opengl/gl.h"
 #include "util/non_copyable.h"
 
+#include <span>
 #include <vector>
 
 namespace gui {
@@ -19,33 +21,53 @@ public:
     // static constexpr int kAtlasSize = 4096;
     // static constexpr int kAtlasSize = 16384;
 
-    Atlas();
+    // Monochrome pages hold a single coverage channel, which takes a quarter of the memory and
+    // upload bandwidth of color pages. They are sampled as red.
+    // Distance field pages also hold a single channel, the distance to the glyph's outline. Unlike
+    // the other pages, they are filtered linearly, since their glyphs are drawn scaled.
+    enum class Kind {
+        kColor,
+        kMonochrome,
+        kDistanceField,
+    };
+
+    explicit Atlas(Kind kind = Kind::kColor);
     ~Atlas();
     Atlas(Atlas&& other);
     Atlas& operator=(Atlas&& other);
 
     GLuint tex() const;
+    Kind kind() const;
 
+    // `kR8` may only be inserted into single-channel pages, and the others into color pages.
     enum class Format {
         kBGRA,
         kRGBA,
         kRGB,
+        kR8,
     };
     bool insert_texture(
-        int width, int height, Format format, const std::vector<uint8_t>& data, Vec4& out_uv);
+        int width, int height, Format format, std::span<const uint8_t> data, Vec4& out_uv);
+    // Inserts several textures of the same format, e.g., glyphs loaded from disk. The textures
+    // that land below everything inserted so far are uploaded at once. Returns how many textures
+    // were inserted, in order, before the page filled up; their UV coordinates are written to
+    // `out_uvs`.
+    struct Texture {
+        int width;
+        int height;
+        std::span<const uint8_t> data;
+    };
+    size_t insert_textures(std::span<const Texture> textures,
+                           Format format,
+                           std::span<Vec4> out_uvs);
 
 private:
     GLuint tex_id = 0;
-
-    int row_extent = 0;
-    int row_baseline = 0;
-    int row_tallest = 0;
+    Kind page_kind;
+    AtlasAllocator allocator{kAtlasSize};
 
     // DEBUG: Color atlas background to spot incorrect shaders easier.
     std::vector<uint8_t> atlas_background;
-
-    bool room_in_row(int width, int height);
-    bool advance_row();
 };
 
 }  // namespace gui
@@ -0,0 +1,271 @@
+#include "atlas_allocator.h"
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+namespace gui {
+
+namespace {
+
+bool IsEmpty(const AtlasAllocator::Rect& rect) {
+    return rect.width <= 0 || rect.height <= 0;
+}
+
+}  // namespace
+
+AtlasAllocator::AtlasAllocator(int size) : size{size}, skyline{{0, 0, size}} {}
+
+std::optional<AtlasAllocator::Rect> AtlasAllocator::allocate(int width, int height) {
+    if (width <= 0 || height <= 0) return Rect{0, 0, std::max(width, 0), std::max(height, 0)};
+    if (width > size || height > size) return std::nullopt;
+
+    auto rect = allocate_free(width, height);
+    if (!rect) rect = allocate_skyline(width, height);
+    if (rect) area += static_cast<size_t>(width) * height;
+    return rect;
+}
+
+void AtlasAllocator::deallocate(const Rect& rect) {
+    if (IsEmpty(rect)) return;
+    area -= static_cast<size_t>(rect.width) * rect.height;
+
+    // A page that is empty again starts over, without any of its fragmentation.
+    if (area == 0) {
+        skyline = {{0, 0, size}};
+        free_by_bottom.clear();
+        free_by_top.clear();
+        free_by_size.clear();
+        return;
+    }
+
+    // Free space right on the skyline lowers it, so that taller rectangles fit there again. Then
+    // the free rectangles right above the lowered columns may be on the skyline in turn.
+    Rect freed = add_free_rect(rect);
+    erase_free_rect(freed);
+    std::vector<Rect> lowered;
+    lower_skyline(freed, lowered);
+    while (!lowered.empty()) {
+        Rect below = lowered.back();
+        lowered.pop_back();
+        // Free rectangles with the same bottom edge don't overlap, so only the last one that
+        // starts left of `below` can reach into its columns.
+        auto first = free_by_bottom.lower_bound({below.y, below.x});
+        if (first != free_by_bottom.begin() && std::prev(first)->first.first == below.y) {
+            --first;
+        }
+        std::vector<Rect> above;
+        for (auto it = first; it != free_by_bottom.end() && it->first.first == below.y &&
+                              it->second.x < below.x + below.width;
+             ++it) {
+            if (below.x < it->second.x + it->second.width) above.emplace_back(it->second);
+        }
+        for (const Rect& free_rect : above) {
+            erase_free_rect(free_rect);
+            lower_skyline(free_rect, lowered);
+        }
+    }
+}
+
+size_t AtlasAllocator::allocated_area() const {
+    return area;
+}
+
+int AtlasAllocator::used_height() const {
+    return std::ranges::max(skyline, {}, &Segment::y).y;
+}
+
+std::optional<AtlasAllocator::Rect> AtlasAllocator::allocate_free(int width, int height) {
+    // The smallest free rectangle that fits leaves the larger ones for larger glyphs. For each
+    // height, the narrowest one that is wide enough is the smallest of that height.
+    constexpr int kMin = std::numeric_limits<int>::min();
+    std::optional<Rect> best;
+    size_t best_area = 0;
+    auto it = free_by_size.lower_bound({height, width, kMin, kMin});
+    while (it != free_by_size.end()) {
+        auto [rect_height, rect_width, y, x] = *it;
+        // Taller rectangles can't be smaller anymore.
+        if (best && static_cast<size_t>(rect_height) * width >= best_area) break;
+        if (rect_width < width) {
+            it = free_by_size.lower_bound({rect_height, width, kMin, kMin});
+            continue;
+        }
+        size_t rect_area = static_cast<size_t>(rect_width) * rect_height;
+        if (!best || rect_area < best_area) {
+            best = Rect{x, y, rect_width, rect_height};
+            best_area = rect_area;
+        }
+        it = free_by_size.lower_bound({rect_height + 1, width, kMin, kMin});
+    }
+    if (!best) return std::nullopt;
+
+    Rect free_rect = *best;
+    erase_free_rect(free_rect);
+
+    // Split the rest along the shorter side, which keeps the larger piece as large as possible.
+    int right_width = free_rect.width - width;
+    int bottom_height = free_rect.height - height;
+    Rect right = {free_rect.x + width, free_rect.y, right_width, height};
+    Rect bottom = {free_rect.x, free_rect.y + height, width, bottom_height};
+    if (right_width > bottom_height) {
+        right.height = free_rect.height;
+    } else {
+        bottom.width = free_rect.width;
+    }
+    if (!IsEmpty(right)) insert_free_rect(right);
+    if (!IsEmpty(bottom)) insert_free_rect(bottom);
+    return Rect{free_rect.x, free_rect.y, width, height};
+}
+
+std::optional<AtlasAllocator::Rect> AtlasAllocator::allocate_skyline(int width, int height) {
+    // Place the rectangle where its bottom is highest, and leftmost among those.
+    size_t best_index = 0;
+    int best_y = 0;
+    int best_bottom = std::numeric_limits<int>::max();
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        int x = skyline[i].x;
+        if (x + width > size) break;
+
+        int y = 0;
+        for (size_t j = i; j < skyline.size() && skyline[j].x < x + width; ++j) {
+            y = std::max(skyline[j].y, y);
+        }
+        if (y + height <= size && y + height < best_bottom) {
+            best_index = i;
+            best_y = y;
+            best_bottom = y + height;
+        }
+    }
+    if (best_bottom == std::numeric_limits<int>::max()) return std::nullopt;
+
+    Rect rect = {skyline[best_index].x, best_y, width, height};
+    size_t first = best_index;
+    size_t last = split_skyline(rect.x + width);
+    // The gaps between the skyline and the rectangle are left for smaller glyphs.
+    for (size_t i = first; i < last; ++i) {
+        const auto& segment = skyline[i];
+        Rect gap = {segment.x, segment.y, segment.width, best_y - segment.y};
+        if (!IsEmpty(gap)) add_free_rect(gap);
+    }
+    skyline.erase(skyline.begin() + first + 1, skyline.begin() + last);
+    skyline[first] = {rect.x, best_bottom, width};
+    merge_skyline();
+    return rect;
+}
+
+size_t AtlasAllocator::find_skyline(int x) const {
+    auto it = std::ranges::upper_bound(skyline, x, {}, &Segment::x);
+    return std::distance(skyline.begin(), it) - 1;
+}
+
+size_t AtlasAllocator::split_skyline(int x) {
+    if (x >= size) return skyline.size();
+
+    size_t i = find_skyline(x);
+    Segment& segment = skyline[i];
+    if (segment.x == x) return i;
+
+    Segment right = {x, segment.y, segment.x + segment.width - x};
+    segment.width = x - segment.x;
+    skyline.insert(skyline.begin() + i + 1, right);
+    return i + 1;
+}
+
+void AtlasAllocator::lower_skyline(const Rect& rect, std::vector<Rect>& lowered) {
+    // Split `rect` into runs of columns that are right on the skyline, and runs that aren't.
+    int bottom = rect.y + rect.height;
+    int right = rect.x + rect.width;
+    std::vector<Rect> on_skyline;
+    std::vector<Rect> off_skyline;
+    for (size_t i = find_skyline(rect.x); i < skyline.size() && skyline[i].x < right; ++i) {
+        const Segment& segment = skyline[i];
+        int x = std::max(segment.x, rect.x);
+        int width = std::min(segment.x + segment.width, right) - x;
+        auto& pieces = segment.y == bottom ? on_skyline : off_skyline;
+        if (!pieces.empty() && pieces.back().x + pieces.back().width == x) {
+            pieces.back().width += width;
+        } else {
+            pieces.push_back({x, rect.y, width, rect.height});
+        }
+    }
+
+    for (const Rect& piece : on_skyline) {
+        size_t first = split_skyline(piece.x);
+        size_t last = split_skyline(piece.x + piece.width);
+        for (size_t i = first; i < last; ++i) {
+            skyline[i].y = piece.y;
+        }
+        lowered.emplace_back(piece);
+    }
+    if (!on_skyline.empty()) merge_skyline();
+    for (const Rect& piece : off_skyline) {
+        add_free_rect(piece);
+    }
+}
+
+void AtlasAllocator::merge_skyline() {
+    size_t last = 0;
+    for (size_t i = 1; i < skyline.size(); ++i) {
+        if (skyline[i].y == skyline[last].y) {
+            skyline[last].width += skyline[i].width;
+        } else {
+            skyline[++last] = skyline[i];
+        }
+    }
+    skyline.resize(last + 1);
+}
+
+AtlasAllocator::Rect AtlasAllocator::add_free_rect(Rect rect) {
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        int bottom = rect.y + rect.height;
+        int right = rect.x + rect.width;
+        std::optional<Rect> neighbor;
+        // Above and below, in the same columns.
+        if (auto it = free_by_bottom.find({rect.y, rect.x});
+            it != free_by_bottom.end() && it->second.width == rect.width) {
+            neighbor = it->second;
+            rect.y = neighbor->y;
+        } else if (auto it = free_by_top.find({bottom, rect.x});
+                   it != free_by_top.end() && it->second.width == rect.width) {
+            neighbor = it->second;
+        }
+        if (neighbor) {
+            rect.height += neighbor->height;
+        } else {
+            // Left and right, in the same rows.
+            if (auto it = free_by_bottom.lower_bound({bottom, rect.x});
+                it != free_by_bottom.begin() && std::prev(it)->first.first == bottom &&
+                std::prev(it)->second.y == rect.y &&
+                std::prev(it)->second.x + std::prev(it)->second.width == rect.x) {
+                neighbor = std::prev(it)->second;
+                rect.x = neighbor->x;
+            } else if (auto it = free_by_bottom.find({bottom, right});
+                       it != free_by_bottom.end() && it->second.y == rect.y) {
+                neighbor = it->second;
+            }
+            if (neighbor) rect.width += neighbor->width;
+        }
+        if (neighbor) {
+            erase_free_rect(*neighbor);
+            merged = true;
+        }
+    }
+    insert_free_rect(rect);
+    return rect;
+}
+
+void AtlasAllocator::insert_free_rect(const Rect& rect) {
+    free_by_bottom.emplace(std::pair{rect.y + rect.height, rect.x}, rect);
+    free_by_top.emplace(std::pair{rect.y, rect.x}, rect);
+    free_by_size.emplace(rect.height, rect.width, rect.y, rect.x);
+}
+
+void AtlasAllocator::erase_free_rect(const Rect& rect) {
+    free_by_bottom.erase({rect.y + rect.height, rect.x});
+    free_by_top.erase({rect.y, rect.x});
+    free_by_size.erase({rect.height, rect.width, rect.y, rect.x});
+}
+
+}  // namespace gui
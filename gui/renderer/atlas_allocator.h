@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <optional>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace gui {
+
+// Allocates rectangles in a square texture atlas page. New rectangles are placed on a skyline, the
+// height that each column of the page is used up to, as high as they fit. Unlike rows of the
+// tallest glyph, this leaves no space below short glyphs. The gaps that are left under a
+// rectangle, and rectangles that are freed, are kept in a free list and reused first.
+class AtlasAllocator {
+public:
+    explicit AtlasAllocator(int size);
+
+    struct Rect {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+    // Returns nothing if the page has no room for the rectangle. Empty rectangles take no space.
+    std::optional<Rect> allocate(int width, int height);
+    // Frees a rectangle returned by `allocate()`, so that it can be reused.
+    void deallocate(const Rect& rect);
+
+    // The area of the rectangles that are allocated.
+    size_t allocated_area() const;
+    // Everything at or below this row is unused, and was never allocated.
+    int used_height() const;
+
+private:
+    // The columns from `x` to `x + width` are used from the top of the page down to `y`.
+    struct Segment {
+        int x;
+        int y;
+        int width;
+    };
+
+    int size;
+    // Sorted by `x` and covering the width of the page.
+    std::vector<Segment> skyline;
+    // The free rectangles, by their bottom edge and by their top edge, then their left edge, to
+    // find their neighbors, and by their size, to find the best fit. Free rectangles don't
+    // overlap, so every key is unique.
+    std::map<std::pair<int, int>, Rect> free_by_bottom;
+    std::map<std::pair<int, int>, Rect> free_by_top;
+    std::set<std::tuple<int, int, int, int>> free_by_size;
+    size_t area = 0;
+
+    std::optional<Rect> allocate_free(int width, int height);
+    std::optional<Rect> allocate_skyline(int width, int height);
+    // Returns the index of the segment that contains column `x`.
+    size_t find_skyline(int x) const;
+    // Returns the index of the segment that starts at `x`, splitting the segment around it.
+    size_t split_skyline(int x);
+    // Lowers the skyline to the top of the free `rect` in the columns where `rect` is right on
+    // it, and appends those parts of `rect` to `lowered`. The parts in the other columns go back
+    // to the free list, so that L-shaped free space returns to the skyline piece by piece.
+    void lower_skyline(const Rect& rect, std::vector<Rect>& lowered);
+    void merge_skyline();
+    // Adds `rect` to the free list, merged with the free rectangles that share an edge with it,
+    // and returns the merged rectangle.
+    Rect add_free_rect(Rect rect);
+    void insert_free_rect(const Rect& rect);
+    void erase_free_rect(const Rect& rect);
+};
+
+}  // namespace gui
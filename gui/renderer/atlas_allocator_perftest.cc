@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "gui/renderer/atlas_allocator.h"
+
+#include <chrono>
+#include <fmt/base.h>
+#include <random>
+#include <vector>
+
+namespace gui {
+
+namespace {
+
+// The size of the GUI's atlas pages, `Atlas::kAtlasSize`.
+constexpr int kAtlasSize = 2048;
+
+// The range of glyph bitmap sizes of a script at 2x, with a 14pt font.
+struct GlyphSizes {
+    const char* name;
+    int min_width;
+    int max_width;
+    int min_height;
+    int max_height;
+};
+
+// Latin glyphs are narrow and vary in height, from dots to descenders. CJK ideographs fill most
+// of the em square, and emoji fill all of it.
+constexpr GlyphSizes kLatin = {"Latin", 4, 24, 4, 38};
+constexpr GlyphSizes kCJK = {"CJK", 26, 36, 24, 36};
+constexpr GlyphSizes kEmoji = {"emoji", 36, 40, 36, 40};
+
+}  // namespace
+
+// Fills atlas pages with glyphs of a script, and reports the fraction of each page that they
+// cover. Then frees half of them, like evicting unused glyphs, and fills the pages again.
+TEST(AtlasAllocatorTest, PackingEfficiency) {
+    constexpr int kPages = 4;
+    constexpr double kPageArea = static_cast<double>(kAtlasSize) * kAtlasSize;
+
+    for (const auto& sizes : {kLatin, kCJK, kEmoji}) {
+        std::mt19937 rng{42};
+        std::uniform_int_distribution<> width{sizes.min_width, sizes.max_width};
+        std::uniform_int_distribution<> height{sizes.min_height, sizes.max_height};
+
+        auto t1 = std::chrono::steady_clock::now();
+        size_t glyph_count = 0;
+        for (int page = 0; page < kPages; ++page) {
+            AtlasAllocator allocator{kAtlasSize};
+            std::vector<AtlasAllocator::Rect> rects;
+            // The page is full once a glyph doesn't fit.
+            while (auto rect = allocator.allocate(width(rng), height(rng))) {
+                rects.emplace_back(*rect);
+            }
+            double fill = allocator.allocated_area() / kPageArea;
+            glyph_count += rects.size();
+
+            for (size_t i = 0; i < rects.size(); i += 2) {
+                allocator.deallocate(rects[i]);
+            }
+            while (allocator.allocate(width(rng), height(rng))) {
+                ++glyph_count;
+            }
+            double refill = allocator.allocated_area() / kPageArea;
+            fmt::println("{} page {}: {:.1f}% filled, {:.1f}% after freeing half and refilling",
+                         sizes.name, page, fill * 100, refill * 100);
+            EXPECT_GT(fill, 0.8);
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        double micros = std::chrono::duration<double, std::micro>(t2 - t1).count();
+        fmt::println("{}: {:.2f} us/glyph", sizes.name, micros / glyph_count);
+    }
+}
+
+}  // namespace gui
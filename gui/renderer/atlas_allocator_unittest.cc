@@ -0,0 +1,187 @@
+#include <gtest/gtest.h>
+
+#include "base/numeric/literals.h"
+#include "gui/renderer/atlas_allocator.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace gui {
+
+namespace {
+
+bool Overlap(const AtlasAllocator::Rect& a, const AtlasAllocator::Rect& b) {
+    return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height &&
+           b.y < a.y + a.height;
+}
+
+// Checks that the rectangles are inside the page and don't overlap.
+void ExpectDisjoint(const std::vector<AtlasAllocator::Rect>& rects, int size) {
+    for (size_t i = 0; i < rects.size(); ++i) {
+        const auto& rect = rects[i];
+        EXPECT_GE(rect.x, 0);
+        EXPECT_GE(rect.y, 0);
+        EXPECT_LE(rect.x + rect.width, size);
+        EXPECT_LE(rect.y + rect.height, size);
+        for (size_t j = i + 1; j < rects.size(); ++j) {
+            EXPECT_FALSE(Overlap(rect, rects[j])) << i << " and " << j;
+        }
+    }
+}
+
+}  // namespace
+
+TEST(AtlasAllocatorTest, FillsPage) {
+    AtlasAllocator allocator{64};
+    std::vector<AtlasAllocator::Rect> rects;
+    // 16 squares fill the page exactly.
+    for (int i = 0; i < 16; ++i) {
+        auto rect = allocator.allocate(16, 16);
+        ASSERT_TRUE(rect);
+        rects.emplace_back(*rect);
+    }
+    EXPECT_FALSE(allocator.allocate(1, 1));
+    EXPECT_EQ(allocator.allocated_area(), 64_Z * 64);
+    ExpectDisjoint(rects, 64);
+
+    EXPECT_FALSE(allocator.allocate(65, 1));
+    // Empty rectangles take no space.
+    auto empty = allocator.allocate(0, 10);
+    ASSERT_TRUE(empty);
+    EXPECT_EQ(empty->width, 0);
+}
+
+// Short rectangles don't reserve the height of the tallest one beside them.
+TEST(AtlasAllocatorTest, NoSpaceBelowShortRectangles) {
+    AtlasAllocator allocator{64};
+    auto tall = allocator.allocate(32, 64);
+    auto short_1 = allocator.allocate(32, 16);
+    auto short_2 = allocator.allocate(32, 48);
+    ASSERT_TRUE(tall && short_1 && short_2);
+    EXPECT_EQ(short_2->x, short_1->x);
+    EXPECT_EQ(short_2->y, 16);
+    EXPECT_EQ(allocator.used_height(), 64);
+    ExpectDisjoint({*tall, *short_1, *short_2}, 64);
+}
+
+TEST(AtlasAllocatorTest, ReusesFreedSpace) {
+    AtlasAllocator allocator{64};
+    std::vector<AtlasAllocator::Rect> rects;
+    for (int i = 0; i < 16; ++i) {
+        rects.emplace_back(*allocator.allocate(16, 16));
+    }
+
+    // Two freed neighbors merge, and fit a rectangle that spans both.
+    allocator.deallocate(rects[5]);
+    allocator.deallocate(rects[6]);
+    EXPECT_EQ(allocator.allocated_area(), 64_Z * 64 - 2 * 16 * 16);
+    auto wide = allocator.allocate(32, 16);
+    ASSERT_TRUE(wide);
+    rects.erase(rects.begin() + 5, rects.begin() + 7);
+    rects.emplace_back(*wide);
+    ExpectDisjoint(rects, 64);
+
+    // Freeing the whole page makes room for a rectangle of its size.
+    for (const auto& rect : rects) {
+        allocator.deallocate(rect);
+    }
+    EXPECT_EQ(allocator.allocated_area(), 0_Z);
+    EXPECT_TRUE(allocator.allocate(64, 64));
+}
+
+// Gaps of any size are reused, e.g., the thin strip beside a short rectangle.
+TEST(AtlasAllocatorTest, ReusesThinGaps) {
+    AtlasAllocator allocator{64};
+    auto thin = allocator.allocate(32, 2);
+    auto wide = allocator.allocate(64, 8);
+    ASSERT_TRUE(thin && wide);
+    EXPECT_EQ(wide->y, 2);
+
+    auto gap = allocator.allocate(32, 2);
+    ASSERT_TRUE(gap);
+    EXPECT_EQ(gap->x, 32);
+    EXPECT_EQ(gap->y, 0);
+    EXPECT_EQ(allocator.used_height(), 10);
+}
+
+// Filling a page with random sizes, and freeing it in random order, doesn't leak space over many
+// cycles.
+TEST(AtlasAllocatorTest, ChurnDoesNotLeakSpace) {
+    constexpr int kSize = 256;
+    AtlasAllocator allocator{kSize};
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<> dimension{1, 24};
+    auto fill = [&](std::vector<AtlasAllocator::Rect>& rects) {
+        while (auto rect = allocator.allocate(dimension(rng), dimension(rng))) {
+            rects.emplace_back(*rect);
+        }
+    };
+
+    for (int cycle = 0; cycle < 8; ++cycle) {
+        std::vector<AtlasAllocator::Rect> rects;
+        fill(rects);
+        // Fragment the free space by freeing half of the rectangles and filling the page again.
+        for (int round = 0; round < 3; ++round) {
+            std::shuffle(rects.begin(), rects.end(), rng);
+            for (size_t i = rects.size() / 2; i < rects.size(); ++i) {
+                allocator.deallocate(rects[i]);
+            }
+            rects.resize(rects.size() / 2);
+            fill(rects);
+        }
+        ExpectDisjoint(rects, kSize);
+
+        // With one rectangle left, the rest of the page is back on the skyline, so everything
+        // below that rectangle fits a rectangle as wide as the page.
+        std::shuffle(rects.begin(), rects.end(), rng);
+        AtlasAllocator::Rect kept = rects.back();
+        rects.pop_back();
+        for (const auto& rect : rects) {
+            allocator.deallocate(rect);
+        }
+        int kept_bottom = kept.y + kept.height;
+        EXPECT_EQ(allocator.allocated_area(), static_cast<size_t>(kept.width) * kept.height);
+        EXPECT_EQ(allocator.used_height(), kept_bottom);
+        if (kept_bottom < kSize) {
+            auto below = allocator.allocate(kSize, kSize - kept_bottom);
+            ASSERT_TRUE(below);
+            allocator.deallocate(*below);
+        }
+
+        // A fully freed page fits a rectangle of its size.
+        allocator.deallocate(kept);
+        EXPECT_EQ(allocator.allocated_area(), 0_Z);
+        EXPECT_EQ(allocator.used_height(), 0);
+        auto page = allocator.allocate(kSize, kSize);
+        ASSERT_TRUE(page);
+        allocator.deallocate(*page);
+    }
+}
+
+TEST(AtlasAllocatorTest, RandomSizes) {
+    constexpr int kSize = 256;
+    AtlasAllocator allocator{kSize};
+    std::mt19937 rng{42};
+    std::uniform_int_distribution<> dimension{1, 24};
+    std::vector<AtlasAllocator::Rect> rects;
+    for (int round = 0; round < 4; ++round) {
+        while (auto rect = allocator.allocate(dimension(rng), dimension(rng))) {
+            rects.emplace_back(*rect);
+        }
+        ExpectDisjoint(rects, kSize);
+
+        // Free every other rectangle, and fill the page again.
+        std::vector<AtlasAllocator::Rect> kept;
+        for (size_t i = 0; i < rects.size(); ++i) {
+            if (i % 2 == 0) {
+                allocator.deallocate(rects[i]);
+            } else {
+                kept.emplace_back(rects[i]);
+            }
+        }
+        rects = std::move(kept);
+    }
+}
+
+}  // namespace gui
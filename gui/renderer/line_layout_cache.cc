@@ -5,20 +5,24 @@
 
 namespace gui {
 
-const font::LineLayout& LineLayoutCache::get(size_t font_id, std::string_view str8) {
-    uint64_t str_hash = base::hash_string(str8);
-    if (auto it = cache.find(str_hash); it != cache.end()) {
+const font::LineLayout& LineLayoutCache::get(size_t font_id, std::string_view str8, int scale) {
+    // Layouts are kept for every scale, so that moving the window between displays doesn't lay
+    // out its lines again when it moves back.
+    scale = font::FontRasterizer::clamp_scale(scale);
+    uint64_t hash = base::hash_combine(base::hash_string(str8), font_id);
+    hash = base::hash_combine(hash, scale);
+    if (auto it = cache.find(hash); it != cache.end()) {
         return it->second;
     } else {
-        auto& font_rasterizer = font::FontRasterizer::instance();
-        auto layout = font_rasterizer.layout_line(font_id, str8);
-        auto inserted = cache.emplace(str_hash, std::move(layout));
+        auto layout = word_cache.layout_line(font_id, str8, scale);
+        auto inserted = cache.emplace(hash, std::move(layout));
         return inserted.first->second;
     }
 }
 
 void LineLayoutCache::clear() {
     cache.clear();
+    word_cache.clear();
 }
 
 }  // namespace gui
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "font/types.h"
+#include "font/word_cache.h"
 
 #include "third_party/hash_maps/robin_hood.h"
 
@@ -10,7 +11,7 @@ namespace gui {
 
 class LineLayoutCache {
 public:
-    const font::LineLayout& get(size_t font_id, std::string_view str8);
+    const font::LineLayout& get(size_t font_id, std::string_view str8, int scale);
 
     // TODO: Refactor this.
     void clear();
@@ -18,6 +19,8 @@ public:
 private:
     // We use a node-based map since we need to keep references stable.
     robin_hood::unordered_node_map<uint64_t, font::LineLayout> cache;
+    // Lines that miss the cache above are assembled from shaped words.
+    font::WordCache word_cache;
 };
 
 }  // namespace gui
@@ -44,6 +44,14 @@ SelectionRenderer& Renderer::getSelectionRenderer() {
     return selection_renderer;
 }
 
+void Renderer::set_scale(int scale) {
+    current_scale = font::FontRasterizer::clamp_scale(scale);
+}
+
+int Renderer::scale() const {
+    return current_scale;
+}
+
 void Renderer::flush(const Size& size) {
     glViewport(0, 0, size.width, size.height);
     glClear(GL_COLOR_BUFFER_BIT);
@@ -18,6 +18,12 @@ public:
     RectRenderer& getRectRenderer();
     SelectionRenderer& getSelectionRenderer();
 
+    // The display scale of the window being laid out or drawn. Windows set this before they lay
+    // out or draw their widgets, which measure and lay out text at this scale. Until then, this is
+    // the 2x that the UI's fixed sizes assume.
+    void set_scale(int scale);
+    int scale() const;
+
     void flush(const Size& size);
 
 private:
@@ -29,6 +35,8 @@ private:
     TextureRenderer texture_renderer;
     RectRenderer rect_renderer;
     SelectionRenderer selection_renderer;
+
+    int current_scale = 2;
 };
 
 }  // namespace gui
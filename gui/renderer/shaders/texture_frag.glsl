@@ -11,6 +11,11 @@ layout(location = 0, index = 0) out vec3 color;
 layout(location = 0, index = 1) out vec3 alpha_mask;
 
 uniform sampler2D mask;
+// Monochrome atlas pages only hold coverage, in the red channel.
+uniform bool monochrome;
+// Distance field atlas pages hold the distance to the glyph's outline in the red channel, with the
+// outline at 0.5.
+uniform bool distance_field;
 
 const int kPlainTexture = 0;
 const int kColoredText = 1;
@@ -20,6 +25,14 @@ void main() {
     vec4 texel = texture(mask, tex_coords);
     int kind = int(tex_color.a);
 
+    if (distance_field) {
+        // Antialias over about a pixel on screen, whatever the glyph is scaled to. The edge must
+        // not be empty where the distance is flat.
+        float edge = max(fwidth(texel.r) * 0.5, 1.0 / 255.0);
+        texel = vec4(smoothstep(0.5 - edge, 0.5 + edge, texel.r));
+    } else if (monochrome) {
+        texel = vec4(texel.r);
+    }
     alpha_mask = vec3(texel.a);
 
     // Plain texture. Color the texture using the input color.
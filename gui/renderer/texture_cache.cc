@@ -5,6 +5,10 @@
 
 #include "base/files/file_util.h"
 #include "base/files/scoped_file.h"
+#include "font/distance_field.h"
+
+#include <algorithm>
+#include <cmath>
 
 // TODO: Debug use; remove this.
 #include <fmt/base.h>
@@ -16,21 +20,385 @@ static_assert(!std::is_copy_assignable_v<TextureCache>);
 static_assert(std::is_move_constructible_v<TextureCache>);
 static_assert(std::is_move_assignable_v<TextureCache>);
 
-TextureCache::TextureCache() {
-    atlas_pages.emplace_back();
+namespace {
+
+// Rasterizing runs in parallel, but a line's missing glyphs are one batch, and few frames miss
+// more lines than this.
+constexpr size_t kMaxRasterizerThreads = 4;
+
+// Distance fields are rasterized from glyphs at this size and display scale 1. It is large enough
+// to keep corners sharp when zoomed in. The fields reach `kDistanceFieldSpread` pixels past the
+// outline, which is enough to antialias when scaled down.
+constexpr int kDistanceFieldFontSize = 48;
+constexpr int kDistanceFieldSpread = 6;
+
+// Bounds the copies of plain glyphs kept for the glyph disk cache. This holds thousands of text
+// glyphs, far more than are drawn at startup.
+constexpr size_t kMaxSavedBitmapBytes = 4 * 1024 * 1024;
+
+// Identifies the font in the glyph disk cache, where font IDs from past launches don't apply.
+uint64_t DiskCacheFontKey(size_t font_id) {
+    const auto& rasterizer = font::FontRasterizer::instance();
+    // The font size is the same at every scale.
+    return font::GlyphDiskCache::font_key(rasterizer.postscript_name(font_id),
+                                          rasterizer.metrics(font_id, 1).font_size,
+                                          rasterizer.file_key(font_id));
+}
+
+// The number of `Atlas::Kind`s.
+constexpr size_t kPageKinds = 3;
+
+// Returns the size in bytes of the glyph's bitmap in its atlas page.
+size_t PageBitmapSize(const font::RasterizedGlyph& rglyph) {
+    size_t channels = rglyph.colored ? 4 : 1;
+    return std::max(rglyph.width * rglyph.height, 0) * channels;
+}
+
+// Appends the glyph's BGRA bitmap, with rows `stride` bytes apart, to `out` in the format of its
+// atlas page. Plain glyphs are drawn in white with premultiplied alpha, so any channel holds the
+// coverage.
+void AppendPageBitmap(const font::RasterizedGlyph& rglyph,
+                      std::span<const uint8_t> bgra,
+                      size_t stride,
+                      std::vector<uint8_t>& out) {
+    size_t offset = out.size();
+    out.resize(offset + PageBitmapSize(rglyph));
+    uint8_t* dest = out.data() + offset;
+    for (int y = 0; y < rglyph.height && rglyph.width > 0; ++y) {
+        const uint8_t* row = &bgra[y * stride];
+        if (rglyph.colored) {
+            dest = std::copy_n(row, rglyph.width * 4, dest);
+        } else {
+            for (int x = 0; x < rglyph.width; ++x) {
+                *dest++ = row[x * 4 + 3];
+            }
+        }
+    }
+}
+
+// Glyphs of every scale and subpixel phase share a font's cache.
+uint64_t GlyphKey(uint32_t glyph_id, int scale, int x_phase) {
+    return static_cast<uint64_t>(scale) << 40 | static_cast<uint64_t>(x_phase) << 32 | glyph_id;
+}
+
+// Glyphs scaled from distance fields have no subpixel phase, and are told apart from rasterized
+// glyphs in the same cache by bit 48.
+uint64_t DistanceFieldKey(uint32_t glyph_id, int scale) {
+    return uint64_t{1} << 48 | GlyphKey(glyph_id, scale, 0);
+}
+
+}  // namespace
+
+TextureCache::TextureCache()
+    : upload_queue{std::make_shared<UploadQueue>()},
+      rasterizer_pool{std::make_unique<base::ThreadPool>(
+          std::min(base::ThreadPool::DefaultThreadCount(), kMaxRasterizerThreads))} {
+    atlas_pages.emplace_back(Atlas::Kind::kColor);
+    atlas_pages.emplace_back(Atlas::Kind::kMonochrome);
+}
+
+const TextureCache::Glyph* TextureCache::find_glyph(size_t font_id,
+                                                    uint32_t glyph_id,
+                                                    int scale,
+                                                    int x_phase) {
+    if (use_distance_fields) {
+        const Glyph* field = find_distance_field(font_id, glyph_id);
+        if (!field) return nullptr;
+        if (!field->colored) return &scale_distance_field(font_id, glyph_id, scale, *field);
+    }
+
+    if (font_id < cache.size()) {
+        auto it = cache[font_id].find(GlyphKey(glyph_id, scale, x_phase));
+        if (it != cache[font_id].end()) {
+            ++subpixel_phase_stats[x_phase].hits;
+            return &it->second;
+        }
+    }
+    ++subpixel_phase_stats[x_phase].misses;
+    request_glyph(font_id, glyph_id, scale, x_phase);
+    return nullptr;
+}
+
+void TextureCache::prefetch(const font::LineLayout& layout) {
+    for (const auto& glyph : layout.glyphs) {
+        if (use_distance_fields) {
+            const Glyph* field = find_distance_field(glyph.font_id, glyph.glyph_id);
+            if (!field || !field->colored) continue;
+        }
+
+        uint64_t key = GlyphKey(glyph.glyph_id, layout.scale, glyph.x_phase);
+        if (glyph.font_id < cache.size() && cache[glyph.font_id].contains(key)) {
+            continue;
+        }
+        request_glyph(glyph.font_id, glyph.glyph_id, layout.scale, glyph.x_phase);
+    }
+    post_requests();
+}
+
+bool TextureCache::upload_ready_glyphs() {
+    // Requests that the caller didn't post are posted now, so that they're ready in a later frame.
+    post_requests();
+
+    {
+        std::lock_guard lock{upload_queue->mutex};
+        uploading_glyphs.swap(upload_queue->glyphs);
+        uploading_staging.swap(upload_queue->staging);
+    }
+
+    // Glyphs are inserted by the kind of page that they go in, so that those that land in the
+    // same page are uploaded together.
+    std::array<std::vector<const ReadyGlyph*>, kPageKinds> inserting;
+    for (const auto& ready : uploading_glyphs) {
+        const auto& [font_id, glyph_id, scale, x_phase, rglyph, staging_offset, distance_field] =
+            ready;
+        uint64_t key = distance_field ? DistanceFieldKey(glyph_id, scale)
+                                      : GlyphKey(glyph_id, scale, x_phase);
+        requested[font_id].erase(key);
+        --requested_count;
+
+        if (distance_field) {
+            if (distance_fields.size() <= font_id) {
+                distance_fields.resize(font_id + 1);
+            }
+            if (rglyph.colored) {
+                distance_fields[font_id].emplace(glyph_id, Glyph{.colored = true});
+            } else {
+                inserting[static_cast<size_t>(Atlas::Kind::kDistanceField)].emplace_back(&ready);
+            }
+            continue;
+        }
+
+        // The glyph may have been preloaded by `load_glyph_cache()` in the meantime.
+        if (cache.size() <= font_id) {
+            cache.resize(font_id + 1);
+        }
+        if (!cache[font_id].contains(key)) {
+            auto kind = rglyph.colored ? Atlas::Kind::kColor : Atlas::Kind::kMonochrome;
+            inserting[static_cast<size_t>(kind)].emplace_back(&ready);
+        }
+    }
+
+    std::vector<Atlas::Texture> textures;
+    for (size_t kind = 0; kind < kPageKinds; ++kind) {
+        textures.clear();
+        for (const ReadyGlyph* ready : inserting[kind]) {
+            const auto& rglyph = ready->rglyph;
+            auto bitmap = std::span{uploading_staging}.subspan(ready->staging_offset,
+                                                               PageBitmapSize(rglyph));
+            textures.push_back({rglyph.width, rglyph.height, bitmap});
+        }
+        auto locations = insert_into_atlas(static_cast<Atlas::Kind>(kind), textures);
+
+        for (size_t i = 0; i < textures.size(); ++i) {
+            const auto& [font_id, glyph_id, scale, x_phase, rglyph, staging_offset,
+                         distance_field] = *inserting[kind][i];
+            Glyph glyph{
+                .left = rglyph.left,
+                .top = rglyph.top,
+                .width = rglyph.width,
+                .height = rglyph.height,
+                .uv = locations[i].uv,
+                .colored = rglyph.colored,
+                .page = locations[i].page,
+            };
+            if (distance_field) {
+                distance_fields[font_id].emplace(glyph_id, glyph);
+            } else {
+                cache_glyph(font_id, GlyphKey(glyph_id, scale, x_phase), x_phase, glyph,
+                            textures[i].data);
+            }
+        }
+    }
+
+    bool uploaded = !uploading_glyphs.empty();
+    uploading_glyphs.clear();
+    uploading_staging.clear();
+    return uploaded;
+}
+
+bool TextureCache::has_pending_glyphs() const {
+    return requested_count > 0;
+}
+
+void TextureCache::load_glyph_cache(const base::FilePath& path) {
+    font::GlyphDiskCache disk_cache;
+    if (!disk_cache.load(path)) return;
+
+    const auto& rasterizer = font::FontRasterizer::instance();
+    robin_hood::unordered_flat_map<uint64_t, size_t> font_ids;
+    for (size_t font_id = 0; font_id < rasterizer.font_count(); ++font_id) {
+        font_ids.emplace(DiskCacheFontKey(font_id), font_id);
+    }
+
+    std::vector<std::pair<size_t, const font::GlyphDiskCache::Entry*>> loaded;
+    std::vector<Atlas::Texture> textures;
+    for (const auto& entry : disk_cache.entries()) {
+        auto it = font_ids.find(entry.font_key);
+        if (it == font_ids.end()) continue;
+        size_t font_id = it->second;
+        if (font_id < cache.size() && cache[font_id].contains(entry.glyph_key)) continue;
+
+        // Each glyph must fit in an empty page.
+        if (entry.width < 0 || entry.height < 0 || entry.width > Atlas::kAtlasSize ||
+            entry.height >= Atlas::kAtlasSize ||
+            entry.size != static_cast<uint64_t>(entry.width) * entry.height) {
+            continue;
+        }
+        loaded.emplace_back(font_id, &entry);
+        textures.push_back({entry.width, entry.height, disk_cache.bitmap(entry)});
+    }
+
+    auto locations = insert_into_atlas(Atlas::Kind::kMonochrome, textures);
+    for (size_t i = 0; i < loaded.size(); ++i) {
+        const auto& [font_id, entry] = loaded[i];
+        if (cache.size() <= font_id) {
+            cache.resize(font_id + 1);
+        }
+        Glyph glyph{
+            .left = entry->left,
+            .top = entry->top,
+            .width = entry->width,
+            .height = entry->height,
+            .uv = locations[i].uv,
+            .colored = false,
+            .page = locations[i].page,
+        };
+        cache[font_id].emplace(entry->glyph_key, glyph);
+        record_glyph(font_id, entry->glyph_key, glyph, textures[i].data);
+    }
+}
+
+bool TextureCache::save_glyph_cache(const base::FilePath& path) const {
+    return font::GlyphDiskCache::save(path, saved_glyphs, saved_bitmaps);
 }
 
-const TextureCache::Glyph& TextureCache::get_glyph(size_t font_id, uint32_t glyph_id) {
+void TextureCache::set_distance_field_mode(bool enabled) {
+    use_distance_fields = enabled;
+    if (enabled && current_distance_field_page == 0) {
+        atlas_pages.emplace_back(Atlas::Kind::kDistanceField);
+        current_distance_field_page = atlas_pages.size() - 1;
+    }
+}
+
+bool TextureCache::distance_field_mode() const {
+    return use_distance_fields;
+}
+
+void TextureCache::request_glyph(size_t font_id, uint32_t glyph_id, int scale, int x_phase) {
+    if (requested.size() <= font_id) {
+        requested.resize(font_id + 1);
+    }
+    if (!requested[font_id].insert(GlyphKey(glyph_id, scale, x_phase)).second) return;
+    ++requested_count;
+
+    // Glyphs of a line usually share a font, so the last batch is the likeliest match.
+    auto it = std::find_if(unposted_batches.rbegin(), unposted_batches.rend(),
+                           [&](const UnpostedBatch& batch) {
+                               return batch.font_id == font_id && batch.scale == scale;
+                           });
+    if (it == unposted_batches.rend()) {
+        unposted_batches.push_back({font_id, scale, {}});
+        it = unposted_batches.rbegin();
+    }
+    it->glyphs.push_back({glyph_id, x_phase});
+}
+
+void TextureCache::post_requests() {
+    for (auto& [font_id, scale, glyphs] : unposted_batches) {
+        rasterizer_pool->post([queue = upload_queue, font_id, scale, glyphs = std::move(glyphs)] {
+            const auto& rasterizer = font::FontRasterizer::instance();
+            auto batch = rasterizer.rasterize_batch(font_id, scale, glyphs);
+            auto image = std::span<const uint8_t>{batch.buffer};
+            size_t stride = static_cast<size_t>(batch.width) * 4;
+
+            std::lock_guard lock{queue->mutex};
+            for (auto& glyph : batch.glyphs) {
+                size_t staging_offset = queue->staging.size();
+                AppendPageBitmap(glyph.rglyph, image.subspan(glyph.y * stride + glyph.x * 4),
+                                 stride, queue->staging);
+                queue->glyphs.push_back({font_id, glyph.glyph_id, scale, glyph.x_phase,
+                                         std::move(glyph.rglyph), staging_offset, false});
+            }
+        });
+    }
+    unposted_batches.clear();
+}
+
+const TextureCache::Glyph* TextureCache::find_distance_field(size_t font_id, uint32_t glyph_id) {
+    auto [it, inserted] = reference_fonts.try_emplace(font_id);
+    if (inserted) {
+        auto& rasterizer = font::FontRasterizer::instance();
+        it->second = rasterizer.resize_font(font_id, kDistanceFieldFontSize);
+    }
+    size_t reference_id = it->second;
+
+    if (reference_id < distance_fields.size()) {
+        auto field = distance_fields[reference_id].find(glyph_id);
+        if (field != distance_fields[reference_id].end()) return &field->second;
+    }
+    request_distance_field(font_id, reference_id, glyph_id);
+    return nullptr;
+}
+
+void TextureCache::request_distance_field(size_t font_id,
+                                          size_t reference_id,
+                                          uint32_t glyph_id) {
+    if (requested.size() <= reference_id) {
+        requested.resize(reference_id + 1);
+    }
+    if (!requested[reference_id].insert(DistanceFieldKey(glyph_id, 1)).second) return;
+    ++requested_count;
+
+    rasterizer_pool->post([queue = upload_queue, font_id, reference_id, glyph_id] {
+        const auto& rasterizer = font::FontRasterizer::instance();
+
+        // Only the font that shaped the glyph knows whether it has color, so it is measured too.
+        auto rglyph = rasterizer.rasterize(font_id, glyph_id, 1, 0, {});
+        std::vector<uint8_t> field;
+        if (!rglyph.colored) {
+            rglyph = rasterizer.rasterize(reference_id, glyph_id, 1, 0);
+            if (rglyph.width > 0 && rglyph.height > 0) {
+                std::vector<uint8_t> coverage;
+                AppendPageBitmap(rglyph, rglyph.buffer, rglyph.width * 4, coverage);
+                field = font::DistanceField(coverage, rglyph.width, rglyph.height,
+                                            kDistanceFieldSpread);
+                rglyph.left -= kDistanceFieldSpread;
+                rglyph.top += kDistanceFieldSpread;
+                rglyph.width += kDistanceFieldSpread * 2;
+                rglyph.height += kDistanceFieldSpread * 2;
+            }
+            rglyph.buffer = {};
+        }
+
+        std::lock_guard lock{queue->mutex};
+        size_t staging_offset = queue->staging.size();
+        queue->staging.insert(queue->staging.end(), field.begin(), field.end());
+        queue->glyphs.push_back(
+            {reference_id, glyph_id, 1, 0, std::move(rglyph), staging_offset, true});
+    });
+}
+
+const TextureCache::Glyph& TextureCache::scale_distance_field(size_t font_id,
+                                                              uint32_t glyph_id,
+                                                              int scale,
+                                                              const Glyph& field) {
     if (cache.size() <= font_id) {
         cache.resize(font_id + 1);
     }
 
-    if (!cache[font_id].contains(glyph_id)) {
-        const auto& font_rasterizer = font::FontRasterizer::instance();
-        auto rglyph = font_rasterizer.rasterize(font_id, glyph_id);
-        cache[font_id].emplace(glyph_id, insert_into_atlas(std::move(rglyph)));
+    uint64_t key = DistanceFieldKey(glyph_id, scale);
+    if (auto it = cache[font_id].find(key); it != cache[font_id].end()) {
+        return it->second;
     }
-    return cache[font_id][glyph_id];
+
+    const auto& metrics = font::FontRasterizer::instance().metrics(font_id, scale);
+    double ratio = static_cast<double>(metrics.font_size * scale) / kDistanceFieldFontSize;
+    Glyph glyph = field;
+    glyph.left = std::lround(field.left * ratio);
+    glyph.top = std::lround(field.top * ratio);
+    glyph.width = std::lround(field.width * ratio);
+    glyph.height = std::lround(field.height * ratio);
+    return cache[font_id].emplace(key, glyph).first->second;
 }
 
 // TODO: De-duplicate this code in a clean way.
@@ -66,32 +434,71 @@ const TextureCache::Image& TextureCache::get_image(size_t image_id) const {
     return image_cache[image_id];
 }
 
-// TODO: Refactor recursion.
-TextureCache::Glyph TextureCache::insert_into_atlas(const font::RasterizedGlyph& rglyph) {
-    Atlas& atlas = atlas_pages[current_page];
+const TextureCache::Glyph& TextureCache::cache_glyph(size_t font_id,
+                                                     uint64_t key,
+                                                     int x_phase,
+                                                     const Glyph& glyph,
+                                                     std::span<const uint8_t> bitmap) {
+    auto& stats = subpixel_phase_stats[x_phase];
+    ++stats.glyphs;
+    stats.atlas_area += std::max(glyph.width * glyph.height, 0);
+    const auto& cached = cache[font_id].emplace(key, glyph).first->second;
+    if (!glyph.colored) {
+        record_glyph(font_id, key, cached, bitmap);
+    }
+    return cached;
+}
 
-    // TODO: Handle the case when a texture is too large for the atlas.
-    //       Return an enum classifying the error instead of using a boolean.
-    Vec4 uv;
-    bool success =
-        atlas.insert_texture(rglyph.width, rglyph.height, Atlas::Format::kBGRA, rglyph.buffer, uv);
+void TextureCache::record_glyph(size_t font_id,
+                                uint64_t key,
+                                const Glyph& glyph,
+                                std::span<const uint8_t> bitmap) {
+    if (saved_bitmaps.size() + bitmap.size() > kMaxSavedBitmapBytes) return;
+
+    saved_glyphs.push_back({
+        .font_key = DiskCacheFontKey(font_id),
+        .glyph_key = key,
+        .left = glyph.left,
+        .top = glyph.top,
+        .width = glyph.width,
+        .height = glyph.height,
+        .offset = saved_bitmaps.size(),
+        .size = bitmap.size(),
+    });
+    saved_bitmaps.insert(saved_bitmaps.end(), bitmap.begin(), bitmap.end());
+}
 
-    // The current page is full, so create a new page and try again.
-    if (!success) {
-        atlas_pages.emplace_back();
-        ++current_page;
-        return insert_into_atlas(rglyph);
+std::vector<TextureCache::AtlasLocation> TextureCache::insert_into_atlas(
+    Atlas::Kind kind, std::span<const Atlas::Texture> textures) {
+    size_t& page = kind == Atlas::Kind::kColor        ? current_page
+                   : kind == Atlas::Kind::kMonochrome ? current_monochrome_page
+                                                      : current_distance_field_page;
+    auto format = kind == Atlas::Kind::kColor ? Atlas::Format::kBGRA : Atlas::Format::kR8;
+
+    std::vector<Vec4> uvs(textures.size());
+    std::vector<AtlasLocation> locations(textures.size());
+    bool new_page = false;
+    for (size_t i = 0; i < textures.size();) {
+        size_t count = atlas_pages[page].insert_textures(textures.subspan(i), format,
+                                                         std::span{uvs}.subspan(i));
+        for (size_t j = i; j < i + count; ++j) {
+            locations[j] = {page, uvs[j]};
+        }
+        i += count;
+        if (i == textures.size()) break;
+
+        // TODO: Handle the case when a texture is too large for the atlas.
+        if (new_page && count == 0) {
+            fmt::println("Glyph is too large.");
+            locations[i++] = {page, {}};
+            continue;
+        }
+        // The page is full, so continue in a new page.
+        atlas_pages.emplace_back(kind);
+        page = atlas_pages.size() - 1;
+        new_page = true;
     }
-
-    return {
-        .left = rglyph.left,
-        .top = rglyph.top,
-        .width = rglyph.width,
-        .height = rglyph.height,
-        .uv = uv,
-        .colored = rglyph.colored,
-        .page = current_page,
-    };
+    return locations;
 }
 
 // TODO: Handle errors.
@@ -121,7 +528,7 @@ bool TextureCache::load_png(const base::FilePath& path, Image& image) {
     // TODO: Handle case when atlas is full.
     Atlas& atlas = atlas_pages[current_page];
     Vec4 uv;
-    atlas.insert_texture(width, height, Atlas::Format::kRGBA, std::move(buffer), uv);
+    atlas.insert_texture(width, height, Atlas::Format::kRGBA, buffer, uv);
     image = {
         .size = {static_cast<int>(width), static_cast<int>(height)},
         .uv = uv,
@@ -165,7 +572,7 @@ bool TextureCache::load_jpeg(const base::FilePath& path, Image& image) {
     // TODO: Handle case when atlas is full.
     Atlas& atlas = atlas_pages[current_page];
     Vec4 uv;
-    atlas.insert_texture(width, height, Atlas::Format::kRGB, std::move(buffer), uv);
+    atlas.insert_texture(width, height, Atlas::Format::kRGB, buffer, uv);
     image = {
         .size = {static_cast<int>(width), static_cast<int>(height)},
         .uv = uv,
@@ -1,13 +1,18 @@
 #pragma once
 
 #include "base/files/file_path.h"
+#include "base/threading/thread_pool.h"
 #include "font/font_rasterizer.h"
+#include "font/glyph_disk_cache.h"
 #include "gui/renderer/atlas.h"
 #include "gui/renderer/types.h"
 #include "gui/types.h"
 
 #include "third_party/hash_maps/robin_hood.h"
 
+#include <array>
+#include <memory>
+#include <mutex>
 #include <vector>
 
 namespace gui {
@@ -26,7 +31,52 @@ public:
         bool colored;
         size_t page;
     };
-    const Glyph& get_glyph(size_t font_id, uint32_t glyph_id);
+    // Glyphs are cached per display scale, which should be the scale of the line layout they came
+    // from. Glyphs of other scales are kept, so moving a window between displays doesn't
+    // rasterize them again. Each subpixel phase of a glyph is cached separately, and is only
+    // rasterized once it is used.
+    //
+    // A glyph that isn't in the atlas yet is rasterized on a worker thread and null is returned.
+    // The caller should skip the glyph for this frame. In distance field mode, plain glyphs are
+    // scaled from their distance field and have no subpixel phase.
+    const Glyph* find_glyph(size_t font_id, uint32_t glyph_id, int scale, int x_phase);
+    // Rasterizes the glyphs of `layout` that aren't in the atlas yet on worker threads, e.g., for
+    // lines just outside the viewport.
+    void prefetch(const font::LineLayout& layout);
+    // Posts the glyphs requested by `find_glyph()` since the last call to worker threads, in one
+    // batch per font and scale. Callers should post after each line, so that a line's glyphs are
+    // rasterized together. Requests that aren't posted are posted on the next upload.
+    void post_requests();
+    // Inserts the glyphs rasterized since the last call into the atlas, uploading the glyphs of a
+    // page together where they can be. This must be called on the GL thread. Returns true if any
+    // glyph was inserted.
+    bool upload_ready_glyphs();
+    // Returns true while requested glyphs haven't been inserted yet, meaning that another frame is
+    // needed to draw them.
+    bool has_pending_glyphs() const;
+
+    // In distance field mode, plain glyphs are rasterized once per font face as signed distance
+    // fields of a reference size, which are scaled to every font size and display scale. Zooming
+    // then rasterizes nothing and doesn't grow the atlas. Color glyphs are still rasterized at
+    // each size, since their colors can't be scaled from a distance.
+    void set_distance_field_mode(bool enabled);
+    bool distance_field_mode() const;
+
+    // Preloads the plain glyphs saved by `save_glyph_cache()` for the fonts added so far, with one
+    // upload per atlas page. This must be called on the GL thread, e.g., before the first frame.
+    void load_glyph_cache(const base::FilePath& path);
+    // Saves the plain glyphs in the atlas, including those preloaded, for the next launch.
+    bool save_glyph_cache(const base::FilePath& path) const;
+
+    // Lookups and atlas use of each subpixel phase, for weighing the hit rate of a phase against
+    // its atlas cost.
+    struct PhaseStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t glyphs = 0;
+        size_t atlas_area = 0;
+    };
+    constexpr const std::array<PhaseStats, font::kSubpixelPhases>& phase_stats() const;
 
     struct Image {
         Size size;
@@ -41,13 +91,94 @@ public:
 
 private:
     std::vector<Atlas> atlas_pages;
+    // The pages that are being filled. Images and color glyphs go in color pages, and plain glyphs
+    // go in monochrome pages. The first distance field page is created with the mode, so 0 means
+    // that there is none yet.
     size_t current_page = 0;
+    size_t current_monochrome_page = 1;
+    size_t current_distance_field_page = 0;
 
-    // We use a node-based map since we need to keep references stable.
-    std::vector<robin_hood::unordered_node_map<uint32_t, Glyph>> cache;
+    // Indexed by the font, then keyed by `GlyphKey()`. We use a node-based map since we need to
+    // keep references stable.
+    std::vector<robin_hood::unordered_node_map<uint64_t, Glyph>> cache;
     std::vector<Image> image_cache;
+    std::array<PhaseStats, font::kSubpixelPhases> subpixel_phase_stats{};
 
-    Glyph insert_into_atlas(const font::RasterizedGlyph& rglyph);
+    // Copies of the plain glyphs' bitmaps, which otherwise only live in the atlas, for
+    // `save_glyph_cache()`. Glyphs are recorded until the bitmaps reach a size limit.
+    std::vector<font::GlyphDiskCache::Entry> saved_glyphs;
+    std::vector<uint8_t> saved_bitmaps;
+
+    bool use_distance_fields = false;
+    // The font of each font's face at the distance fields' reference size.
+    robin_hood::unordered_flat_map<size_t, size_t> reference_fonts;
+    // Indexed by the reference font, then keyed by the glyph. Color glyphs are kept without an
+    // atlas region, to remember that they have no distance field.
+    std::vector<robin_hood::unordered_flat_map<uint32_t, Glyph>> distance_fields;
+
+    struct ReadyGlyph {
+        size_t font_id;
+        uint32_t glyph_id;
+        int scale;
+        int x_phase;
+        // The bitmap is at `staging_offset` in the staging buffer, in its atlas page's format.
+        font::RasterizedGlyph rglyph;
+        size_t staging_offset;
+        // If set, the bitmap is the distance field of a reference font's glyph.
+        bool distance_field;
+    };
+    // Shared with the rasterization tasks, which draw into the staging buffer.
+    struct UploadQueue {
+        std::mutex mutex;
+        std::vector<ReadyGlyph> glyphs;
+        std::vector<uint8_t> staging;
+    };
+    std::shared_ptr<UploadQueue> upload_queue;
+    // Swapped with the queue's buffers on upload, so that both keep their capacity.
+    std::vector<ReadyGlyph> uploading_glyphs;
+    std::vector<uint8_t> uploading_staging;
+    // The glyphs that were requested but haven't been inserted yet, per font.
+    std::vector<robin_hood::unordered_flat_set<uint64_t>> requested;
+    size_t requested_count = 0;
+    struct UnpostedBatch {
+        size_t font_id;
+        int scale;
+        std::vector<font::BatchGlyph> glyphs;
+    };
+    std::vector<UnpostedBatch> unposted_batches;
+    // Declared last so that its threads are joined first.
+    std::unique_ptr<base::ThreadPool> rasterizer_pool;
+
+    void request_glyph(size_t font_id, uint32_t glyph_id, int scale, int x_phase);
+    // Returns the distance field of the glyph at the reference size. If it isn't in the atlas yet,
+    // it is rasterized on a worker thread and null is returned.
+    const Glyph* find_distance_field(size_t font_id, uint32_t glyph_id);
+    void request_distance_field(size_t font_id, size_t reference_id, uint32_t glyph_id);
+    // Returns the distance field `field` of the glyph, scaled to the font's size and `scale`.
+    const Glyph& scale_distance_field(size_t font_id,
+                                      uint32_t glyph_id,
+                                      int scale,
+                                      const Glyph& field);
+    // Adds a glyph that was inserted into the atlas to the cache.
+    const Glyph& cache_glyph(size_t font_id,
+                             uint64_t key,
+                             int x_phase,
+                             const Glyph& glyph,
+                             std::span<const uint8_t> bitmap);
+    void record_glyph(size_t font_id,
+                      uint64_t key,
+                      const Glyph& glyph,
+                      std::span<const uint8_t> bitmap);
+    struct AtlasLocation {
+        size_t page;
+        Vec4 uv;
+    };
+    // Inserts textures into the current page of `kind`, and into new pages as it fills up. The
+    // textures that land below everything else in a page are uploaded at once, see
+    // `Atlas::insert_textures()`. Textures must be in the format of the page: BGRA for color
+    // pages, and a single channel for the others.
+    std::vector<AtlasLocation> insert_into_atlas(Atlas::Kind kind,
+                                                 std::span<const Atlas::Texture> textures);
     bool load_png(const base::FilePath& path, Image& image);
     bool load_jpeg(const base::FilePath& path, Image& image);
 };
@@ -56,4 +187,9 @@ constexpr const std::vector<Atlas>& TextureCache::pages() const {
     return atlas_pages;
 }
 
+constexpr const std::array<TextureCache::PhaseStats, font::kSubpixelPhases>&
+TextureCache::phase_stats() const {
+    return subpixel_phase_stats;
+}
+
 }  // namespace gui
@@ -113,7 +113,7 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
                                     const Point& max_coords,
                                     const std::function<Rgb(size_t)>& highlight_callback) {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(line_layout.layout_font_id);
+    const auto& metrics = font_rasterizer.metrics(line_layout.layout_font_id, line_layout.scale);
     int line_height = metrics.line_height;
 
     auto& texture_cache = Renderer::instance().getTextureCache();
@@ -125,11 +125,15 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
     for (size_t i = 0; i < line_layout.glyphs.size(); ++i) {
         const auto& glyph = line_layout.glyphs[i];
 
-        auto& rglyph = texture_cache.get_glyph(glyph.font_id, glyph.glyph_id);
-        int32_t left = rglyph.left;
-        int32_t top = rglyph.top;
-        int32_t width = rglyph.width;
-        int32_t height = rglyph.height;
+        // Glyphs that are still being rasterized are skipped until they're ready.
+        const auto* rglyph = texture_cache.find_glyph(glyph.font_id, glyph.glyph_id,
+                                                      line_layout.scale, glyph.x_phase);
+        if (!rglyph) continue;
+
+        int32_t left = rglyph->left;
+        int32_t top = rglyph->top;
+        int32_t width = rglyph->width;
+        int32_t height = rglyph->height;
 
         // Invert glyph y-offset since we're flipping across the y-axis in OpenGL.
         top = line_height - top;
@@ -142,23 +146,31 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
         int bottom_edge = coords.y + height + top;
 
         if (right_edge <= min_coords.x) continue;
-        if (left_edge > max_coords.x) return;
+        if (left_edge > max_coords.x) break;
         if (bottom_edge <= min_coords.y) continue;
-        if (top_edge > max_coords.y) return;
+        if (top_edge > max_coords.y) break;
 
-        float uv_x = rglyph.uv.x;
-        float uv_y = rglyph.uv.y;
-        float uv_width = rglyph.uv.z;
-        float uv_height = rglyph.uv.w;
+        float uv_x = rglyph->uv.x;
+        float uv_y = rglyph->uv.y;
+        float uv_width = rglyph->uv.z;
+        float uv_height = rglyph->uv.w;
+        // Glyphs scaled from distance fields don't map a texel to a pixel.
+        float uv_per_x = width > 0 ? uv_width / width : 0;
+        float uv_per_y = height > 0 ? uv_height / height : 0;
 
-        int pos_x = coords.x + left_edge;
+        float pos_x = coords.x + left_edge;
         int pos_y = coords.y - metrics.descent;
+        // Distance fields are shared by all subpixel phases, which are applied here instead.
+        const Atlas& atlas = texture_cache.pages()[rglyph->page];
+        if (atlas.kind() == Atlas::Kind::kDistanceField) {
+            pos_x += static_cast<float>(glyph.x_phase) / font::kSubpixelPhases;
+        }
 
         if (left_edge < min_coords.x) {
             int diff1 = min_coords.x - left_edge;
             int diff2 = left;
             int diff = std::max(diff1 - diff2, 0);
-            float uv_diff = static_cast<float>(diff) / Atlas::kAtlasSize;
+            float uv_diff = diff * uv_per_x;
             width -= diff;
             uv_width -= uv_diff;
             pos_x += diff;
@@ -166,15 +178,15 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
         }
         if (right_edge > max_coords.x) {
             int diff = right_edge - max_coords.x;
-            float uv_diff = static_cast<float>(diff) / Atlas::kAtlasSize;
+            float uv_diff = diff * uv_per_x;
             width -= diff;
             uv_width -= uv_diff;
         }
         if (top_edge < min_coords.y) {
             int diff1 = min_coords.y - top_edge;
-            int diff2 = line_height - rglyph.top - glyph.position.y;
+            int diff2 = line_height - rglyph->top - glyph.position.y;
             int diff = std::max(diff1 - diff2, 0);
-            float uv_diff = static_cast<float>(diff) / Atlas::kAtlasSize;
+            float uv_diff = diff * uv_per_y;
             height -= diff;
             uv_height -= uv_diff;
             pos_y += diff;
@@ -184,7 +196,7 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
             int diff1 = bottom_edge - max_coords.y;
             int diff2 = metrics.descent;
             int diff = std::max(diff1 - diff2, 0);
-            float uv_diff = static_cast<float>(diff) / Atlas::kAtlasSize;
+            float uv_diff = diff * uv_per_y;
             height -= diff;
             uv_height -= uv_diff;
         }
@@ -195,16 +207,19 @@ void TextureRenderer::addLineLayout(const font::LineLayout& line_layout,
         }
 
         // TODO: Refactor these casts.
-        uint8_t alpha = rglyph.colored ? kColoredText : kPlainTexture;
+        uint8_t alpha = rglyph->colored ? kColoredText : kPlainTexture;
         InstanceData instance = {
-            .coords = {static_cast<float>(pos_x), static_cast<float>(pos_y)},
+            .coords = {pos_x, static_cast<float>(pos_y)},
             .glyph = {static_cast<float>(left), static_cast<float>(top), static_cast<float>(width),
                       static_cast<float>(height)},
             .uv = {uv_x, uv_y, uv_width, uv_height},
             .color = Rgba::fromRgb(highlight_callback(glyph.index), alpha),
         };
-        insertIntoBatch(rglyph.page, std::move(instance));
+        insertIntoBatch(rglyph->page, std::move(instance));
     }
+
+    // The line's missing glyphs are rasterized together.
+    texture_cache.post_requests();
 }
 
 void TextureRenderer::addImage(size_t image_index, const Point& coords, const Rgb& color) {
@@ -242,6 +257,8 @@ void TextureRenderer::flush(const Size& screen_size) {
     glUseProgram(shader_id);
     glUniform2f(glGetUniformLocation(shader_id, "resolution"), screen_size.width,
                 screen_size.height);
+    GLint monochrome_location = glGetUniformLocation(shader_id, "monochrome");
+    GLint distance_field_location = glGetUniformLocation(shader_id, "distance_field");
 
     glActiveTexture(GL_TEXTURE0);
     glBindVertexArray(vao);
@@ -259,8 +276,10 @@ void TextureRenderer::flush(const Size& screen_size) {
             continue;
         }
 
-        GLuint batch_tex = texture_cache.pages().at(page).tex();
-        glBindTexture(GL_TEXTURE_2D, batch_tex);
+        const Atlas& atlas = texture_cache.pages().at(page);
+        glBindTexture(GL_TEXTURE_2D, atlas.tex());
+        glUniform1i(monochrome_location, atlas.kind() == Atlas::Kind::kMonochrome);
+        glUniform1i(distance_field_location, atlas.kind() == Atlas::Kind::kDistanceField);
 
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * batch.size(), batch.data());
         glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, batch.size());
@@ -7,7 +7,7 @@ namespace gui {
 LabelWidget::LabelWidget(size_t font_id, const Rgb& color, int left_padding, int right_padding)
     : font_id(font_id), color(color) {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
     set_height(metrics.line_height);
 }
@@ -16,7 +16,7 @@ void LabelWidget::set_text(std::string_view str8) {
     this->label_str = str8;
 
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
-    const auto& layout = line_layout_cache.get(font_id, label_str);
+    const auto& layout = line_layout_cache.get(font_id, label_str, Renderer::instance().scale());
     set_width(layout.width);
 }
 
@@ -25,8 +25,8 @@ void LabelWidget::draw() {
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
 
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
-    const auto& layout = line_layout_cache.get(font_id, label_str);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
+    const auto& layout = line_layout_cache.get(font_id, label_str, Renderer::instance().scale());
 
     Point coords = center_vertically(metrics.line_height);
     Point min_coords = {
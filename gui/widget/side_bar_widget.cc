@@ -24,7 +24,7 @@ void SideBarWidget::draw() {
     rect_renderer.addRect(position(), size(), position(), position() + size(), kSideBarColor,
                           Layer::kBackground);
 
-    const auto& metrics = rasterizer().metrics(label_font_id);
+    const auto& metrics = rasterizer().metrics(label_font_id, Renderer::instance().scale());
 
     render_folder_label();
     render_labels();
@@ -41,7 +41,7 @@ bool SideBarWidget::mouse_position_changed(const std::optional<Point>& mouse_pos
         return hovered_index != old_index;
     }
 
-    const auto& metrics = rasterizer().metrics(label_font_id);
+    const auto& metrics = rasterizer().metrics(label_font_id, Renderer::instance().scale());
     int label_line_height = metrics.line_height;
     for (size_t line = 0; line < strs.size(); ++line) {
         Point coords = position() - scroll_offset;
@@ -61,7 +61,8 @@ bool SideBarWidget::mouse_position_changed(const std::optional<Point>& mouse_pos
 }
 
 void SideBarWidget::update_max_scroll() {
-    const auto& metrics = rasterizer().metrics(folders_label_font_id);
+    const auto& metrics =
+        rasterizer().metrics(folders_label_font_id, Renderer::instance().scale());
 
     int line_count = strs.size() + 1;
     max_scroll_offset.y = line_count * metrics.line_height;
@@ -71,7 +72,8 @@ void SideBarWidget::render_folder_label() {
     auto& texture_renderer = Renderer::instance().getTextureRenderer();
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
 
-    const auto& layout = line_layout_cache.get(folders_label_font_id, "FOLDERS");
+    const auto& layout =
+        line_layout_cache.get(folders_label_font_id, "FOLDERS", Renderer::instance().scale());
 
     Point text_coords = position() - scroll_offset;
     text_coords.x += kLeftPadding;
@@ -97,10 +99,12 @@ void SideBarWidget::render_labels() {
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
 
     // TODO: Experimental; formalize this.
-    const auto& metrics = rasterizer().metrics(folders_label_font_id);
+    const auto& metrics =
+        rasterizer().metrics(folders_label_font_id, Renderer::instance().scale());
     int label_line_height = metrics.line_height;
     for (size_t line = 0; line < strs.size(); ++line) {
-        const auto& layout = line_layout_cache.get(label_font_id, strs[line]);
+        const auto& layout =
+            line_layout_cache.get(label_font_id, strs[line], Renderer::instance().scale());
 
         Point coords = position() - scroll_offset;
         // TODO: Formalize the +1 from the "FOLDERS" label being rendered above.
@@ -55,8 +55,8 @@ void TabBarLabelWidget::draw() {
     }
 
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
-    const auto& layout = line_layout_cache.get(font_id, label_str);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
+    const auto& layout = line_layout_cache.get(font_id, label_str, Renderer::instance().scale());
 
     Point coords = center_vertically(metrics.line_height) + left_offset;
     Point min_coords = {
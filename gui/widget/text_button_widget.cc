@@ -10,11 +10,11 @@ TextButtonWidget::TextButtonWidget(
     size_t font_id, std::string_view str8, Rgb bg_color, const Size& padding, const Size& min_size)
     : bg_color(bg_color) {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
     line_height = metrics.line_height;
 
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
-    line_layout = line_layout_cache.get(font_id, str8);
+    line_layout = line_layout_cache.get(font_id, str8, Renderer::instance().scale());
 
     set_width(std::max(line_layout.width + padding.width * 2, min_size.width));
     set_height(std::max(line_height + padding.height * 2, min_size.height));
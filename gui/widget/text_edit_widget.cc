@@ -4,6 +4,7 @@
 #include "base/numeric/saturation_arithmetic.h"
 #include "editor/movement.h"
 #include "gui/renderer/renderer.h"
+#include "unicode/unicode.h"
 
 #include <cmath>
 
@@ -120,7 +121,7 @@ void TextEditWidget::insert_text(std::string_view str8) {
     }
 
     size_t i = selection.end;
-    tree.insert(i, str8);
+    insert(i, str8);
     selection.increment(str8.length(), false);
 
     // TODO: Do we update caret `max_x` too?
@@ -145,10 +146,10 @@ void TextEditWidget::left_delete() {
         }
 
         size_t i = selection.end;
-        tree.erase(i, delta);
+        erase(i, delta);
     } else {
         auto [start, end] = selection.range();
-        tree.erase(start, end - start);
+        erase(start, end - start);
         selection.collapse_left();
     }
 
@@ -164,10 +165,10 @@ void TextEditWidget::right_delete() {
 
         size_t delta = movement::move_to_next_glyph(layout, col);
         size_t i = selection.end;
-        tree.erase(i, delta);
+        erase(i, delta);
     } else {
         auto [start, end] = selection.range();
-        tree.erase(start, end - start);
+        erase(start, end - start);
         selection.collapse_left();
     }
 
@@ -184,7 +185,7 @@ void TextEditWidget::delete_word(bool forward) {
         if (forward) {
             offset = movement::next_word_end(tree, prev_offset);
             delta = offset - prev_offset;
-            tree.erase(prev_offset, delta);
+            erase(prev_offset, delta);
 
             // TODO: Clean up selection/caret code.
             // TODO: After clean up, move this out of TextViewWidget.
@@ -193,7 +194,7 @@ void TextEditWidget::delete_word(bool forward) {
         } else {
             offset = movement::prev_word_start(tree, prev_offset);
             delta = prev_offset - offset;
-            tree.erase(offset, delta);
+            erase(offset, delta);
 
             // TODO: Clean up selection/caret code.
             // TODO: After clean up, move this out of TextViewWidget.
@@ -202,7 +203,7 @@ void TextEditWidget::delete_word(bool forward) {
         }
     } else {
         auto [start, end] = selection.range();
-        tree.erase(start, end - start);
+        erase(start, end - start);
         selection.collapse_left();
     }
 }
@@ -213,21 +214,40 @@ std::string TextEditWidget::get_selection_text() {
 }
 
 void TextEditWidget::undo() {
-    tree.undo();
+    if (auto edit = tree.undo()) {
+        search_index.on_edit(tree, *edit);
+    }
 }
 
 void TextEditWidget::redo() {
-    tree.redo();
+    if (auto edit = tree.redo()) {
+        search_index.on_edit(tree, *edit);
+    }
 }
 
 void TextEditWidget::find(std::string_view str8) {
-    std::optional<size_t> result = tree.find(str8);
-    if (result) {
-        size_t offset = *result;
-        selection.set_range(offset, offset + str8.length());
+    // Find the visible matches right away, and the rest in the background.
+    auto [start_line, end_line] = visible_line_range();
+    size_t start = tree.offset_at(start_line, 0);
+    size_t end = end_line < tree.line_count() ? tree.offset_at(end_line, 0) : tree.length();
+    search_index.search_async(tree, str8, {}, start, end);
+
+    // The first match may be outside the visible lines, which the background scan has yet to
+    // reach.
+    if (auto match = search_index.find_first(tree, start)) {
+        selection.set_range(match->begin, match->end);
     }
 }
 
+std::optional<size_t> TextEditWidget::match_count() const {
+    if (!search_index.active()) return std::nullopt;
+    return search_index.count();
+}
+
+bool TextEditWidget::search_complete() const {
+    return search_index.complete();
+}
+
 // TODO: Use a struct type for clarity.
 std::pair<size_t, size_t> TextEditWidget::get_line_column() {
     size_t offset = selection.end;
@@ -246,22 +266,17 @@ void TextEditWidget::update_font_id(size_t font_id) {
 
 void TextEditWidget::draw() {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
-    // Calculate start and end lines.
     int main_line_height = metrics.line_height;
-    size_t visible_lines = std::ceil(static_cast<double>(size().height) / main_line_height);
+    auto [start_line, end_line] = visible_line_range();
 
-    size_t start_line = scroll_offset.y / main_line_height;
-    size_t end_line = start_line + visible_lines;
-
-    // Render two lines before start and after end. This ensures no sudden cutoff.
-    start_line = base::sub_sat(start_line, 2_Z);
-    end_line = base::add_sat(end_line, 2_Z);
-    start_line = std::clamp(start_line, 0_Z, tree.line_count());
-    end_line = std::clamp(end_line, 0_Z, tree.line_count());
+    // Pick up matches found by a background search since the last frame. The window keeps
+    // drawing frames until `search_complete()`.
+    search_index.poll();
 
     render_text(main_line_height, start_line, end_line);
+    render_matches(main_line_height, start_line, end_line);
     render_selections(main_line_height, start_line, end_line);
     // Render caret first so scroll bar draws over it.
     render_caret(main_line_height);
@@ -336,20 +351,50 @@ void TextEditWidget::left_mouse_up(const Point& mouse_pos) {
 
 void TextEditWidget::update_max_scroll() {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
     // NOTE: We update the max width when iterating over visible lines, not here.
 
     max_scroll_offset.y = tree.line_count() * metrics.line_height;
 }
 
+void TextEditWidget::insert(size_t offset, std::string_view str8) {
+    tree.insert(offset, str8);
+    search_index.on_insert(tree, offset, str8.length());
+}
+
+void TextEditWidget::erase(size_t offset, size_t count) {
+    // The tree only erases up to its end, and the index must shift by as much.
+    count = std::min(count, base::sub_sat(tree.length(), offset));
+    tree.erase(offset, count);
+    search_index.on_erase(tree, offset, count);
+}
+
+std::pair<size_t, size_t> TextEditWidget::visible_line_range() {
+    const auto& font_rasterizer = font::FontRasterizer::instance();
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
+
+    int main_line_height = metrics.line_height;
+    size_t visible_lines = std::ceil(static_cast<double>(size().height) / main_line_height);
+
+    size_t start_line = scroll_offset.y / main_line_height;
+    size_t end_line = start_line + visible_lines;
+
+    // Render two lines before start and after end. This ensures no sudden cutoff.
+    start_line = base::sub_sat(start_line, 2_Z);
+    end_line = base::add_sat(end_line, 2_Z);
+    start_line = std::clamp(start_line, 0_Z, tree.line_count());
+    end_line = std::clamp(end_line, 0_Z, tree.line_count());
+    return {start_line, end_line};
+}
+
 size_t TextEditWidget::line_at_y(int y) const {
     if (y < 0) {
         y = 0;
     }
 
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
     size_t line = y / metrics.line_height;
     return std::clamp(line, 0_Z, tree.line_count() - 1);
@@ -358,7 +403,7 @@ size_t TextEditWidget::line_at_y(int y) const {
 inline const font::LineLayout& TextEditWidget::layout_at(size_t line) {
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
     std::string line_str = tree.get_line_content_for_layout_use(line);
-    return line_layout_cache.get(font_id, line_str);
+    return line_layout_cache.get(font_id, line_str, Renderer::instance().scale());
 }
 
 inline constexpr Point TextEditWidget::text_offset() {
@@ -373,7 +418,7 @@ inline constexpr int TextEditWidget::gutter_width() {
 
 inline int TextEditWidget::line_number_width() {
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
-    int digit_width = line_layout_cache.get(font_id, "0").width;
+    int digit_width = line_layout_cache.get(font_id, "0", Renderer::instance().scale()).width;
     int log = std::log10(tree.line_count());
     return digit_width * std::max(log + 1, 2);
 }
@@ -450,7 +495,8 @@ void TextEditWidget::render_text(int main_line_height, size_t start_line, size_t
         line_number_coords.y += static_cast<int>(line) * main_line_height;
 
         std::string line_number_str = fmt::format("{}", line + 1);
-        const auto& line_number_layout = line_layout_cache.get(font_id, line_number_str);
+        const auto& line_number_layout =
+            line_layout_cache.get(font_id, line_number_str, Renderer::instance().scale());
         line_number_coords.x += line_number_width() - line_number_layout.width;
 
         const auto line_number_highlight_callback = [&line, &selection_line](size_t) {
@@ -469,6 +515,16 @@ void TextEditWidget::render_text(int main_line_height, size_t start_line, size_t
     }
 
     max_scroll_offset.x = max_layout_width;
+
+    // Rasterize the glyphs that scrolling is about to reveal.
+    auto& texture_cache = Renderer::instance().getTextureCache();
+    auto prefetch = [&](size_t first, size_t last) {
+        for (size_t line = first; line < last; ++line) {
+            texture_cache.prefetch(layout_at(line));
+        }
+    };
+    prefetch(base::sub_sat(start_line, kPrefetchLines), start_line);
+    prefetch(end_line, std::min(end_line + kPrefetchLines, tree.line_count()));
 }
 
 void TextEditWidget::render_selections(int main_line_height, size_t start_line, size_t end_line) {
@@ -517,6 +573,51 @@ void TextEditWidget::render_selections(int main_line_height, size_t start_line,
                                      max_coords);
 }
 
+void TextEditWidget::render_matches(int main_line_height, size_t start_line, size_t end_line) {
+    if (!search_index.active() || start_line >= end_line) return;
+
+    auto& rect_renderer = Renderer::instance().getRectRenderer();
+
+    // Case-insensitive matches may be longer than the query, but no longer than this.
+    size_t max_match_length = search_index.query().length() * unicode::kMaxBytesInUTF8Sequence;
+    size_t start = tree.offset_at(start_line, 0);
+    size_t end = end_line < tree.line_count() ? tree.offset_at(end_line, 0) : tree.length();
+
+    Point min_coords = {
+        .x = position().x + gutter_width(),
+        .y = position().y,
+    };
+    Point max_coords = {
+        .x = position().x + size().width,
+        .y = position().y + size().height,
+    };
+
+    // Include matches that start above the visible lines but extend into them.
+    for (const auto& match :
+         search_index.match_ranges_in(base::sub_sat(start, max_match_length), end)) {
+        if (match.end <= start) continue;
+
+        auto [c1_line, c1_col] = tree.line_column_at(match.begin);
+        auto [c2_line, c2_col] = tree.line_column_at(match.end);
+
+        size_t first_line = std::max(c1_line, start_line);
+        size_t last_line = std::min(c2_line, end_line - 1);
+        for (size_t line = first_line; line <= last_line; ++line) {
+            const auto& layout = layout_at(line);
+            int start_x = line == c1_line ? movement::x_at_column(layout, c1_col) : 0;
+            int end_x = line == c2_line ? movement::x_at_column(layout, c2_col) : layout.width;
+            if (end_x <= start_x) continue;
+
+            Point coords = text_offset();
+            coords.x += start_x + kBorderThickness;
+            coords.y += static_cast<int>(line) * main_line_height;
+            Size match_size = {end_x - start_x, main_line_height};
+            rect_renderer.addRect(coords, match_size, min_coords, max_coords, kMatchColor,
+                                  Layer::kBackground, kMatchCornerRadius);
+        }
+    }
+}
+
 // TODO: Implement a non-"scroll past end" mode.
 void TextEditWidget::render_scroll_bars(int main_line_height) {
     auto& rect_renderer = Renderer::instance().getRectRenderer();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "base/buffer/piece_tree.h"
+#include "base/buffer/search_index.h"
 #include "editor/selection.h"
 #include "gui/renderer/types.h"
 #include "gui/types.h"
@@ -23,6 +24,10 @@ public:
     void undo();
     void redo();
     void find(std::string_view str8);
+    // Returns the number of matches of the last search, or std::nullopt if there is none.
+    std::optional<size_t> match_count() const;
+    // Returns false while the last search is still running in the background.
+    bool search_complete() const;
     // TODO: Use a struct type for clarity.
     std::pair<size_t, size_t> get_line_column();
     size_t get_selection_length();
@@ -63,8 +68,11 @@ private:
     // static constexpr Rgb kCaretColor{95, 180, 180};       // Light.
     static constexpr Rgb kCaretColor{249, 174, 88};  // Dark.
     // TODO: Implement light version.
+    static constexpr Rgb kMatchColor{92, 84, 64};  // Dark.
+    // TODO: Implement light version.
     static constexpr Rgb kShadowColor{42, 49, 57};  // Dark.
     static constexpr int kCaretWidth = 4;
+    static constexpr int kMatchCornerRadius = 4;
     static constexpr int kExtraPadding = 8;
     static constexpr int kBorderThickness = 2;
     // TODO: Change minimum values.
@@ -72,10 +80,13 @@ private:
     static constexpr int kMinScrollBarHeight = 30;
     static constexpr int kScrollBarThickness = 7 * 2;
     static constexpr int kScrollBarPadding = 8;
+    // The glyphs of this many lines above and below the viewport are rasterized ahead of time.
+    static constexpr size_t kPrefetchLines = 20;
 
     size_t font_id;
 
     base::PieceTree tree{};
+    base::SearchIndex search_index{};
 
     Selection selection{};
     Selection old_selection{};
@@ -83,6 +94,12 @@ private:
     static constexpr int kGutterLeftPadding = 18 * 2;
     static constexpr int kGutterRightPadding = 8 * 2;
 
+    // Edit the tree and keep the search results in sync.
+    void insert(size_t offset, std::string_view str8);
+    void erase(size_t offset, size_t count);
+
+    // Returns the [start, end) range of lines that are drawn.
+    std::pair<size_t, size_t> visible_line_range();
     size_t line_at_y(int y) const;
     inline const font::LineLayout& layout_at(size_t line);
     inline constexpr Point text_offset();
@@ -92,6 +109,7 @@ private:
     // Draw helpers.
     void render_text(int main_line_height, size_t start_line, size_t end_line);
     void render_selections(int main_line_height, size_t start_line, size_t end_line);
+    void render_matches(int main_line_height, size_t start_line, size_t end_line);
     void render_scroll_bars(int main_line_height);
     void render_caret(int main_line_height);
 };
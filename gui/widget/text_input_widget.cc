@@ -14,7 +14,7 @@ TextInputWidget::TextInputWidget(size_t font_id, int top_padding, int left_paddi
     update_max_scroll();
 
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
     line_height = metrics.line_height;
 
     int new_height = line_height;
@@ -95,7 +95,7 @@ void TextInputWidget::draw() {
 
 void TextInputWidget::update_max_scroll() {
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
     // NOTE: We update the max width when iterating over visible lines, not here.
 
@@ -126,7 +126,7 @@ size_t TextInputWidget::line_at_y(int y) const {
     }
 
     const auto& font_rasterizer = font::FontRasterizer::instance();
-    const auto& metrics = font_rasterizer.metrics(font_id);
+    const auto& metrics = font_rasterizer.metrics(font_id, Renderer::instance().scale());
 
     size_t line = y / metrics.line_height;
     return std::clamp(line, 0_Z, tree.line_count() - 1);
@@ -135,7 +135,7 @@ size_t TextInputWidget::line_at_y(int y) const {
 inline const font::LineLayout& TextInputWidget::layout_at(size_t line) {
     auto& line_layout_cache = Renderer::instance().getLineLayoutCache();
     std::string line_str = tree.get_line_content_for_layout_use(line);
-    return line_layout_cache.get(font_id, line_str);
+    return line_layout_cache.get(font_id, line_str, Renderer::instance().scale());
 }
 
 inline constexpr Point TextInputWidget::text_offset() {
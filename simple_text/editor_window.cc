@@ -1,5 +1,6 @@
 #include "editor_window.h"
 
+#include "base/path_service.h"
 #include "gui/renderer/renderer.h"
 #include "gui/widget/container/horizontal_layout_widget.h"
 #include "gui/widget/container/horizontal_resizing_widget.h"
@@ -8,6 +9,7 @@
 #include "gui/widget/find_panel_widget.h"
 #include "simple_text/editor_app.h"
 
+#include <algorithm>
 #include <string>
 
 // TODO: Debug use; remove this.
@@ -23,6 +25,13 @@ const std::string kCppExample =
 #include "sample_code.txt"
     ;
 
+// Glyphs rasterized in one launch are preloaded from here in the next.
+base::FilePath GlyphCachePath() {
+    base::FilePath cache_dir;
+    base::PathService::get(base::PathKey::kDirCache, &cache_dir);
+    return cache_dir.Append("simple_text_glyphs");
+}
+
 }  // namespace
 
 EditorWindow::EditorWindow(EditorApp& parent, int width, int height, int wid)
@@ -42,6 +51,9 @@ EditorWindow::EditorWindow(EditorApp& parent, int width, int height, int wid)
 // On GTK, size isn't available upon realization. This is fine, just don't rely on `size` here!
 void EditorWindow::onOpenGLActivate() {
     using namespace std::literals;
+    // Widgets created below measure their text at this scale.
+    updateScale();
+
     auto* text_view = editor_widget->current_widget();
     // text_view->insertText("⌚..⌛⏩..⏬☂️..☃️");
     text_view->insert_text(kCppExample);
@@ -76,6 +88,9 @@ void EditorWindow::onOpenGLActivate() {
         parent.icon_wrap_image_id, parent.icon_in_selection_id, parent.icon_highlight_matches_id,
         parent.panel_close_image_id);
     main_widget->addChildEnd(std::move(find_panel_widget));
+
+    // All of the UI's fonts exist by now, so their glyphs can be preloaded for the first frame.
+    Renderer::instance().getTextureCache().load_glyph_cache(GlyphCachePath());
 }
 
 void EditorWindow::draw() {
@@ -84,21 +99,45 @@ void EditorWindow::draw() {
     // TODO: Debug use; remove this.
     auto* text_view = editor_widget->current_widget();
     if (text_view) {
+        std::string status_text;
         size_t length = text_view->get_selection_length();
         if (length > 0) {
-            status_bar->set_text(
-                fmt::format("{} character{} selected", length, length != 1 ? "s" : ""));
+            status_text = fmt::format("{} character{} selected", length, length != 1 ? "s" : "");
         } else {
             auto [line, col] = text_view->get_line_column();
-            status_bar->set_text(fmt::format("Line {}, Column {}", line + 1, col + 1));
+            status_text = fmt::format("Line {}, Column {}", line + 1, col + 1);
+        }
+        if (auto count = text_view->match_count()) {
+            status_text += fmt::format("; {}{} match{}", *count,
+                                       text_view->search_complete() ? "" : "+",
+                                       *count != 1 ? "es" : "");
         }
+        status_bar->set_text(status_text);
     } else {
         status_bar->set_text("No file open");
     }
 
+    // The window may have moved to a display with a different scale. Text is laid out again at
+    // the new scale, but glyphs already rasterized at either scale are kept.
+    if (updateScale()) {
+        main_widget->layout();
+    }
+
+    // Glyphs rasterized on worker threads since the last frame are drawn in this one.
+    auto& texture_cache = Renderer::instance().getTextureCache();
+    texture_cache.upload_ready_glyphs();
+
     main_widget->draw();
     Renderer::instance().flush(size());
 
+    // Keep drawing until the glyphs that were skipped in this frame are ready, and until a
+    // background search has found every match.
+    bool search_pending = text_view && !text_view->search_complete();
+    if (texture_cache.has_pending_glyphs() || search_pending) {
+        requested_frames = std::max(requested_frames, 1);
+        setAutoRedraw(true);
+    }
+
     // TODO: Refactor this.
     // if (requested_frames > 0) {
     //     setAutoRedraw(true);
@@ -163,6 +202,7 @@ void EditorWindow::onFrame(int64_t ms) {
 
 // TODO: Verify that resize is always called on all platforms when the window is created.
 void EditorWindow::layout() {
+    updateScale();
     main_widget->set_size(size());
     main_widget->layout();
     // side_bar->setMinimumWidth(100);
@@ -388,6 +428,12 @@ bool EditorWindow::onKeyDown(Key key, ModifierKey modifiers) {
         // TODO: Don't hard code this.
         text_view->find("needle");
         handled = true;
+    } else if (key == Key::kD && modifiers == (kPrimaryModifier | ModifierKey::kShift)) {
+        // Toggles drawing plain glyphs from distance fields, so that zooming doesn't rasterize
+        // them again.
+        auto& texture_cache = Renderer::instance().getTextureCache();
+        texture_cache.set_distance_field_mode(!texture_cache.distance_field_mode());
+        handled = true;
     }
 
     // TODO: Remove this.
@@ -422,7 +468,7 @@ bool EditorWindow::onKeyDown(Key key, ModifierKey modifiers) {
     // TODO: Clean this up.
     if (key == Key::kMinus && modifiers == kPrimaryModifier) {
         auto& font_rasterizer = font::FontRasterizer::instance();
-        const auto& metrics = font_rasterizer.metrics(parent.main_font_id);
+        const auto& metrics = font_rasterizer.metrics(parent.main_font_id, scale());
 
         int new_font_size = std::max(metrics.font_size - 1, 8);
         fmt::println("font size = {}", new_font_size);
@@ -433,7 +479,7 @@ bool EditorWindow::onKeyDown(Key key, ModifierKey modifiers) {
         handled = true;
     } else if (key == Key::kEqual && modifiers == kPrimaryModifier) {
         auto& font_rasterizer = font::FontRasterizer::instance();
-        const auto& metrics = font_rasterizer.metrics(parent.main_font_id);
+        const auto& metrics = font_rasterizer.metrics(parent.main_font_id, scale());
 
         int new_font_size = std::min(metrics.font_size + 1, 128);
         fmt::println("font size = {}", new_font_size);
@@ -444,7 +490,7 @@ bool EditorWindow::onKeyDown(Key key, ModifierKey modifiers) {
         handled = true;
     } else if (key == Key::k0 && modifiers == kPrimaryModifier) {
         auto& font_rasterizer = font::FontRasterizer::instance();
-        const auto& metrics = font_rasterizer.metrics(parent.main_font_id);
+        const auto& metrics = font_rasterizer.metrics(parent.main_font_id, scale());
 
         int new_font_size = parent.kMainFontSize;
         fmt::println("font size = {}", new_font_size);
@@ -566,6 +612,22 @@ void EditorWindow::onAppAction(AppAction action) {
 }
 
 void EditorWindow::onClose() {
+    // Reports how each subpixel phase is used by real text, to weigh its hit rate against its
+    // atlas cost.
+    constexpr bool kDebugSubpixelPhaseStats = false;
+    if constexpr (kDebugSubpixelPhaseStats) {
+        const auto& phase_stats = Renderer::instance().getTextureCache().phase_stats();
+        for (size_t phase = 0; phase < phase_stats.size(); ++phase) {
+            const auto& stats = phase_stats[phase];
+            size_t lookups = stats.hits + stats.misses;
+            double hit_rate = lookups > 0 ? 100.0 * stats.hits / lookups : 0.0;
+            fmt::println("Subpixel phase {}: {} lookups, {:.1f}% hits, {} glyphs, {} px in atlas",
+                         phase, lookups, hit_rate, stats.glyphs, stats.atlas_area);
+        }
+    }
+
+    Renderer::instance().getTextureCache().save_glyph_cache(GlyphCachePath());
+
     parent.destroyWindow(wid);
 }
 
@@ -590,4 +652,12 @@ void EditorWindow::updateCursorStyle(const std::optional<Point>& mouse_pos) {
     }
 }
 
+bool EditorWindow::updateScale() {
+    auto& renderer = Renderer::instance();
+    renderer.set_scale(scale());
+    bool changed = renderer.scale() != laid_out_scale;
+    laid_out_scale = renderer.scale();
+    return changed;
+}
+
 }  // namespace gui
@@ -77,7 +77,15 @@ private:
     gui::Widget* dragged_widget = nullptr;
     gui::Widget* focused_widget = nullptr;
 
+    // The scale that this window's widgets were last laid out at. The renderer's scale is shared
+    // by all windows, so each window only lays out again when its own scale changes.
+    int laid_out_scale = 0;
+
     void updateCursorStyle(const std::optional<Point>& mouse_pos);
+    // Sets the renderer's scale to this window's, which its widgets measure and lay out text at.
+    // This is done before laying out or drawing. Returns true if the window's scale changed since
+    // it was last laid out.
+    bool updateScale();
 };
 
 }  // namespace gui
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "third_party/uni_algo/include/uni_algo/prop.h"
+
+#include <cstdint>
+
+namespace unicode {
+
+// Word classification shared by cursor movement and whole-word search.
+enum class CharKind {
+    kWhitespace,
+    kPunctuation,
+    kWord,
+};
+
+constexpr CharKind to_kind(int32_t codepoint) {
+    if (una::codepoint::is_whitespace(codepoint)) {
+        return CharKind::kWhitespace;
+    } else if (una::codepoint::is_alphanumeric(codepoint) || codepoint == '_') {
+        return CharKind::kWord;
+    } else {
+        return CharKind::kPunctuation;
+    }
+}
+
+}  // namespace unicode
@@ -2,6 +2,14 @@
 
 #include "unicode/fits_in.h"
 
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 namespace unicode {
 
 namespace {
@@ -88,6 +96,31 @@ int CountUTF8(const char* utf8, size_t byteLength) {
     return count;
 }
 
+bool IsASCII(const char* utf8, size_t byteLength) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(_M_X64)
+    for (; i + 16 <= byteLength; i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(utf8 + i));
+        if (_mm_movemask_epi8(block) != 0) return false;
+    }
+#elif defined(__aarch64__)
+    for (; i + 16 <= byteLength; i += 16) {
+        uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(utf8 + i));
+        if (vmaxvq_u8(block) >= 0x80) return false;
+    }
+#endif
+    // Check the rest 8 bytes at a time.
+    for (; i + 8 <= byteLength; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, utf8 + i, sizeof(word));
+        if ((word & 0x8080808080808080) != 0) return false;
+    }
+    for (; i < byteLength; ++i) {
+        if (static_cast<uint8_t>(utf8[i]) >= 0x80) return false;
+    }
+    return true;
+}
+
 int CountUTF16(const uint16_t* utf16, size_t byteLength) {
     if (!utf16 || !is_align2(intptr_t(utf16)) || !is_align2(byteLength)) {
         return -1;
@@ -12,6 +12,11 @@ using Unichar = int32_t;
 */
 int CountUTF8(const char* utf8, size_t byteLength);
 
+/** Given a sequence of bytes, return true iff every byte is ASCII (i.e., below 0x80).
+    This checks 16 bytes at a time with SIMD where available.
+*/
+bool IsASCII(const char* utf8, size_t byteLength);
+
 /** Given a sequence of aligned UTF-16 characters in machine-endian form,
     return the number of unicode codepoints.  If the sequence is invalid
     UTF-16, return -1.
@@ -15,4 +15,20 @@ TEST(UnicodeTest, CountUTF8Test) {
     EXPECT_EQ(CountUTF8(str3.data(), str3.length()), 1);
 }
 
+TEST(UnicodeTest, IsASCIITest) {
+    EXPECT_TRUE(IsASCII("", 0));
+    std::string str1 = "    for (size_t i = 0; i < length; ++i) {}";
+    EXPECT_TRUE(IsASCII(str1.data(), str1.length()));
+
+    // Place a non-ASCII character at every position, so that each of the SIMD, word and byte loops
+    // has to find it.
+    std::string str2(40, 'a');
+    for (size_t i = 0; i < str2.length(); ++i) {
+        std::string str = str2;
+        str[i] = static_cast<char>(0xC3);
+        EXPECT_FALSE(IsASCII(str.data(), str.length())) << i;
+        EXPECT_TRUE(IsASCII(str.data(), i)) << i;
+    }
+}
+
 }  // namespace unicode